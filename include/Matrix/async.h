@@ -0,0 +1,118 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_ASYNC_H
+#define MATRIX_ASYNC_H
+
+#include <future>
+#include <string>
+
+#include "io.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+/**
+ * @brief Starts lhs * rhs on the thread pool and returns a future of the
+ * product.
+ *
+ * The product itself runs in parallel as usual. The operands are read by
+ * reference, so they should outlive the future and not be modified until it
+ * is ready.
+ *
+ *
+ * @example
+ *
+ * #include "async.h"
+ *
+ * std::future<linalg::Matrix<float>> pending{linalg::multiplyAsync(A, B)};
+ * serveRequests();                           // overlaps with the product
+ * linalg::Matrix<float> C{pending.get()};
+ *
+ *
+ * @param lhs - The left-hand side Matrix object.
+ * @param rhs - The right-hand side Matrix object.
+ * @return Future of lhs * rhs.
+ */
+template <typename T>
+std::future<Matrix<T>> multiplyAsync(const Matrix<T>& lhs, const Matrix<T>& rhs)
+{
+    const Matrix<T>* a = &lhs;
+    const Matrix<T>* b = &rhs;
+    return ThreadPool::instance().submit([a, b]() { return Matrix<T>{*a * *b}; });
+}
+
+/**
+ * @brief Starts mat.transpose() on the thread pool. mat should outlive the
+ * future.
+ */
+template <typename T>
+std::future<Matrix<T>> transposeAsync(const Matrix<T>& mat)
+{
+    const Matrix<T>* src = &mat;
+    return ThreadPool::instance().submit([src]() { return src->transpose(); });
+}
+
+/**
+ * @brief Starts save() on the thread pool. mat should outlive the future.
+ *
+ *
+ * @example
+ *
+ * #include "async.h"
+ *
+ * std::future<bool> saved{linalg::saveAsync(checkpoint, "step_1000.bin")};
+ * trainNextStep();
+ * if (!saved.get()) { ... }
+ *
+ *
+ * @param mat - The Matrix object.
+ * @param path - Path of the file.
+ * @return Future of the result of save().
+ */
+template <typename T>
+std::future<bool> saveAsync(const Matrix<T>& mat, const std::string& path)
+{
+    const Matrix<T>* src = &mat;
+    return ThreadPool::instance().submit([src, path]() { return save(*src, path); });
+}
+
+/**
+ * @brief Starts load() on the thread pool. mat is replaced once the future is
+ * ready and should not be used before.
+ *
+ *
+ * @param path - Path of the file.
+ * @param mat - Replaced by the Matrix object in the file.
+ * @return Future of the result of load().
+ */
+template <typename T>
+std::future<bool> loadAsync(const std::string& path, Matrix<T>& mat)
+{
+    Matrix<T>* dst = &mat;
+    return ThreadPool::instance().submit([path, dst]() { return load(path, *dst); });
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_ASYNC_H
@@ -0,0 +1,249 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_CHOLESKY_H
+#define MATRIX_CHOLESKY_H
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "triangular.h"
+
+
+namespace linalg
+{
+// Number of columns factored at once before the trailing update.
+const size_t CHOLESKY_BLOCK = 64;
+
+namespace detail
+{
+/*
+ * Unblocked Cholesky of the kb x kb lower triangle at a. Returns false when a
+ * pivot is not positive.
+ */
+template <typename T>
+bool choleskyDiagonal(T* a, size_t lda, size_t kb)
+{
+    for (size_t j=0; j<kb; j++)
+    {
+        T* rowJ = a + j * lda;
+        T pivot = rowJ[j];
+        for (size_t p=0; p<j; p++)
+        {
+            pivot -= rowJ[p] * rowJ[p];
+        }
+        if (!(pivot > T(0)))
+        {
+            return false;
+        }
+        pivot = std::sqrt(pivot);
+        rowJ[j] = pivot;
+
+        for (size_t i=j+1; i<kb; i++)
+        {
+            T* rowI = a + i * lda;
+            T value = rowI[j];
+            for (size_t p=0; p<j; p++)
+            {
+                value -= rowI[p] * rowJ[p];
+            }
+            rowI[j] = value / pivot;
+        }
+    }
+    return true;
+}
+
+/*
+ * Right-looking blocked Cholesky of the n x n row-major buffer a, in place of
+ * its lower triangle. For each block of CHOLESKY_BLOCK columns the diagonal
+ * block is factored, the panel below it is found with a triangular solve, and
+ * the trailing matrix is updated with syrkLower(), which is where almost all
+ * the work is done.
+ */
+template <typename T>
+bool choleskyFactor(T* a, size_t n)
+{
+    for (size_t k0=0; k0<n; k0+=CHOLESKY_BLOCK)
+    {
+        size_t kb = std::min(CHOLESKY_BLOCK, n - k0);
+        size_t rest = n - k0 - kb;
+        T* diagonal = a + k0 * n + k0;
+        if (!choleskyDiagonal(diagonal, n, kb))
+        {
+            return false;
+        }
+
+        // L21 = A21 * L11^-T
+        T* panel = diagonal + kb * n;
+        trsmRight(Triangle::Lower, Transpose::Yes, Diagonal::NonUnit, rest, kb, diagonal, n, panel, n);
+
+        // A22 -= L21 * L21^T
+        syrkLower(rest, kb, T(-1), panel, n, T(1), panel + kb, n);
+    }
+
+    parallelFor(0, n, std::max<size_t>(1, ELEMENTWISE_GRAIN / std::max<size_t>(n, 1)), [=](size_t begin, size_t end)
+    {
+        for (size_t i=begin; i<end; i++)
+        {
+            std::fill(a + i * n + i + 1, a + (i + 1) * n, T(0));
+        }
+    });
+    return true;
+}
+} // namespace detail
+
+/**
+ * @brief Replaces a symmetric positive-definite Matrix object with its
+ * Cholesky factor L, where A = L L^T.
+ *
+ * Only the lower triangle of A is read, and the upper triangle of the result
+ * is set to zero. No second Matrix object is allocated. If A is not positive
+ * definite, false is returned and the content of the Matrix object is
+ * undefined.
+ *
+ *
+ * @example
+ *
+ * #include "cholesky.h"
+ *
+ * linalg::Matrix<double> A{{{4, 2}, {2, 5}}};
+ * linalg::choleskyInPlace(A);
+ * // A is [[2 0] [1 2]]
+ *
+ *
+ * @param mat - Square Matrix object of float or double.
+ * @return true if the factorization succeeded.
+ */
+template <typename T>
+bool choleskyInPlace(Matrix<T>& mat)
+{
+    static_assert(std::is_floating_point<T>::value, "Cholesky needs a floating point Matrix");
+    if (mat.rows() != mat.cols())
+    {
+        std::cerr << "Cholesky - Matrix should be square" << std::endl;
+        std::abort();
+    }
+    return detail::choleskyFactor(mat.data(), mat.rows());
+}
+
+/**
+ * @brief Cholesky factorization A = L L^T of a symmetric positive-definite
+ * Matrix object.
+ *
+ *
+ * @example
+ *
+ * #include "cholesky.h"
+ *
+ * linalg::Matrix<double> covariance{{{4, 2}, {2, 5}}};
+ * linalg::Matrix<double> B{{{8, 2}, {9, 3}}};
+ * linalg::CholeskyDecomposition<double> chol{std::move(covariance)};
+ * linalg::Matrix<double> X{chol.solve(B)};
+ * double logDet{chol.logDeterminant()};
+ *
+ *
+ * @param mat - Square Matrix object. Pass it with std::move to factor it
+ *              without a copy.
+ */
+template <typename T>
+class CholeskyDecomposition
+{
+public:
+    explicit CholeskyDecomposition(Matrix<T> mat)
+        : m_factor{std::move(mat)}
+    {
+        m_positiveDefinite = choleskyInPlace(m_factor);
+    }
+
+   /**
+    * @brief Solves A X = B in place of B with two triangular solves.
+    *
+    * The program is aborted if A is not positive definite or the number of
+    * rows of B does not match.
+    *
+    *
+    * @param rhs - Matrix object B, overwritten with X.
+    */
+    void solveInPlace(Matrix<T>& rhs) const
+    {
+        if (!m_positiveDefinite)
+        {
+            std::cerr << "Cholesky solve - Matrix is not positive definite" << std::endl;
+            std::abort();
+        }
+        solveTriangularInPlace(m_factor, rhs, Triangle::Lower);
+        solveTriangularInPlace(m_factor, rhs, Triangle::Lower, Side::Left, Transpose::Yes);
+    }
+
+   /**
+    * @brief Returns the solution X of A X = B.
+    */
+    Matrix<T> solve(const Matrix<T>& rhs) const
+    {
+        Matrix<T> res{rhs};
+        solveInPlace(res);
+        return res;
+    }
+
+   /**
+    * @brief Returns log(det(A)), twice the sum of the logarithms of the
+    * diagonal of L. Unlike the determinant itself, it does not overflow for
+    * large matrices.
+    */
+    T logDeterminant() const
+    {
+        T res = T(0);
+        for (size_t i=0; i<m_factor.rows(); i++)
+        {
+            res += std::log(m_factor(i, i));
+        }
+        return T(2) * res;
+    }
+
+   /**
+    * @brief Returns false if a pivot was not positive.
+    */
+    bool isPositiveDefinite() const
+    {
+        return m_positiveDefinite;
+    }
+
+   /**
+    * @brief Returns the lower triangular factor L.
+    */
+    const Matrix<T>& factor() const
+    {
+        return m_factor;
+    }
+
+private:
+    Matrix<T> m_factor;
+    bool m_positiveDefinite;
+};
+
+}; // namespace linalg
+
+#endif // MATRIX_CHOLESKY_H
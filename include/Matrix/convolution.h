@@ -0,0 +1,418 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_CONVOLUTION_H
+#define MATRIX_CONVOLUTION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+// Output tiles of the Winograd convolution transformed together. Bounds the
+// transform buffers to a few hundred kilobytes.
+const size_t WINOGRAD_TILES = 128;
+
+namespace detail
+{
+/*
+ * Element (row, col) of the im2col Matrix of a batch of images, computed
+ * from the image itself. A row is one output position (image, y, x) and a
+ * column is one filter tap (ky, kx, channel). Taps in the padding read 0.
+ */
+template <typename T>
+struct PatchAccess
+{
+    const T* data;
+    size_t height;
+    size_t width;
+    size_t channels;
+    size_t kernelWidth;
+    size_t stride;
+    size_t padding;
+    size_t outHeight;
+    size_t outWidth;
+
+    // Offset of the top left tap of the patch of an output position.
+    void origin(size_t row, size_t& image, ptrdiff_t& y, ptrdiff_t& x) const
+    {
+        image = row / (outHeight * outWidth);
+        size_t position = row % (outHeight * outWidth);
+        y = static_cast<ptrdiff_t>((position / outWidth) * stride) - static_cast<ptrdiff_t>(padding);
+        x = static_cast<ptrdiff_t>((position % outWidth) * stride) - static_cast<ptrdiff_t>(padding);
+    }
+
+    T at(size_t image, ptrdiff_t y, ptrdiff_t x, size_t channel) const
+    {
+        if (y < 0 || x < 0 || y >= static_cast<ptrdiff_t>(height) || x >= static_cast<ptrdiff_t>(width))
+        {
+            return T(0);
+        }
+        return data[((image * height + y) * width + x) * channels + channel];
+    }
+
+    T operator() (size_t row, size_t col) const
+    {
+        size_t image;
+        ptrdiff_t y;
+        ptrdiff_t x;
+        origin(row, image, y, x);
+        size_t tap = col / channels;
+        return at(image, y + static_cast<ptrdiff_t>(tap / kernelWidth),
+                  x + static_cast<ptrdiff_t>(tap % kernelWidth), col % channels);
+    }
+};
+
+/*
+ * Packs a block of patches straight from the image, the same layout as the
+ * generic packLhs(). The patch origins are found once per sliver and the taps
+ * are walked incrementally, so no division is done per element.
+ */
+template <typename T>
+void packLhs(const PatchAccess<T>& a, size_t i0, size_t p0, size_t mc, size_t kc, T* out)
+{
+    for (size_t s=0; s<mc; s+=GEMM_MR)
+    {
+        size_t mr = std::min(GEMM_MR, mc - s);
+        size_t images[GEMM_MR];
+        ptrdiff_t ys[GEMM_MR];
+        ptrdiff_t xs[GEMM_MR];
+        for (size_t r=0; r<mr; r++)
+        {
+            a.origin(i0 + s + r, images[r], ys[r], xs[r]);
+        }
+
+        size_t channel = p0 % a.channels;
+        size_t tap = p0 / a.channels;
+        ptrdiff_t ky = static_cast<ptrdiff_t>(tap / a.kernelWidth);
+        ptrdiff_t kx = static_cast<ptrdiff_t>(tap % a.kernelWidth);
+        for (size_t p=0; p<kc; p++)
+        {
+            for (size_t r=0; r<mr; r++)
+            {
+                out[p * GEMM_MR + r] = a.at(images[r], ys[r] + ky, xs[r] + kx, channel);
+            }
+            for (size_t r=mr; r<GEMM_MR; r++)
+            {
+                out[p * GEMM_MR + r] = T(0);
+            }
+            if (++channel == a.channels)
+            {
+                channel = 0;
+                if (++kx == static_cast<ptrdiff_t>(a.kernelWidth))
+                {
+                    kx = 0;
+                    ky++;
+                }
+            }
+        }
+        out += kc * GEMM_MR;
+    }
+}
+
+inline size_t convolutionOutputSize(size_t size, size_t kernel, size_t stride, size_t padding)
+{
+    if (stride == 0 || size + 2 * padding < kernel)
+    {
+        std::cerr << "Convolution - Kernel does not fit in the padded image" << std::endl;
+        std::abort();
+    }
+    return (size + 2 * padding - kernel) / stride + 1;
+}
+
+template <typename T>
+size_t checkConvolutionInput(const Matrix<T>& input, size_t height, size_t width, const Matrix<T>& filters,
+                             size_t taps)
+{
+    if (height == 0 || width == 0 || input.rows() % (height * width) != 0)
+    {
+        std::cerr << "Convolution - Input rows should be a multiple of height * width" << std::endl;
+        std::abort();
+    }
+    if (filters.cols() != taps * input.cols())
+    {
+        std::cerr << "Convolution - Filter size does not match the kernel and the input channels" << std::endl;
+        std::abort();
+    }
+    return input.rows() / (height * width);
+}
+
+// U = G g G^T for every (channel, filter) pair, stored as 16 channels x filters
+// Matrix buffers, one per element of the 4 x 4 tile.
+template <typename T>
+std::vector<T> winogradFilters(const Matrix<T>& filters, size_t channels)
+{
+    size_t count = filters.rows();
+    std::vector<T> res(16 * channels * count);
+    parallelFor(0, count, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t o=begin; o<end; o++)
+        {
+            for (size_t c=0; c<channels; c++)
+            {
+                T g[3][3];
+                for (size_t ky=0; ky<3; ky++)
+                {
+                    for (size_t kx=0; kx<3; kx++)
+                    {
+                        g[ky][kx] = filters(o, (ky * 3 + kx) * channels + c);
+                    }
+                }
+                // Gg, 4 x 3.
+                T gg[4][3];
+                for (size_t kx=0; kx<3; kx++)
+                {
+                    gg[0][kx] = g[0][kx];
+                    gg[1][kx] = T(0.5) * (g[0][kx] + g[1][kx] + g[2][kx]);
+                    gg[2][kx] = T(0.5) * (g[0][kx] - g[1][kx] + g[2][kx]);
+                    gg[3][kx] = g[2][kx];
+                }
+                for (size_t i=0; i<4; i++)
+                {
+                    T u[4] = {gg[i][0], T(0.5) * (gg[i][0] + gg[i][1] + gg[i][2]),
+                              T(0.5) * (gg[i][0] - gg[i][1] + gg[i][2]), gg[i][2]};
+                    for (size_t j=0; j<4; j++)
+                    {
+                        res[((i * 4 + j) * channels + c) * count + o] = u[j];
+                    }
+                }
+            }
+        }
+    });
+    return res;
+}
+
+// V = B^T d B for every channel of one input tile, written to element
+// (tile, c) of the 16 tiles x channels buffers.
+template <typename T>
+void winogradInputTile(const PatchAccess<T>& image, size_t n, ptrdiff_t y0, ptrdiff_t x0, size_t tile,
+                       size_t tiles, T* v)
+{
+    size_t channels = image.channels;
+    for (size_t c=0; c<channels; c++)
+    {
+        T d[4][4];
+        for (ptrdiff_t i=0; i<4; i++)
+        {
+            for (ptrdiff_t j=0; j<4; j++)
+            {
+                d[i][j] = image.at(n, y0 + i, x0 + j, c);
+            }
+        }
+        T bd[4][4];
+        for (size_t j=0; j<4; j++)
+        {
+            bd[0][j] = d[0][j] - d[2][j];
+            bd[1][j] = d[1][j] + d[2][j];
+            bd[2][j] = d[2][j] - d[1][j];
+            bd[3][j] = d[1][j] - d[3][j];
+        }
+        for (size_t i=0; i<4; i++)
+        {
+            T row[4] = {bd[i][0] - bd[i][2], bd[i][1] + bd[i][2], bd[i][2] - bd[i][1], bd[i][1] - bd[i][3]};
+            for (size_t j=0; j<4; j++)
+            {
+                v[((i * 4 + j) * tiles + tile) * channels + c] = row[j];
+            }
+        }
+    }
+}
+
+// Y = A^T m A for every filter of one tile, keeping the outputs inside the image.
+template <typename T>
+void winogradOutputTile(const T* m, size_t tile, size_t tiles, size_t count, T* out, size_t outWidth,
+                        size_t rows, size_t cols)
+{
+    for (size_t o=0; o<count; o++)
+    {
+        T t[4][4];
+        for (size_t i=0; i<4; i++)
+        {
+            for (size_t j=0; j<4; j++)
+            {
+                t[i][j] = m[((i * 4 + j) * tiles + tile) * count + o];
+            }
+        }
+        T at[2][4];
+        for (size_t j=0; j<4; j++)
+        {
+            at[0][j] = t[0][j] + t[1][j] + t[2][j];
+            at[1][j] = t[1][j] - t[2][j] - t[3][j];
+        }
+        for (size_t i=0; i<rows; i++)
+        {
+            T y[2] = {at[i][0] + at[i][1] + at[i][2], at[i][1] - at[i][2] - at[i][3]};
+            for (size_t j=0; j<cols; j++)
+            {
+                out[(i * outWidth + j) * count + o] = y[j];
+            }
+        }
+    }
+}
+} // namespace detail
+
+/**
+ * @brief Returns the 2D convolution (cross-correlation) of a batch of images
+ * with a bank of filters, computed as a matrix multiplication.
+ *
+ * The images are stored one pixel per row and one channel per column, so the
+ * input is (batch * height * width) x channels and the output is
+ * (batch * outHeight * outWidth) x filters in the same layout, ready for the
+ * next layer. Row o of the filters holds the taps of filter o in
+ * (ky, kx, channel) order.
+ *
+ * The product is the im2col Matrix times the transposed filters, but the
+ * patches are gathered from the images while the multiplication kernel packs
+ * its left-hand side, so the im2col Matrix is never allocated.
+ *
+ *
+ * @example
+ *
+ * #include "convolution.h"
+ *
+ * // 8 RGB images of 32 x 32 and 16 filters of 5 x 5.
+ * linalg::Matrix<float> images{8 * 32 * 32, 3, 0.5f};
+ * linalg::Matrix<float> filters{16, 5 * 5 * 3, 0.1f};
+ * linalg::Matrix<float> features{linalg::conv2d(images, 32, 32, filters, 5, 5, 1, 2)};
+ * // 8 * 32 * 32 x 16
+ *
+ *
+ * @param input - Matrix object of batch * height * width rows and one column per channel.
+ * @param height - Height of every image.
+ * @param width - Width of every image.
+ * @param filters - Matrix object of one row per filter and kernelHeight * kernelWidth * channels columns.
+ * @param kernelHeight - Height of the filters.
+ * @param kernelWidth - Width of the filters.
+ * @param stride - Step between two output positions.
+ * @param padding - Zeros added on every side of the images.
+ * @return Matrix object of batch * outHeight * outWidth rows and one column per filter.
+ */
+template <typename T>
+Matrix<T> conv2d(const Matrix<T>& input, size_t height, size_t width, const Matrix<T>& filters,
+                 size_t kernelHeight, size_t kernelWidth, size_t stride = 1, size_t padding = 0)
+{
+    size_t batch = detail::checkConvolutionInput(input, height, width, filters, kernelHeight * kernelWidth);
+    size_t outHeight = detail::convolutionOutputSize(height, kernelHeight, stride, padding);
+    size_t outWidth = detail::convolutionOutputSize(width, kernelWidth, stride, padding);
+
+    detail::PatchAccess<T> patches{input.data(), height, width, input.cols(), kernelWidth, stride, padding,
+                                   outHeight, outWidth};
+    size_t rows = batch * outHeight * outWidth;
+    Matrix<T> res(rows, filters.rows());
+    detail::gemm(rows, filters.rows(), filters.cols(), T(1), patches,
+                 detail::TransposedAccess<T>{filters.data(), filters.cols()}, T(0), res.data(), filters.rows());
+    return res;
+}
+
+/**
+ * @brief 3 x 3 convolution with stride 1 using Winograd's F(2x2, 3x3)
+ * minimal filtering algorithm.
+ *
+ * Every 2 x 2 block of outputs is computed from a 4 x 4 input tile with 16
+ * multiplications per channel and filter instead of 36. The element-wise
+ * products over the channels are 16 matrix multiplications of
+ * tiles x channels by channels x filters. Tiles are transformed in groups of
+ * WINOGRAD_TILES, so only small transform buffers are allocated. The
+ * transforms cost a little accuracy compared to conv2d(), which is usually
+ * negligible in single precision.
+ *
+ *
+ * @example
+ *
+ * #include "convolution.h"
+ *
+ * linalg::Matrix<float> images{56 * 56, 64, 0.5f};
+ * linalg::Matrix<float> filters{64, 3 * 3 * 64, 0.1f};
+ * linalg::Matrix<float> features{linalg::conv2dWinograd(images, 56, 56, filters, 1)};
+ *
+ *
+ * @param input - Matrix object of batch * height * width rows and one column per channel.
+ * @param height - Height of every image.
+ * @param width - Width of every image.
+ * @param filters - Matrix object of one row per filter and 3 * 3 * channels columns.
+ * @param padding - Zeros added on every side of the images.
+ * @return The same Matrix object as conv2d(input, height, width, filters, 3, 3, 1, padding).
+ */
+template <typename T>
+Matrix<T> conv2dWinograd(const Matrix<T>& input, size_t height, size_t width, const Matrix<T>& filters,
+                         size_t padding = 0)
+{
+    size_t batch = detail::checkConvolutionInput(input, height, width, filters, 9);
+    size_t outHeight = detail::convolutionOutputSize(height, 3, 1, padding);
+    size_t outWidth = detail::convolutionOutputSize(width, 3, 1, padding);
+    size_t channels = input.cols();
+    size_t count = filters.rows();
+    size_t tileRows = (outHeight + 1) / 2;
+    size_t tileCols = (outWidth + 1) / 2;
+    size_t tiles = batch * tileRows * tileCols;
+
+    std::vector<T> u{detail::winogradFilters(filters, channels)};
+    detail::PatchAccess<T> image{input.data(), height, width, channels, 3, 1, padding, outHeight, outWidth};
+    Matrix<T> res(batch * outHeight * outWidth, count);
+    T* out = res.data();
+
+    size_t groups = (tiles + WINOGRAD_TILES - 1) / WINOGRAD_TILES;
+    detail::parallelFor(0, groups, 1, [&](size_t begin, size_t end)
+    {
+        std::vector<T> v(16 * WINOGRAD_TILES * channels);
+        std::vector<T> m(16 * WINOGRAD_TILES * count);
+        for (size_t group=begin; group<end; group++)
+        {
+            size_t first = group * WINOGRAD_TILES;
+            size_t size = std::min(WINOGRAD_TILES, tiles - first);
+            for (size_t t=0; t<size; t++)
+            {
+                size_t n = (first + t) / (tileRows * tileCols);
+                size_t position = (first + t) % (tileRows * tileCols);
+                ptrdiff_t y0 = static_cast<ptrdiff_t>(2 * (position / tileCols)) - static_cast<ptrdiff_t>(padding);
+                ptrdiff_t x0 = static_cast<ptrdiff_t>(2 * (position % tileCols)) - static_cast<ptrdiff_t>(padding);
+                detail::winogradInputTile(image, n, y0, x0, t, size, v.data());
+            }
+            for (size_t e=0; e<16; e++)
+            {
+                detail::gemm(Transpose::No, Transpose::No, size, count, channels, T(1),
+                             v.data() + e * size * channels, channels, u.data() + e * channels * count, count,
+                             T(0), m.data() + e * size * count, count);
+            }
+            for (size_t t=0; t<size; t++)
+            {
+                size_t n = (first + t) / (tileRows * tileCols);
+                size_t position = (first + t) % (tileRows * tileCols);
+                size_t y = 2 * (position / tileCols);
+                size_t x = 2 * (position % tileCols);
+                detail::winogradOutputTile(m.data(), t, size, count,
+                                           out + ((n * outHeight + y) * outWidth + x) * count, outWidth,
+                                           std::min<size_t>(2, outHeight - y), std::min<size_t>(2, outWidth - x));
+            }
+        }
+    });
+    return res;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_CONVOLUTION_H
@@ -0,0 +1,331 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_DATAFLOW_H
+#define MATRIX_DATAFLOW_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+// Rows of a tile of a pipelined chain of products. Every tile moves through
+// all the products on its own.
+const size_t DATAFLOW_ROWS = 256;
+
+/**
+ * @brief Runs tasks as soon as the tasks they depend on are done.
+ *
+ * Tasks are added with the list of earlier tasks they wait for, so the
+ * graph cannot have cycles. run() executes them out of order on the thread
+ * pool and the calling thread. Among ready tasks, the one with the highest
+ * priority runs first, then the one added first. Threads without a ready task
+ * sleep on a condition variable.
+ *
+ * This is the runtime behind the tile-level algorithms of the library, such
+ * as multiplyChain() and the LU factorization, where the next step starts on
+ * the tiles which are ready instead of waiting for the whole previous step.
+ *
+ *
+ * @example
+ *
+ * #include "dataflow.h"
+ *
+ * linalg::Dataflow flow;
+ * auto load = flow.add([&] { readInput(); });
+ * auto left = flow.add([&] { processLeft(); }, {load});
+ * auto right = flow.add([&] { processRight(); }, {load});
+ * flow.add([&] { combine(); }, {left, right});
+ * flow.run(); // processLeft and processRight run concurrently
+ */
+class Dataflow
+{
+public:
+    typedef size_t Task;
+
+   /**
+    * @brief Adds a task.
+    *
+    * @param work - The function to run.
+    * @param after - Tasks which should be done before this one starts.
+    * @param priority - Tasks with a higher priority are preferred when several are ready.
+    * @return The new task.
+    */
+    Task add(std::function<void()> work, const std::vector<Task>& after = std::vector<Task>(), int priority = 0)
+    {
+        Task task = m_nodes.size();
+        for (Task before : after)
+        {
+            if (before >= task)
+            {
+                std::cerr << "Dataflow - Dependency does not exist" << std::endl;
+                std::abort();
+            }
+            m_nodes[before].dependents.push_back(task);
+        }
+        m_nodes.push_back(Node{std::move(work), std::vector<Task>(), after.size(), priority});
+        return task;
+    }
+
+   /**
+    * @brief Returns the number of tasks.
+    */
+    size_t size() const
+    {
+        return m_nodes.size();
+    }
+
+   /**
+    * @brief Runs every task and returns when all are done. The graph can be
+    * run again.
+    */
+    void run()
+    {
+        std::shared_ptr<RunState> state = std::make_shared<RunState>();
+        state->waiting.resize(m_nodes.size());
+        state->remaining = m_nodes.size();
+        for (Task task=0; task<m_nodes.size(); task++)
+        {
+            state->waiting[task] = m_nodes[task].inputs;
+            if (m_nodes[task].inputs == 0)
+            {
+                state->ready.push(Ready{m_nodes[task].priority, task});
+            }
+        }
+
+        if (getNumThreads() > 1)
+        {
+            ThreadPool::instance().reserve(getNumThreads() - 1);
+        }
+        startRunners(state, state->ready.size());
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (state->remaining > 0)
+        {
+            if (state->ready.empty())
+            {
+                state->changed.wait(lock);
+                continue;
+            }
+            Task task = state->ready.top().task;
+            state->ready.pop();
+            lock.unlock();
+            execute(state, task);
+            lock.lock();
+        }
+    }
+
+private:
+    struct Node
+    {
+        std::function<void()> work;
+        std::vector<Task> dependents;
+        size_t inputs;
+        int priority;
+    };
+
+    struct Ready
+    {
+        int priority;
+        Task task;
+
+        // Orders the queue by priority, then by the order tasks were added.
+        bool operator< (const Ready& other) const
+        {
+            return priority < other.priority || (priority == other.priority && task > other.task);
+        }
+    };
+
+    // Progress of one call to run(), shared with the pool tasks, which may
+    // outlive it.
+    struct RunState
+    {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::priority_queue<Ready> ready;
+        std::vector<size_t> waiting;
+        size_t remaining{0};
+    };
+
+    // Queues one pool task per newly ready task. Each runs the best ready
+    // task, if the calling thread has not taken it already.
+    void startRunners(const std::shared_ptr<RunState>& state, size_t count)
+    {
+        if (getNumThreads() == 1)
+        {
+            return;
+        }
+        count = std::min(count, getNumThreads() - 1);
+        for (size_t i=0; i<count; i++)
+        {
+            ThreadPool::instance().enqueue([this, state]()
+            {
+                Task task;
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (state->ready.empty())
+                    {
+                        return;
+                    }
+                    task = state->ready.top().task;
+                    state->ready.pop();
+                }
+                execute(state, task);
+            });
+        }
+    }
+
+    void execute(const std::shared_ptr<RunState>& state, Task task)
+    {
+        m_nodes[task].work();
+
+        size_t released = 0;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            for (Task dependent : m_nodes[task].dependents)
+            {
+                if (--state->waiting[dependent] == 0)
+                {
+                    state->ready.push(Ready{m_nodes[dependent].priority, dependent});
+                    released++;
+                }
+            }
+            state->remaining--;
+        }
+        state->changed.notify_all();
+        startRunners(state, released);
+    }
+
+    std::vector<Node> m_nodes;
+};
+
+/**
+ * @brief Returns f(...f(f(X W1) W2)...) Wn, a chain of products with an
+ * element-wise function between them, such as the forward pass of a
+ * multilayer perceptron.
+ *
+ * The rows of X are split into tiles of DATAFLOW_ROWS which go through the
+ * chain independently: the product of a tile with W2 starts as soon as that
+ * tile has gone through W1, while other tiles are still in the first product.
+ * There is no barrier between consecutive products. Every weight Matrix
+ * object is packed once, and the function is applied while the tile is still
+ * in cache.
+ *
+ *
+ * @example
+ *
+ * #include "dataflow.h"
+ *
+ * std::vector<linalg::Matrix<float>> layers{W1, W2, W3};
+ * linalg::Matrix<float> scores{linalg::multiplyChain(X, layers, [](float x) { return x > 0 ? x : 0.0f; })};
+ *
+ *
+ * @param input - Matrix object X.
+ * @param weights - Matrix objects W1 ... Wn, each with as many rows as the previous one has columns.
+ * @param function - Element-wise function applied after every product but the last.
+ * @return The result of the last product.
+ */
+template <typename T, typename Function>
+Matrix<T> multiplyChain(const Matrix<T>& input, const std::vector<Matrix<T>>& weights, const Function& function)
+{
+    if (weights.empty())
+    {
+        return input;
+    }
+    size_t width = input.cols();
+    for (const Matrix<T>& w : weights)
+    {
+        detail::checkProductSize(width, w.rows());
+        width = w.cols();
+    }
+
+    size_t m = input.rows();
+    size_t layers = weights.size();
+    std::vector<std::unique_ptr<detail::PackedRhs<T>>> packed(layers);
+    std::vector<Matrix<T>> outputs;
+    for (size_t l=0; l<layers; l++)
+    {
+        outputs.emplace_back(m, weights[l].cols());
+    }
+
+    Dataflow flow;
+    std::vector<Dataflow::Task> packs;
+    for (size_t l=0; l<layers; l++)
+    {
+        const Matrix<T>* w = &weights[l];
+        std::unique_ptr<detail::PackedRhs<T>>* slot = &packed[l];
+        packs.push_back(flow.add([w, slot]()
+        {
+            slot->reset(new detail::PackedRhs<T>(w->rows(), w->cols(), detail::RowMajorAccess<T>{w->data(), w->cols()}));
+        }, std::vector<Dataflow::Task>(), 1));
+    }
+
+    for (size_t i0=0; i0<m; i0+=DATAFLOW_ROWS)
+    {
+        size_t rows = std::min(DATAFLOW_ROWS, m - i0);
+        std::vector<Dataflow::Task> previous;
+        for (size_t l=0; l<layers; l++)
+        {
+            const Matrix<T>& src = (l == 0) ? input : outputs[l - 1];
+            Matrix<T>& dst = outputs[l];
+            const std::unique_ptr<detail::PackedRhs<T>>& b = packed[l];
+            bool last = (l + 1 == layers);
+            previous.push_back(packs[l]);
+            // Deeper layers first, so finished tiles leave the pipeline.
+            Dataflow::Task task = flow.add([&src, &dst, &b, &function, i0, rows, last]()
+            {
+                size_t n = dst.cols();
+                T* c = dst.data() + i0 * n;
+                detail::RowMajorAccess<T> a{src.data() + i0 * src.cols(), src.cols()};
+                if (last)
+                {
+                    detail::gemmPacked(rows, T(1), a, *b, T(0), c, n, detail::NoEpilogue());
+                    return;
+                }
+                detail::gemmPacked(rows, T(1), a, *b, T(0), c, n, [c, n, &function](size_t begin, size_t end)
+                {
+                    for (size_t e=begin*n; e<end*n; e++)
+                    {
+                        c[e] = function(c[e]);
+                    }
+                });
+            }, previous, static_cast<int>(l));
+            previous.assign(1, task);
+        }
+    }
+    flow.run();
+    return std::move(outputs.back());
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_DATAFLOW_H
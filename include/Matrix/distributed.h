@@ -0,0 +1,802 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_DISTRIBUTED_H
+#define MATRIX_DISTRIBUTED_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "transport.h"
+
+
+namespace linalg
+{
+// Widest k panel broadcast by one step of summa().
+const size_t SUMMA_PANEL = 256;
+
+/**
+ * @brief A rows x cols grid of processes. Process (row, col) has rank
+ * row * cols + col. Processes of the transport beyond the grid hold no data.
+ */
+struct ProcessGrid
+{
+    size_t rows;
+    size_t cols;
+
+    size_t size() const
+    {
+        return rows * cols;
+    }
+
+    size_t rank(size_t row, size_t col) const
+    {
+        return row * cols + col;
+    }
+
+    // Ranks of the processes in one row of the grid.
+    std::vector<size_t> rowGroup(size_t row) const
+    {
+        std::vector<size_t> res(cols);
+        for (size_t c=0; c<cols; c++)
+        {
+            res[c] = rank(row, c);
+        }
+        return res;
+    }
+
+    // Ranks of the processes in one column of the grid.
+    std::vector<size_t> colGroup(size_t col) const
+    {
+        std::vector<size_t> res(rows);
+        for (size_t r=0; r<rows; r++)
+        {
+            res[r] = rank(r, col);
+        }
+        return res;
+    }
+};
+
+namespace detail
+{
+// Tags of the messages of the distributed operations.
+const int DISTRIBUTED_SCATTER_TAG = TRANSPORT_RESERVED_TAG - 10;
+const int DISTRIBUTED_GATHER_TAG = TRANSPORT_RESERVED_TAG - 11;
+const int SUMMA_TAG_A = TRANSPORT_RESERVED_TAG - 12;
+const int SUMMA_TAG_B = TRANSPORT_RESERVED_TAG - 13;
+const int CANNON_TAG_SKEW_A = TRANSPORT_RESERVED_TAG - 14;
+const int CANNON_TAG_SKEW_B = TRANSPORT_RESERVED_TAG - 15;
+const int CANNON_TAG_A = TRANSPORT_RESERVED_TAG - 16;
+const int CANNON_TAG_B = TRANSPORT_RESERVED_TAG - 17;
+const int CANNON_TAG_C = TRANSPORT_RESERVED_TAG - 18;
+const int DISTRIBUTED_TRANSPOSE_TAG = TRANSPORT_RESERVED_TAG - 19;
+const int CANNON_TAG_REPLICATE_A = TRANSPORT_RESERVED_TAG - 20;
+const int CANNON_TAG_REPLICATE_B = TRANSPORT_RESERVED_TAG - 21;
+
+// First index of block part when n indices are split into parts blocks
+// whose sizes differ by at most one.
+inline size_t blockBegin(size_t n, size_t parts, size_t part)
+{
+    return part * n / parts;
+}
+
+// Block which holds index i.
+inline size_t blockOwner(size_t n, size_t parts, size_t i)
+{
+    size_t part = parts - 1;
+    while (blockBegin(n, parts, part) > i)
+    {
+        part--;
+    }
+    return part;
+}
+} // namespace detail
+
+/**
+ * @brief A matrix split into blocks over a 2D grid of processes.
+ *
+ * Rows are split into grid.rows blocks and columns into grid.cols blocks,
+ * with sizes which differ by at most one, and process (r, c) of the grid
+ * stores block (r, c) as an ordinary Matrix object. Nothing is replicated,
+ * so a matrix can be as large as the memory of all the processes together.
+ *
+ *
+ * @example
+ *
+ * #include "distributed.h"
+ *
+ * linalg::runProcesses(4, [&](linalg::Transport& transport)
+ * {
+ *     linalg::ProcessGrid grid{2, 2};
+ *     auto A = linalg::scatter(transport, grid, global, 0); // global is read on rank 0 only
+ *     A.local() *= 2.0;                                      // each process scales its block
+ *     linalg::Matrix<double> res{A.gather(0)};               // the whole matrix on rank 0
+ *     return 0;
+ * });
+ */
+template <typename T>
+class DistributedMatrix
+{
+public:
+   /**
+    * @brief Constructs a distributed matrix of zeros. Every process of the
+    * grid holds its block.
+    *
+    * @param transport - Transport of the calling process. It should outlive the object.
+    * @param grid - Process grid, with at most transport.size() processes.
+    * @param rows - Number of rows of the whole matrix.
+    * @param cols - Number of columns of the whole matrix.
+    */
+    DistributedMatrix(Transport& transport, const ProcessGrid& grid, size_t rows, size_t cols)
+        : m_transport{&transport}, m_grid(grid), m_rows{rows}, m_cols{cols}, m_local(0, 0)
+    {
+        if (grid.size() == 0 || grid.size() > transport.size())
+        {
+            std::cerr << "Distributed matrix - Process grid does not fit the transport" << std::endl;
+            std::abort();
+        }
+        if (inGrid())
+        {
+            m_local = Matrix<T>(rowBegin(gridRow() + 1) - rowBegin(gridRow()),
+                                colBegin(gridCol() + 1) - colBegin(gridCol()));
+        }
+    }
+
+    size_t rows() const
+    {
+        return m_rows;
+    }
+
+    size_t cols() const
+    {
+        return m_cols;
+    }
+
+    const ProcessGrid& grid() const
+    {
+        return m_grid;
+    }
+
+    Transport& transport() const
+    {
+        return *m_transport;
+    }
+
+   /**
+    * @brief Returns whether the calling process holds a block.
+    */
+    bool inGrid() const
+    {
+        return m_transport->rank() < m_grid.size();
+    }
+
+    size_t gridRow() const
+    {
+        return m_transport->rank() / m_grid.cols;
+    }
+
+    size_t gridCol() const
+    {
+        return m_transport->rank() % m_grid.cols;
+    }
+
+   /**
+    * @brief Returns the first row of the blocks in a row of the grid.
+    * rowBegin(grid().rows) is rows().
+    */
+    size_t rowBegin(size_t gridRow) const
+    {
+        return detail::blockBegin(m_rows, m_grid.rows, gridRow);
+    }
+
+   /**
+    * @brief Returns the first column of the blocks in a column of the grid.
+    * colBegin(grid().cols) is cols().
+    */
+    size_t colBegin(size_t gridCol) const
+    {
+        return detail::blockBegin(m_cols, m_grid.cols, gridCol);
+    }
+
+   /**
+    * @brief Returns the block of the calling process, which is empty outside
+    * the grid.
+    */
+    Matrix<T>& local()
+    {
+        return m_local;
+    }
+
+    const Matrix<T>& local() const
+    {
+        return m_local;
+    }
+
+   /**
+    * @brief Collects the whole matrix on one process. Every process of the
+    * grid and the root call it.
+    *
+    * @param root - Rank which receives the matrix.
+    * @return The matrix on root, an empty Matrix object elsewhere.
+    */
+    Matrix<T> gather(size_t root) const
+    {
+        Transport& transport = *m_transport;
+        if (transport.rank() != root)
+        {
+            if (inGrid())
+            {
+                transport.send(root, detail::DISTRIBUTED_GATHER_TAG, m_local.data(),
+                               m_local.rows() * m_local.cols() * sizeof(T));
+            }
+            return Matrix<T>(0, 0);
+        }
+
+        Matrix<T> res(m_rows, m_cols);
+        std::vector<T> block;
+        for (size_t r=0; r<m_grid.rows; r++)
+        {
+            for (size_t c=0; c<m_grid.cols; c++)
+            {
+                size_t blockRows = rowBegin(r + 1) - rowBegin(r);
+                size_t blockCols = colBegin(c + 1) - colBegin(c);
+                const T* src = m_local.data();
+                if (m_grid.rank(r, c) != root)
+                {
+                    block.resize(blockRows * blockCols);
+                    transport.recv(m_grid.rank(r, c), detail::DISTRIBUTED_GATHER_TAG, block.data(),
+                                   block.size() * sizeof(T));
+                    src = block.data();
+                }
+                for (size_t i=0; i<blockRows; i++)
+                {
+                    std::copy(src + i * blockCols, src + (i + 1) * blockCols,
+                              res.data() + (rowBegin(r) + i) * m_cols + colBegin(c));
+                }
+            }
+        }
+        return res;
+    }
+
+   /**
+    * @brief Returns the transpose, distributed over the same grid. Every
+    * process of the grid calls it.
+    *
+    * Block (r, c) of the result is made of pieces of the blocks of every
+    * process whose rows meet its columns and whose columns meet its rows,
+    * so this is an all-to-all exchange. Each process transposes the piece
+    * for each destination while packing it and sends it at once, then
+    * transposes its own piece while the messages are in flight, then
+    * copies the pieces it receives into place.
+    *
+    *
+    * @example
+    *
+    * auto A = linalg::scatter(transport, linalg::ProcessGrid{2, 3}, global, 0);
+    * linalg::Matrix<double> res{A.transpose().gather(0)}; // global.transpose() on rank 0
+    *
+    *
+    * @return The transpose.
+    */
+    DistributedMatrix<T> transpose() const
+    {
+        Transport& transport = *m_transport;
+        DistributedMatrix<T> res(transport, m_grid, m_cols, m_rows);
+        if (!inGrid())
+        {
+            return res;
+        }
+        size_t count = m_grid.size();
+        size_t me = transport.rank();
+        std::vector<T> buffer;
+
+        // Rows [i0, i1) and columns [j0, j1) of this matrix held by process
+        // source here and by process dest in the result. Empty when i0 >= i1
+        // or j0 >= j1.
+        auto piece = [&](size_t source, size_t dest, size_t& i0, size_t& i1, size_t& j0, size_t& j1)
+        {
+            size_t sourceRow = source / m_grid.cols;
+            size_t sourceCol = source % m_grid.cols;
+            size_t destRow = dest / m_grid.cols;
+            size_t destCol = dest % m_grid.cols;
+            i0 = std::max(rowBegin(sourceRow), res.colBegin(destCol));
+            i1 = std::min(rowBegin(sourceRow + 1), res.colBegin(destCol + 1));
+            j0 = std::max(colBegin(sourceCol), res.rowBegin(destRow));
+            j1 = std::min(colBegin(sourceCol + 1), res.rowBegin(destRow + 1));
+            return i0 < i1 && j0 < j1;
+        };
+        size_t i0, i1, j0, j1;
+        size_t rowFirst = rowBegin(gridRow());
+        size_t colFirst = colBegin(gridCol());
+
+        // Starting from the next rank spreads the first messages over all
+        // the receivers.
+        for (size_t shift=1; shift<count; shift++)
+        {
+            size_t dest = (me + shift) % count;
+            if (piece(me, dest, i0, i1, j0, j1))
+            {
+                buffer.resize((i1 - i0) * (j1 - j0));
+                detail::transposeBlock(i1 - i0, j1 - j0, m_local.data() + (i0 - rowFirst) * m_local.cols() + j0 - colFirst,
+                                       m_local.cols(), buffer.data(), i1 - i0);
+                transport.send(dest, detail::DISTRIBUTED_TRANSPOSE_TAG, buffer.data(), buffer.size() * sizeof(T));
+            }
+        }
+
+        Matrix<T>& out = res.local();
+        size_t outRowFirst = res.rowBegin(res.gridRow());
+        size_t outColFirst = res.colBegin(res.gridCol());
+        if (piece(me, me, i0, i1, j0, j1))
+        {
+            detail::transposeBlock(i1 - i0, j1 - j0, m_local.data() + (i0 - rowFirst) * m_local.cols() + j0 - colFirst,
+                                   m_local.cols(), out.data() + (j0 - outRowFirst) * out.cols() + i0 - outColFirst,
+                                   out.cols());
+        }
+
+        for (size_t shift=1; shift<count; shift++)
+        {
+            size_t source = (me + count - shift) % count;
+            if (piece(source, me, i0, i1, j0, j1))
+            {
+                buffer.resize((i1 - i0) * (j1 - j0));
+                transport.recv(source, detail::DISTRIBUTED_TRANSPOSE_TAG, buffer.data(), buffer.size() * sizeof(T));
+                for (size_t j=j0; j<j1; j++)
+                {
+                    std::copy(buffer.data() + (j - j0) * (i1 - i0), buffer.data() + (j - j0 + 1) * (i1 - i0),
+                              out.data() + (j - outRowFirst) * out.cols() + i0 - outColFirst);
+                }
+            }
+        }
+        return res;
+    }
+
+private:
+    Transport* m_transport;
+    ProcessGrid m_grid;
+    size_t m_rows;
+    size_t m_cols;
+    Matrix<T> m_local;
+};
+
+/**
+ * @brief Splits a Matrix object held by one process over a process grid.
+ * Every process of the transport calls it.
+ *
+ * @param transport - Transport of the calling process.
+ * @param grid - Process grid of the result.
+ * @param global - The matrix. Only read on root, so other processes can pass an empty one.
+ * @param root - Rank which holds the matrix.
+ * @return The block of the calling process.
+ */
+template <typename T>
+DistributedMatrix<T> scatter(Transport& transport, const ProcessGrid& grid, const Matrix<T>& global, size_t root)
+{
+    uint64_t shape[2] = {global.rows(), global.cols()};
+    std::vector<size_t> everyone(transport.size());
+    for (size_t p=0; p<everyone.size(); p++)
+    {
+        everyone[p] = p;
+    }
+    broadcast(transport, everyone, root, shape, sizeof(shape), detail::DISTRIBUTED_SCATTER_TAG);
+
+    DistributedMatrix<T> res(transport, grid, shape[0], shape[1]);
+    if (transport.rank() == root)
+    {
+        std::vector<T> block;
+        for (size_t r=0; r<grid.rows; r++)
+        {
+            for (size_t c=0; c<grid.cols; c++)
+            {
+                size_t blockRows = res.rowBegin(r + 1) - res.rowBegin(r);
+                size_t blockCols = res.colBegin(c + 1) - res.colBegin(c);
+                block.resize(blockRows * blockCols);
+                for (size_t i=0; i<blockRows; i++)
+                {
+                    const T* src = global.data() + (res.rowBegin(r) + i) * global.cols() + res.colBegin(c);
+                    std::copy(src, src + blockCols, block.data() + i * blockCols);
+                }
+                if (grid.rank(r, c) == root)
+                {
+                    std::copy(block.begin(), block.end(), res.local().data());
+                }
+                else
+                {
+                    transport.send(grid.rank(r, c), detail::DISTRIBUTED_SCATTER_TAG, block.data(),
+                                   block.size() * sizeof(T));
+                }
+            }
+        }
+    }
+    else if (res.inGrid())
+    {
+        transport.recv(root, detail::DISTRIBUTED_SCATTER_TAG, res.local().data(),
+                       res.local().rows() * res.local().cols() * sizeof(T));
+    }
+    return res;
+}
+
+namespace detail
+{
+// Boundaries of the k panels of summa(). A panel never crosses a block of
+// the columns of A or the rows of B, so it has a single owner in each.
+inline std::vector<size_t> summaSteps(size_t k, const ProcessGrid& grid)
+{
+    std::vector<size_t> edges;
+    for (size_t c=0; c<=grid.cols; c++)
+    {
+        edges.push_back(blockBegin(k, grid.cols, c));
+    }
+    for (size_t r=0; r<=grid.rows; r++)
+    {
+        edges.push_back(blockBegin(k, grid.rows, r));
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::vector<size_t> steps{0};
+    for (size_t e=1; e<edges.size(); e++)
+    {
+        size_t width = edges[e] - edges[e - 1];
+        size_t count = (width + SUMMA_PANEL - 1) / SUMMA_PANEL;
+        for (size_t s=1; s<=count; s++)
+        {
+            steps.push_back(edges[e - 1] + s * width / count);
+        }
+    }
+    return steps;
+}
+} // namespace detail
+
+/**
+ * @brief Multiplies two distributed matrices with the SUMMA algorithm.
+ *
+ * The inner dimension is walked in panels. For each panel, the processes
+ * holding it broadcast their part of the columns of A along their grid row
+ * and their part of the rows of B along their grid column, and every process
+ * adds the product of the two panels it received to its block of C. Each
+ * process sends O(n^2 / sqrt(p)) elements and never holds more than two
+ * panels of each operand besides its blocks.
+ *
+ * The owners of the next panel send it before multiplying the current one,
+ * and the transport receives in the background, so communication overlaps
+ * with the local products. Every process of the grid calls it.
+ *
+ *
+ * @example
+ *
+ * #include "distributed.h"
+ *
+ * linalg::runProcesses(6, [&](linalg::Transport& transport)
+ * {
+ *     linalg::ProcessGrid grid{2, 3};
+ *     auto A = linalg::scatter(transport, grid, globalA, 0);
+ *     auto B = linalg::scatter(transport, grid, globalB, 0);
+ *     auto C = linalg::summa(A, B);
+ *     linalg::Matrix<double> res{C.gather(0)}; // globalA * globalB on rank 0
+ *     return 0;
+ * });
+ *
+ *
+ * @param a - Left operand.
+ * @param b - Right operand, on the same transport and grid.
+ * @return The product, on the same grid.
+ */
+template <typename T>
+DistributedMatrix<T> summa(const DistributedMatrix<T>& a, const DistributedMatrix<T>& b)
+{
+    if (a.cols() != b.rows())
+    {
+        std::cerr << "SUMMA - Matrix dimension do not match" << std::endl;
+        std::abort();
+    }
+    if (&a.transport() != &b.transport() || a.grid().rows != b.grid().rows || a.grid().cols != b.grid().cols)
+    {
+        std::cerr << "SUMMA - Operands are not on the same process grid" << std::endl;
+        std::abort();
+    }
+
+    Transport& transport = a.transport();
+    const ProcessGrid& grid = a.grid();
+    DistributedMatrix<T> c(transport, grid, a.rows(), b.cols());
+    if (!c.inGrid())
+    {
+        return c;
+    }
+
+    size_t k = a.cols();
+    size_t row = c.gridRow();
+    size_t col = c.gridCol();
+    size_t m = c.local().rows();
+    size_t n = c.local().cols();
+    std::vector<size_t> rowGroup{grid.rowGroup(row)};
+    std::vector<size_t> colGroup{grid.colGroup(col)};
+    std::vector<size_t> steps{detail::summaSteps(k, grid)};
+    std::vector<T> panelA[2];
+    std::vector<T> panelB[2];
+
+    // Copies the parts of panel s held by this process and broadcasts them,
+    // either as the owner or as a receiver.
+    auto share = [&](size_t s, bool owner)
+    {
+        size_t k0 = steps[s];
+        size_t width = steps[s + 1] - k0;
+        size_t ownerA = detail::blockOwner(k, grid.cols, k0);
+        size_t ownerB = detail::blockOwner(k, grid.rows, k0);
+        std::vector<T>& bufA = panelA[s % 2];
+        std::vector<T>& bufB = panelB[s % 2];
+        if ((ownerA == col) == owner)
+        {
+            bufA.resize(m * width);
+            if (owner)
+            {
+                const Matrix<T>& src = a.local();
+                for (size_t i=0; i<m; i++)
+                {
+                    const T* from = src.data() + i * src.cols() + (k0 - a.colBegin(col));
+                    std::copy(from, from + width, bufA.data() + i * width);
+                }
+            }
+            broadcast(transport, rowGroup, ownerA, bufA.data(), bufA.size() * sizeof(T), detail::SUMMA_TAG_A);
+        }
+        if ((ownerB == row) == owner)
+        {
+            bufB.resize(width * n);
+            if (owner)
+            {
+                const T* from = b.local().data() + (k0 - b.rowBegin(row)) * n;
+                std::copy(from, from + width * n, bufB.data());
+            }
+            broadcast(transport, colGroup, ownerB, bufB.data(), bufB.size() * sizeof(T), detail::SUMMA_TAG_B);
+        }
+    };
+
+    if (steps.size() > 1)
+    {
+        share(0, true);
+    }
+    for (size_t s=0; s+1<steps.size(); s++)
+    {
+        share(s, false);
+        if (s + 2 < steps.size())
+        {
+            share(s + 1, true);
+        }
+        size_t width = steps[s + 1] - steps[s];
+        detail::gemm(Transpose::No, Transpose::No, m, n, width, T(1), panelA[s % 2].data(), width,
+                     panelB[s % 2].data(), n, T(1), c.local().data(), n);
+    }
+    return c;
+}
+
+namespace detail
+{
+/*
+ * Cannon's algorithm on layers copies of a q x q grid. Process (i, j) of
+ * layer l has rank l * q * q + i * q + j, and layer 0 is the grid of the
+ * operands. The blocks of layer 0 are broadcast to the other layers, each
+ * layer skews them by its own offset and runs the Cannon steps
+ * [blockBegin(q, layers, l), blockBegin(q, layers, l + 1)), and the partial
+ * products of the layers are summed on layer 0. The broadcast and the sum go
+ * along binomial trees, so they cost log2(layers) messages per process. With
+ * one layer this is plain Cannon.
+ */
+template <typename T>
+DistributedMatrix<T> cannonLayers(const DistributedMatrix<T>& a, const DistributedMatrix<T>& b, size_t layers,
+                                  const char* name)
+{
+    if (a.cols() != b.rows())
+    {
+        std::cerr << name << " - Matrix dimension do not match" << std::endl;
+        std::abort();
+    }
+    if (&a.transport() != &b.transport() || a.grid().rows != b.grid().rows || a.grid().cols != b.grid().cols)
+    {
+        std::cerr << name << " - Operands are not on the same process grid" << std::endl;
+        std::abort();
+    }
+    size_t q = a.grid().rows;
+    if (a.grid().cols != q || layers == 0 || layers > q || layers * q * q > a.transport().size())
+    {
+        std::cerr << name << " - Needs a square grid of q x q processes and layers * q * q processes, "
+                  << "with at most q layers" << std::endl;
+        std::abort();
+    }
+
+    Transport& transport = a.transport();
+    DistributedMatrix<T> c(transport, a.grid(), a.rows(), b.cols());
+    size_t rank = transport.rank();
+    if (rank >= layers * q * q)
+    {
+        return c;
+    }
+    size_t layer = rank / (q * q);
+    size_t i = rank % (q * q) / q;
+    size_t j = rank % q;
+    size_t k = a.cols();
+    size_t m = a.rowBegin(i + 1) - a.rowBegin(i);
+    size_t n = b.colBegin(j + 1) - b.colBegin(j);
+    auto width = [&](size_t block) { return blockBegin(k, q, block + 1) - blockBegin(k, q, block); };
+    auto at = [&](size_t l, size_t row, size_t col) { return l * q * q + row * q + col; };
+
+    size_t first = blockBegin(q, layers, layer);
+    size_t steps = blockBegin(q, layers, layer + 1) - first;
+
+    // Every layer gets a copy of the blocks of layer 0, along a tree over
+    // the processes (i, j) of all the layers.
+    std::vector<size_t> fiber(layers);
+    for (size_t l=0; l<layers; l++)
+    {
+        fiber[l] = at(l, i, j);
+    }
+    std::vector<T> ownA(m * width(j));
+    std::vector<T> ownB(width(i) * n);
+    if (layer == 0)
+    {
+        std::copy(a.local().data(), a.local().data() + ownA.size(), ownA.data());
+        std::copy(b.local().data(), b.local().data() + ownB.size(), ownB.data());
+    }
+    broadcast(transport, fiber, 0, ownA.data(), ownA.size() * sizeof(T), CANNON_TAG_REPLICATE_A);
+    broadcast(transport, fiber, 0, ownB.data(), ownB.size() * sizeof(T), CANNON_TAG_REPLICATE_B);
+
+    // Skew inside the layer, so that process (i, j) starts with
+    // A(i, i + j + first) and B(i + j + first, j).
+    size_t block = (i + j + first) % q;
+    std::vector<T> panelA(m * width(block));
+    std::vector<T> panelB(width(block) * n);
+    size_t destA = at(layer, i, (j + 2 * q - i - first) % q);
+    size_t destB = at(layer, (i + 2 * q - j - first) % q, j);
+    if (destA == rank)
+    {
+        panelA.swap(ownA);
+    }
+    else
+    {
+        transport.send(destA, CANNON_TAG_SKEW_A, ownA.data(), ownA.size() * sizeof(T));
+        transport.recv(at(layer, i, block), CANNON_TAG_SKEW_A, panelA.data(), panelA.size() * sizeof(T));
+    }
+    if (destB == rank)
+    {
+        panelB.swap(ownB);
+    }
+    else
+    {
+        transport.send(destB, CANNON_TAG_SKEW_B, ownB.data(), ownB.size() * sizeof(T));
+        transport.recv(at(layer, block, j), CANNON_TAG_SKEW_B, panelB.data(), panelB.size() * sizeof(T));
+    }
+
+    Matrix<T> partial(layer == 0 ? 0 : m, layer == 0 ? 0 : n);
+    T* out = (layer == 0) ? c.local().data() : partial.data();
+    for (size_t step=0; step<steps; step++)
+    {
+        // The blocks move on before they are used, so the transfer runs
+        // while this process multiplies.
+        if (step + 1 < steps)
+        {
+            transport.send(at(layer, i, (j + q - 1) % q), CANNON_TAG_A, panelA.data(), panelA.size() * sizeof(T));
+            transport.send(at(layer, (i + q - 1) % q, j), CANNON_TAG_B, panelB.data(), panelB.size() * sizeof(T));
+        }
+        if (width(block) > 0)
+        {
+            gemm(Transpose::No, Transpose::No, m, n, width(block), T(1), panelA.data(), width(block),
+                 panelB.data(), n, T(1), out, n);
+        }
+        if (step + 1 < steps)
+        {
+            block = (block + 1) % q;
+            panelA.resize(m * width(block));
+            panelB.resize(width(block) * n);
+            transport.recv(at(layer, i, (j + 1) % q), CANNON_TAG_A, panelA.data(), panelA.size() * sizeof(T));
+            transport.recv(at(layer, (i + 1) % q, j), CANNON_TAG_B, panelB.data(), panelB.size() * sizeof(T));
+        }
+    }
+
+    // The partial products are summed into layer 0 along the same tree.
+    reduceSum(transport, fiber, 0, out, m * n, CANNON_TAG_C);
+    return c;
+}
+} // namespace detail
+
+/**
+ * @brief Multiplies two distributed matrices on a square process grid with
+ * Cannon's algorithm.
+ *
+ * The blocks are first skewed so that process (i, j) holds A(i, i + j) and
+ * B(i + j, j). Then, q times, every process multiplies its two blocks and
+ * passes its block of A to the left and its block of B upwards. Each process
+ * only talks to its neighbours and sends 2q blocks, about as many elements
+ * as summa(), in messages which never go through intermediate processes.
+ * Every process of the grid calls it.
+ *
+ *
+ * @example
+ *
+ * #include "distributed.h"
+ *
+ * linalg::runProcesses(9, [&](linalg::Transport& transport)
+ * {
+ *     linalg::ProcessGrid grid{3, 3};
+ *     auto A = linalg::scatter(transport, grid, globalA, 0);
+ *     auto B = linalg::scatter(transport, grid, globalB, 0);
+ *     linalg::Matrix<double> res{linalg::cannon(A, B).gather(0)};
+ *     return 0;
+ * });
+ *
+ *
+ * @param a - Left operand, on a q x q grid.
+ * @param b - Right operand, on the same transport and grid.
+ * @return The product, on the same grid.
+ */
+template <typename T>
+DistributedMatrix<T> cannon(const DistributedMatrix<T>& a, const DistributedMatrix<T>& b)
+{
+    return detail::cannonLayers(a, b, 1, "Cannon");
+}
+
+/**
+ * @brief Multiplies two distributed matrices with the 2.5D algorithm, which
+ * trades memory for communication.
+ *
+ * The operands are on a q x q grid. The processes of the transport beyond
+ * the grid form layers - 1 more copies of it. The blocks are broadcast to
+ * every layer along a tree, and each layer runs q / layers of the shifts of
+ * Cannon's algorithm. The partial products are then summed on the grid of
+ * the operands along the same tree. The busiest process sends about
+ * 2 q / layers + 2 log2(layers) blocks, against 2 q for cannon() on the
+ * same grid, at the cost of a copy of the blocks per layer. The layers split
+ * the shifts but add the broadcast, so it pays off once q / layers is large
+ * compared with log2(layers), and the total sent by all the processes does
+ * not shrink.
+ * Every process of the transport up to layers * q * q calls it.
+ *
+ *
+ * @example
+ *
+ * #include "distributed.h"
+ *
+ * linalg::runProcesses(8, [&](linalg::Transport& transport)
+ * {
+ *     linalg::ProcessGrid grid{2, 2};                        // ranks 4 to 7 form the second layer
+ *     auto A = linalg::scatter(transport, grid, globalA, 0);
+ *     auto B = linalg::scatter(transport, grid, globalB, 0);
+ *     linalg::Matrix<double> res{linalg::multiply25D(A, B, 2).gather(0)};
+ *     return 0;
+ * });
+ *
+ *
+ * @param a - Left operand, on a q x q grid.
+ * @param b - Right operand, on the same transport and grid.
+ * @param layers - Number of copies of the grid, from 1 to q. With 1 it is cannon().
+ * @return The product, on the grid of the operands.
+ */
+template <typename T>
+DistributedMatrix<T> multiply25D(const DistributedMatrix<T>& a, const DistributedMatrix<T>& b, size_t layers)
+{
+    return detail::cannonLayers(a, b, layers, "2.5D multiplication");
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_DISTRIBUTED_H
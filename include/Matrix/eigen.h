@@ -0,0 +1,560 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_EIGEN_H
+#define MATRIX_EIGEN_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "qr.h"
+#include "random.h"
+#include "reduction.h"
+
+
+namespace linalg
+{
+// Largest number of sweeps of the Jacobi eigenvalue algorithm.
+const size_t JACOBI_SWEEPS = 64;
+
+// Number of Lanczos steps between two convergence checks.
+const size_t LANCZOS_CHECK = 8;
+
+// Default number of iterations of powerIteration().
+const size_t POWER_ITERATIONS = 1000;
+
+/**
+ * @brief Eigenvalues and eigenvectors returned by the eigensolvers.
+ *
+ * values is a k x 1 Matrix object and vectors is n x k, with orthonormal
+ * columns in the same order. iterations is the number of applications of
+ * the operator and converged tells whether the tolerance was reached.
+ */
+template <typename T>
+struct Eigenpairs
+{
+    Matrix<T> values;
+    Matrix<T> vectors;
+    size_t iterations;
+    bool converged;
+};
+
+namespace detail
+{
+/*
+ * Cyclic Jacobi eigenvalue algorithm on the symmetric n x n buffer a, which
+ * ends up diagonal. The rotations are accumulated in v, which should start
+ * as the identity. Meant for the small projected matrices of the iterative
+ * solvers.
+ */
+template <typename T>
+void jacobiEigen(T* a, T* v, size_t n)
+{
+    T total = T(0);
+    for (size_t i=0; i<n*n; i++)
+    {
+        total += a[i] * a[i];
+    }
+    T eps = std::numeric_limits<T>::epsilon();
+
+    for (size_t sweep=0; sweep<JACOBI_SWEEPS; sweep++)
+    {
+        T off = T(0);
+        for (size_t p=0; p<n; p++)
+        {
+            for (size_t q=p+1; q<n; q++)
+            {
+                off += a[p * n + q] * a[p * n + q];
+            }
+        }
+        if (off <= eps * eps * total)
+        {
+            return;
+        }
+
+        for (size_t p=0; p<n; p++)
+        {
+            for (size_t q=p+1; q<n; q++)
+            {
+                T apq = a[p * n + q];
+                if (apq == T(0))
+                {
+                    continue;
+                }
+                T theta = (a[q * n + q] - a[p * n + p]) / (T(2) * apq);
+                T t = T(1) / (std::abs(theta) + std::sqrt(theta * theta + T(1)));
+                t = (theta < T(0)) ? -t : t;
+                T c = T(1) / std::sqrt(t * t + T(1));
+                T s = t * c;
+
+                for (size_t k=0; k<n; k++)
+                {
+                    T akp = a[k * n + p];
+                    T akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (size_t k=0; k<n; k++)
+                {
+                    T apk = a[p * n + k];
+                    T aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (size_t k=0; k<n; k++)
+                {
+                    T vkp = v[k * n + p];
+                    T vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Eigenpairs of the symmetric n x n Matrix object, as a permutation order of
+ * the columns of vectors by decreasing magnitude of the eigenvalues, or by
+ * decreasing value.
+ */
+template <typename T>
+void smallEigen(const Matrix<T>& mat, bool byMagnitude, std::vector<T>& values, Matrix<T>& vectors,
+                std::vector<size_t>& order)
+{
+    size_t n = mat.rows();
+    Matrix<T> work{mat};
+    vectors = Matrix<T>(n, n);
+    for (size_t i=0; i<n; i++)
+    {
+        vectors(i, i) = T(1);
+    }
+    jacobiEigen(work.data(), vectors.data(), n);
+
+    values.resize(n);
+    for (size_t i=0; i<n; i++)
+    {
+        values[i] = work(i, i);
+    }
+    order.resize(n);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs)
+    {
+        return byMagnitude ? std::abs(values[lhs]) > std::abs(values[rhs]) : values[lhs] > values[rhs];
+    });
+}
+
+// Copies the columns order[0, count) of src into a rows x count Matrix object.
+template <typename T>
+Matrix<T> selectColumns(const Matrix<T>& src, const std::vector<size_t>& order, size_t count)
+{
+    Matrix<T> res(src.rows(), count);
+    for (size_t i=0; i<src.rows(); i++)
+    {
+        for (size_t j=0; j<count; j++)
+        {
+            res(i, j) = src(i, order[j]);
+        }
+    }
+    return res;
+}
+
+// Deterministic starting block of n x b values in [-1, 1), the same for any
+// number of threads.
+template <typename T>
+Matrix<T> startBlock(size_t n, size_t b, size_t seed)
+{
+    return randomUniform<T>(n, b, T(-1), T(1), seed);
+}
+
+// Y = A X for a dense Matrix object, through the matrix multiplication kernel.
+template <typename T>
+struct DenseOperator
+{
+    const Matrix<T>& mat;
+
+    void operator() (const Matrix<T>& x, Matrix<T>& y) const
+    {
+        gemm(Transpose::No, Transpose::No, mat.rows(), x.cols(), mat.cols(), T(1), mat.data(), mat.cols(),
+             x.data(), x.cols(), T(0), y.data(), y.cols());
+    }
+};
+
+template <typename T>
+T dot(const T* lhs, const T* rhs, size_t n)
+{
+    T res = T(0);
+    gemv(Transpose::No, size_t(1), n, T(1), lhs, n, rhs, size_t(1), T(0), &res, size_t(1));
+    return res;
+}
+
+inline void checkEigenInput(size_t n, size_t k)
+{
+    if (k == 0 || k > n)
+    {
+        std::cerr << "Eigensolver - Number of eigenpairs should be between 1 and the size of the Matrix" << std::endl;
+        std::abort();
+    }
+}
+
+template <typename T>
+void checkSquareOperand(const Matrix<T>& mat)
+{
+    if (mat.rows() != mat.cols())
+    {
+        std::cerr << "Eigensolver - Matrix should be square" << std::endl;
+        std::abort();
+    }
+}
+// Default relative tolerance of the iterative solvers.
+constexpr double EIGEN_TOLERANCE = 1e-10;
+
+/*
+ * Relative tolerance of the iterative solvers: the given one, or
+ * EIGEN_TOLERANCE if 0, raised to 100 epsilon for types like float whose
+ * residuals never get that small.
+ */
+template <typename T>
+T eigenTolerance(double tolerance)
+{
+    if (tolerance > 0)
+    {
+        return static_cast<T>(tolerance);
+    }
+    return std::max(static_cast<T>(EIGEN_TOLERANCE), T(100) * std::numeric_limits<T>::epsilon());
+}
+
+} // namespace detail
+
+/**
+ * @brief Returns all the eigenvalues and eigenvectors of a small symmetric
+ * Matrix object, by decreasing eigenvalue.
+ *
+ * Uses the cyclic Jacobi algorithm, which costs O(n^3) per sweep. It is
+ * accurate, but meant for matrices of up to a few hundred rows. Only the
+ * symmetric part of the Matrix object is used.
+ *
+ *
+ * @example
+ *
+ * #include "eigen.h"
+ *
+ * linalg::Matrix<double> A{{{2, 1}, {1, 2}}};
+ * linalg::Eigenpairs<double> eig{linalg::symmetricEigen(A)};
+ * // eig.values is [[3] [1]]
+ *
+ *
+ * @param mat - Square symmetric Matrix object of float or double.
+ * @return All the eigenpairs.
+ */
+template <typename T>
+Eigenpairs<T> symmetricEigen(const Matrix<T>& mat)
+{
+    static_assert(std::is_floating_point<T>::value, "symmetricEigen needs a floating point Matrix");
+    detail::checkSquareOperand(mat);
+    size_t n = mat.rows();
+    Matrix<T> symmetric{(mat + mat.transpose()) * T(0.5)};
+    std::vector<T> values;
+    Matrix<T> vectors(n, n);
+    std::vector<size_t> order;
+    detail::smallEigen(symmetric, false, values, vectors, order);
+
+    Eigenpairs<T> res{Matrix<T>(n, 1), detail::selectColumns(vectors, order, n), 0, true};
+    for (size_t i=0; i<n; i++)
+    {
+        res.values(i, 0) = values[order[i]];
+    }
+    return res;
+}
+
+/**
+ * @brief Returns the k eigenpairs of largest magnitude of a symmetric
+ * operator with block power iteration.
+ *
+ * A block of more than k vectors is multiplied by the operator, projected
+ * with Rayleigh-Ritz and orthonormalized with QR at every iteration. The
+ * block is passed to the operator at once, so a dense operator goes through
+ * the matrix multiplication kernel. Convergence depends on the ratio of the
+ * eigenvalue after the block to the k-th one.
+ *
+ * The operator is any callable op(x, y) which writes A x into y, where x is
+ * n x b and y is an n x b Matrix object already allocated, so sparse or
+ * implicit matrices can be used. The value type is then given explicitly.
+ *
+ *
+ * @example
+ *
+ * #include "eigen.h"
+ *
+ * // Covariance G G^T applied without forming it.
+ * auto covariance = [&G](const linalg::Matrix<double>& x, linalg::Matrix<double>& y)
+ * {
+ *     y = G * linalg::Matrix<double>{G.transpose() * x};
+ * };
+ * linalg::Eigenpairs<double> top{linalg::powerIteration<double>(covariance, G.rows(), 5)};
+ *
+ *
+ * @param op - The operator, applied as op(x, y).
+ * @param n - Size of the operator.
+ * @param k - Number of eigenpairs.
+ * @param tolerance - Largest residual norm |A v - lambda v| accepted, relative to
+ *                    the largest eigenvalue found. If 0, 1e-10 or
+ *                    100 epsilon of T, whichever is larger.
+ * @param maxIterations - Largest number of iterations, POWER_ITERATIONS if 0.
+ * @return The eigenpairs by decreasing magnitude.
+ */
+template <typename T, typename Operator>
+Eigenpairs<T> powerIteration(const Operator& op, size_t n, size_t k, double tolerance = 0,
+                             size_t maxIterations = 0)
+{
+    static_assert(std::is_floating_point<T>::value, "powerIteration needs float or double");
+    detail::checkEigenInput(n, k);
+    size_t block = std::min(n, k + std::max<size_t>(k, 4));
+    size_t limit = (maxIterations == 0) ? POWER_ITERATIONS : maxIterations;
+
+    Matrix<T> x{QRDecomposition<T>{detail::startBlock<T>(n, block, 0)}.q()};
+    Matrix<T> y(n, block);
+    Matrix<T> projected(block, block);
+    Matrix<T> ritz(n, block);
+    Matrix<T> image(n, block);
+    std::vector<T> values;
+    Matrix<T> rotation(block, block);
+    std::vector<size_t> order;
+    for (size_t iteration=1; ; iteration++)
+    {
+        op(x, y);
+        detail::gemm(Transpose::Yes, Transpose::No, block, block, n, T(1), x.data(), block, y.data(), block,
+                     T(0), projected.data(), block);
+        projected = (projected + projected.transpose()) * T(0.5);
+        detail::smallEigen(projected, true, values, rotation, order);
+        Matrix<T> sorted{detail::selectColumns(rotation, order, block)};
+        detail::gemm(Transpose::No, Transpose::No, n, block, block, T(1), x.data(), block, sorted.data(), block,
+                     T(0), ritz.data(), block);
+        detail::gemm(Transpose::No, Transpose::No, n, block, block, T(1), y.data(), block, sorted.data(), block,
+                     T(0), image.data(), block);
+
+        // Residual norms of the first k Ritz pairs.
+        Matrix<T> lambda(1, block);
+        for (size_t j=0; j<block; j++)
+        {
+            lambda(0, j) = values[order[j]];
+        }
+        Matrix<T> residual{image - hadamard(ritz, lambda)};
+        Matrix<T> squares{colSums(Matrix<T>{hadamard(residual, residual)})};
+        T worst = T(0);
+        for (size_t j=0; j<k; j++)
+        {
+            worst = std::max(worst, std::sqrt(squares(0, j)));
+        }
+        bool converged = worst <= detail::eigenTolerance<T>(tolerance) * std::abs(lambda(0, 0));
+
+        if (converged || iteration == limit)
+        {
+            Eigenpairs<T> res{Matrix<T>(k, 1), Matrix<T>(n, k), iteration, converged};
+            for (size_t i=0; i<n; i++)
+            {
+                std::copy(ritz.data() + i * block, ritz.data() + i * block + k, res.vectors.data() + i * k);
+            }
+            for (size_t j=0; j<k; j++)
+            {
+                res.values(j, 0) = lambda(0, j);
+            }
+            return res;
+        }
+        x = QRDecomposition<T>{image}.q();
+    }
+}
+
+/**
+ * @brief Block power iteration on a dense symmetric Matrix object.
+ *
+ * See powerIteration() with an operator.
+ */
+template <typename T>
+Eigenpairs<T> powerIteration(const Matrix<T>& mat, size_t k, double tolerance = 0, size_t maxIterations = 0)
+{
+    detail::checkSquareOperand(mat);
+    return powerIteration<T>(detail::DenseOperator<T>{mat}, mat.rows(), k, tolerance, maxIterations);
+}
+
+/**
+ * @brief Returns the k eigenpairs of largest magnitude of a symmetric
+ * operator with the Lanczos algorithm.
+ *
+ * Builds an orthonormal basis of the Krylov subspace one vector at a time,
+ * with full reorthogonalization against the whole basis, done twice with
+ * the multithreaded matrix-vector kernels. Ritz pairs are checked every
+ * LANCZOS_CHECK steps, with the usual residual estimate beta * |s_m|. It
+ * usually needs far fewer applications of the operator than power
+ * iteration, but keeps maxIterations vectors of size n.
+ *
+ * The operator is used as in powerIteration(), with x and y of size n x 1.
+ *
+ *
+ * @example
+ *
+ * #include "eigen.h"
+ *
+ * linalg::Matrix<double> covariance{X.transpose() * X};
+ * linalg::Eigenpairs<double> top{linalg::lanczos(covariance, 10)};
+ *
+ *
+ * @param op - The operator, applied as op(x, y).
+ * @param n - Size of the operator.
+ * @param k - Number of eigenpairs.
+ * @param tolerance - Largest residual estimate accepted, relative to the
+ *                    largest eigenvalue found. If 0, 1e-10 or
+ *                    100 epsilon of T, whichever is larger.
+ * @param maxIterations - Largest dimension of the Krylov subspace,
+ *                        min(n, 10 k + 40) if 0.
+ * @return The eigenpairs by decreasing magnitude.
+ */
+template <typename T, typename Operator>
+Eigenpairs<T> lanczos(const Operator& op, size_t n, size_t k, double tolerance = 0, size_t maxIterations = 0)
+{
+    static_assert(std::is_floating_point<T>::value, "lanczos needs float or double");
+    detail::checkEigenInput(n, k);
+    size_t limit = std::min(n, (maxIterations == 0) ? 10 * k + 40 : maxIterations);
+    limit = std::max(limit, k);
+
+    // The basis is stored by rows, so every vector is contiguous.
+    Matrix<T> basis(limit + 1, n);
+    Matrix<T> x(n, 1);
+    Matrix<T> y(n, 1);
+    std::vector<T> alpha;
+    std::vector<T> beta;
+    std::vector<T> overlap(limit + 1);
+    T scale = T(0);
+
+    // Makes w orthogonal to the first count basis vectors and returns its norm.
+    auto orthogonalize = [&](T* w, size_t count)
+    {
+        for (size_t pass=0; pass<2; pass++)
+        {
+            detail::gemv(Transpose::No, count, n, T(1), basis.data(), n, w, size_t(1), T(0), overlap.data(), size_t(1));
+            detail::gemv(Transpose::Yes, count, n, T(-1), basis.data(), n, overlap.data(), size_t(1), T(1), w, size_t(1));
+        }
+        return std::sqrt(detail::dot(w, w, n));
+    };
+
+    Matrix<T> start{detail::startBlock<T>(n, 1, 0)};
+    T norm = std::sqrt(detail::dot(start.data(), start.data(), n));
+    for (size_t i=0; i<n; i++)
+    {
+        basis(0, i) = start(i, 0) / norm;
+    }
+
+    for (size_t step=0; ; step++)
+    {
+        const T* q = basis.data() + step * n;
+        std::copy(q, q + n, x.data());
+        op(x, y);
+        T* w = y.data();
+        T a = detail::dot(q, w, n);
+        alpha.push_back(a);
+        T b = orthogonalize(w, step + 1);
+        scale = std::max(scale, std::abs(a) + b);
+
+        size_t dim = step + 1;
+        bool exhausted = b <= T(n) * std::numeric_limits<T>::epsilon() * scale;
+        if (dim >= k && (dim % LANCZOS_CHECK == 0 || exhausted || dim == limit))
+        {
+            Matrix<T> tridiagonal(dim, dim);
+            for (size_t i=0; i<dim; i++)
+            {
+                tridiagonal(i, i) = alpha[i];
+                if (i + 1 < dim)
+                {
+                    tridiagonal(i, i + 1) = beta[i];
+                    tridiagonal(i + 1, i) = beta[i];
+                }
+            }
+            std::vector<T> values;
+            Matrix<T> rotation(dim, dim);
+            std::vector<size_t> order;
+            detail::smallEigen(tridiagonal, true, values, rotation, order);
+
+            T worst = T(0);
+            for (size_t j=0; j<k; j++)
+            {
+                worst = std::max(worst, b * std::abs(rotation(dim - 1, order[j])));
+            }
+            bool converged = exhausted || worst <= detail::eigenTolerance<T>(tolerance) * std::abs(values[order[0]]);
+            if (converged || dim == limit)
+            {
+                Matrix<T> selected{detail::selectColumns(rotation, order, k)};
+                Eigenpairs<T> res{Matrix<T>(k, 1), Matrix<T>(n, k), dim, converged};
+                detail::gemm(Transpose::Yes, Transpose::No, n, k, dim, T(1), basis.data(), n, selected.data(), k,
+                             T(0), res.vectors.data(), k);
+                for (size_t j=0; j<k; j++)
+                {
+                    res.values(j, 0) = values[order[j]];
+                }
+                return res;
+            }
+        }
+
+        // An invariant subspace was found before k vectors: continue from a
+        // new direction, which leaves a zero on the off-diagonal.
+        if (exhausted)
+        {
+            Matrix<T> fresh{detail::startBlock<T>(n, 1, dim)};
+            std::copy(fresh.data(), fresh.data() + n, w);
+            T restart = orthogonalize(w, dim);
+            for (size_t i=0; i<n; i++)
+            {
+                w[i] /= restart;
+            }
+            b = T(0);
+        }
+        else
+        {
+            for (size_t i=0; i<n; i++)
+            {
+                w[i] /= b;
+            }
+        }
+        beta.push_back(b);
+        std::copy(w, w + n, basis.data() + dim * n);
+    }
+}
+
+/**
+ * @brief Lanczos algorithm on a dense symmetric Matrix object.
+ *
+ * See lanczos() with an operator.
+ */
+template <typename T>
+Eigenpairs<T> lanczos(const Matrix<T>& mat, size_t k, double tolerance = 0, size_t maxIterations = 0)
+{
+    detail::checkSquareOperand(mat);
+    return lanczos<T>(detail::DenseOperator<T>{mat}, mat.rows(), k, tolerance, maxIterations);
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_EIGEN_H
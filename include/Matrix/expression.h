@@ -0,0 +1,439 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATRIX_EXPRESSION_H
+#define MATRIX_EXPRESSION_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+
+#include "parallel.h"
+
+
+namespace linalg
+{
+template <typename T>
+class Matrix;
+
+// Element-wise work below this many elements runs on the calling thread.
+const size_t ELEMENTWISE_GRAIN = 32768;
+
+/**
+ * @brief Base class of every element-wise expression.
+ *
+ * Element-wise operators do not compute anything when they are called. They
+ * return a light-weight expression object that remembers the operands. The
+ * whole expression is evaluated in a single pass when it is assigned to a
+ * Matrix object, so `D = A + B - C * 2` does not allocate any temporaries.
+ *
+ * Every expression provides value_type, rows(), cols() and the element
+ * access operator()(row, col).
+ */
+template <typename E>
+class MatrixExpression
+{
+public:
+    const E& derived() const
+    {
+        return static_cast<const E&>(*this);
+    }
+};
+
+namespace detail
+{
+// Non-owning reference to the elements of a Matrix object inside an expression.
+template <typename T>
+class MatrixLeaf
+{
+public:
+    typedef T value_type;
+
+    explicit MatrixLeaf(const Matrix<T>& mat)
+        : m_data{mat.data()}, m_rows{mat.rows()}, m_cols{mat.cols()}
+    {
+    }
+
+    size_t rows() const
+    {
+        return m_rows;
+    }
+
+    size_t cols() const
+    {
+        return m_cols;
+    }
+
+    T operator() (size_t row, size_t col) const
+    {
+        return m_data[row * m_cols + col];
+    }
+
+private:
+    const T* m_data;
+    size_t m_rows;
+    size_t m_cols;
+};
+
+// Matrix objects are held by reference, sub-expressions are held by value.
+template <typename E>
+struct ExpressionOperand
+{
+    typedef E type;
+};
+
+template <typename T>
+struct ExpressionOperand<Matrix<T>>
+{
+    typedef MatrixLeaf<T> type;
+};
+
+struct AddOp
+{
+    template <typename T>
+    static T apply(const T& lhs, const T& rhs)
+    {
+        return lhs + rhs;
+    }
+};
+
+struct SubtractOp
+{
+    template <typename T>
+    static T apply(const T& lhs, const T& rhs)
+    {
+        return lhs - rhs;
+    }
+};
+
+struct MultiplyOp
+{
+    template <typename T>
+    static T apply(const T& lhs, const T& rhs)
+    {
+        return lhs * rhs;
+    }
+};
+
+struct AssignOp
+{
+    template <typename T>
+    static void apply(T& dst, const T& src)
+    {
+        dst = src;
+    }
+};
+
+struct AddAssignOp
+{
+    template <typename T>
+    static void apply(T& dst, const T& src)
+    {
+        dst += src;
+    }
+};
+
+struct SubtractAssignOp
+{
+    template <typename T>
+    static void apply(T& dst, const T& src)
+    {
+        dst -= src;
+    }
+};
+
+/*
+ * Evaluates expr into the row-major buffer out of the given dimensions. The
+ * flat index range is split between threads, and each thread walks its range
+ * one contiguous row segment at a time so the inner loop vectorizes.
+ */
+template <typename Assign, typename T, typename E>
+void evaluate(T* out, size_t rows, size_t cols, const E& expr)
+{
+    if (rows == 0 || cols == 0)
+    {
+        return;
+    }
+
+    parallelFor(0, rows * cols, ELEMENTWISE_GRAIN, [out, cols, &expr](size_t begin, size_t end)
+    {
+        size_t row = begin / cols;
+        size_t col = begin % cols;
+        while (begin < end)
+        {
+            size_t stop = std::min(cols, col + (end - begin));
+            T* dst = out + row * cols;
+            for (size_t j=col; j<stop; j++)
+            {
+                Assign::apply(dst[j], expr(row, j));
+            }
+            begin += stop - col;
+            row++;
+            col = 0;
+        }
+    });
+}
+
+/*
+ * Operand of an element-wise operation which is repeated along the 
+ * dimensions where it has a single row or column. The step of such a 
+ * dimension is 0, so the operand is read in place and never materialized.
+ */
+template <typename E>
+class BroadcastOperand
+{
+public:
+    typedef typename E::value_type value_type;
+
+    BroadcastOperand(const E& expr, size_t rows, size_t cols)
+        : m_expr(expr), m_rowStep{expr.rows() == rows ? size_t(1) : size_t(0)},
+          m_colStep{expr.cols() == cols ? size_t(1) : size_t(0)}
+    {
+    }
+
+    value_type operator() (size_t row, size_t col) const
+    {
+        return m_expr(row * m_rowStep, col * m_colStep);
+    }
+
+private:
+    typename ExpressionOperand<E>::type m_expr;
+    size_t m_rowStep;
+    size_t m_colStep;
+};
+
+// Returns the broadcast size of one dimension, or aborts when the sizes are 
+// neither equal nor one of them 1.
+inline size_t broadcastDimension(size_t lhs, size_t rhs)
+{
+    if (lhs != rhs && lhs != 1 && rhs != 1)
+    {
+        std::cerr << "Element-wise operation - Matrix dimension do not match" << std::endl;
+        std::abort();
+    }
+    return (lhs == 1) ? rhs : lhs;
+}
+} // namespace detail
+
+/**
+ * @brief Expression of an element-wise operation between two operands.
+ *
+ * The operands follow NumPy broadcasting. Each dimension should either be 
+ * the same or be 1 in one of the operands, in which case that operand is 
+ * repeated along it. A 1-by-N operand is applied to every row and an M-by-1 
+ * operand is applied to every column.
+ */
+template <typename Op, typename L, typename R>
+class BinaryExpression : public MatrixExpression<BinaryExpression<Op, L, R>>
+{
+public:
+    typedef typename L::value_type value_type;
+
+    static_assert(std::is_same<typename L::value_type, typename R::value_type>::value,
+                  "Element-wise operands should be of the same type");
+
+    BinaryExpression(const L& lhs, const R& rhs)
+        : m_rows{detail::broadcastDimension(lhs.rows(), rhs.rows())},
+          m_cols{detail::broadcastDimension(lhs.cols(), rhs.cols())},
+          m_lhs(lhs, m_rows, m_cols), m_rhs(rhs, m_rows, m_cols)
+    {
+    }
+
+    size_t rows() const
+    {
+        return m_rows;
+    }
+
+    size_t cols() const
+    {
+        return m_cols;
+    }
+
+    value_type operator() (size_t row, size_t col) const
+    {
+        return Op::apply(m_lhs(row, col), m_rhs(row, col));
+    }
+
+private:
+    size_t m_rows;
+    size_t m_cols;
+    detail::BroadcastOperand<L> m_lhs;
+    detail::BroadcastOperand<R> m_rhs;
+};
+
+/**
+ * @brief Expression of an expression scaled by a constant.
+ */
+template <typename E>
+class ScalarExpression : public MatrixExpression<ScalarExpression<E>>
+{
+public:
+    typedef typename E::value_type value_type;
+
+    ScalarExpression(const E& expr, const value_type& scalar)
+        : m_expr(expr), m_scalar(scalar)
+    {
+    }
+
+    size_t rows() const
+    {
+        return m_expr.rows();
+    }
+
+    size_t cols() const
+    {
+        return m_expr.cols();
+    }
+
+    value_type operator() (size_t row, size_t col) const
+    {
+        return m_expr(row, col) * m_scalar;
+    }
+
+private:
+    typename detail::ExpressionOperand<E>::type m_expr;
+    value_type m_scalar;
+};
+
+/**
+ * @brief Element-wise addition of two Matrix objects or expressions.
+ *
+ * Dimensions should be the same or broadcastable, otherwise the program is 
+ * aborted.
+ *
+ *
+ * @example
+ *
+ * #include "Matrix.h"
+ *
+ * linalg::Matrix<int> A{2, 2, 1};
+ * linalg::Matrix<int> B{2, 2, 3};
+ * linalg::Matrix<int> bias{{10, 20}};
+ * linalg::Matrix<int> C{A + B};    // all elements are 4
+ * linalg::Matrix<int> D{A + bias}; // [[11 21] [11 21]]
+ *
+ *
+ * @param lhs - The left-hand side Matrix object or expression.
+ * @param rhs - The right-hand side Matrix object or expression.
+ * @return An expression which is evaluated when assigned to a Matrix object.
+ */
+template <typename L, typename R>
+BinaryExpression<detail::AddOp, L, R> operator+ (const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+    return BinaryExpression<detail::AddOp, L, R>(lhs.derived(), rhs.derived());
+}
+
+/**
+ * @brief Element-wise subtraction of two Matrix objects or expressions.
+ *
+ * Dimensions should be the same or broadcastable, otherwise the program is 
+ * aborted.
+ *
+ *
+ * @example
+ *
+ * #include "Matrix.h"
+ *
+ * linalg::Matrix<int> A{2, 2, 5};
+ * linalg::Matrix<int> B{2, 2, 3};
+ * linalg::Matrix<int> C{A - B}; // all elements are 2
+ *
+ *
+ * @param lhs - The left-hand side Matrix object or expression.
+ * @param rhs - The right-hand side Matrix object or expression.
+ * @return An expression which is evaluated when assigned to a Matrix object.
+ */
+template <typename L, typename R>
+BinaryExpression<detail::SubtractOp, L, R> operator- (const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+    return BinaryExpression<detail::SubtractOp, L, R>(lhs.derived(), rhs.derived());
+}
+
+/**
+ * @brief Element-wise (Hadamard) product of two Matrix objects or expressions.
+ *
+ * operator* is the matrix product, so the element-wise product has its own
+ * name. Dimensions should be the same or broadcastable, otherwise the program 
+ * is aborted. A 1-by-N operand scales every column by its own factor.
+ *
+ *
+ * @example
+ *
+ * #include "Matrix.h"
+ *
+ * linalg::Matrix<int> A{{{1, 2}, {3, 4}}};
+ * linalg::Matrix<int> B{{{5, 6}, {7, 8}}};
+ * linalg::Matrix<int> C{hadamard(A, B)}; // [[5 12] [21 32]]
+ *
+ *
+ * @param lhs - The left-hand side Matrix object or expression.
+ * @param rhs - The right-hand side Matrix object or expression.
+ * @return An expression which is evaluated when assigned to a Matrix object.
+ */
+template <typename L, typename R>
+BinaryExpression<detail::MultiplyOp, L, R> hadamard(const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+    return BinaryExpression<detail::MultiplyOp, L, R>(lhs.derived(), rhs.derived());
+}
+
+/**
+ * @brief Multiplies every element of a Matrix object or expression by a
+ * constant.
+ *
+ *
+ * @example
+ *
+ * #include "Matrix.h"
+ *
+ * linalg::Matrix<int> A{2, 2, 3};
+ * linalg::Matrix<int> B{A * 2};
+ * linalg::Matrix<int> C{2 * A};
+ *
+ *
+ * @param expr - The Matrix object or expression.
+ * @param scalar - The constant, of the same type as the elements.
+ * @return An expression which is evaluated when assigned to a Matrix object.
+ */
+template <typename E>
+ScalarExpression<E> operator* (const MatrixExpression<E>& expr, const typename E::value_type& scalar)
+{
+    return ScalarExpression<E>(expr.derived(), scalar);
+}
+
+template <typename E>
+ScalarExpression<E> operator* (const typename E::value_type& scalar, const MatrixExpression<E>& expr)
+{
+    return ScalarExpression<E>(expr.derived(), scalar);
+}
+
+/**
+ * @brief Matrix multiplication where one of the operands is an element-wise
+ * expression. The expression is evaluated first.
+ */
+template <typename L, typename R>
+Matrix<typename L::value_type> operator* (const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+    return Matrix<typename L::value_type>(lhs) * Matrix<typename R::value_type>(rhs);
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_EXPRESSION_H
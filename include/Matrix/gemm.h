@@ -0,0 +1,512 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATRIX_GEMM_H
+#define MATRIX_GEMM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "parallel.h"
+
+
+namespace linalg
+{
+/**
+ * @brief Whether an operand of a kernel is used as it is or transposed.
+ */
+enum class Transpose
+{
+    No,
+    Yes
+};
+
+// Blocking of the matrix multiplication kernel.
+// GEMM_MR x GEMM_NR  - Tile of the result kept in registers.
+// GEMM_KC            - Depth of a packed panel. A GEMM_KC x GEMM_NR sliver of
+//                      the right-hand side stays in L1.
+// GEMM_MC            - Rows of the left-hand side packed at once, sized for L2.
+// GEMM_NC            - Columns of a packed tile of the right-hand side.
+const size_t GEMM_MR = 4;
+const size_t GEMM_NR = 8;
+const size_t GEMM_KC = 256;
+const size_t GEMM_MC = 96;
+const size_t GEMM_NC = 2048;
+
+// Products with fewer multiply-adds than this skip packing altogether.
+const size_t GEMM_SMALL = 32 * 32 * 32;
+
+// Elements of the matrix read by one task of a matrix-vector product, and
+// independent accumulators of its dot products.
+const size_t GEMV_GRAIN = 32768;
+const size_t GEMV_LANES = 8;
+
+namespace detail
+{
+// Aborts unless the operands of a product have matching inner dimensions.
+inline void checkProductSize(size_t lhsCols, size_t rhsRows)
+{
+    if (lhsCols != rhsRows)
+    {
+        std::cerr << "Matrix dimension do not match" << std::endl;
+        std::abort();
+    }
+}
+
+// Element (row, col) of a row-major operand with leading dimension ld.
+template <typename T>
+struct RowMajorAccess
+{
+    const T* data;
+    size_t ld;
+
+    T operator() (size_t row, size_t col) const
+    {
+        return data[row * ld + col];
+    }
+};
+
+// Element (row, col) of the transpose of a row-major operand.
+template <typename T>
+struct TransposedAccess
+{
+    const T* data;
+    size_t ld;
+
+    T operator() (size_t row, size_t col) const
+    {
+        return data[col * ld + row];
+    }
+};
+
+// Epilogue which does nothing.
+struct NoEpilogue
+{
+    void operator() (size_t, size_t) const
+    {
+    }
+};
+
+/*
+ * The right-hand side of a product, k x n, copied once into tiles of
+ * GEMM_KC x GEMM_NC. Each tile is stored as GEMM_NR wide column slivers,
+ * zero padded, in the order the micro-kernel reads them.
+ *
+ * The elements are read through an accessor b(row, col), so the operand
+ * does not have to exist in memory as a matrix.
+ */
+template <typename T>
+class PackedRhs
+{
+public:
+    template <typename Access>
+    PackedRhs(size_t k, size_t n, const Access& b)
+        : m_k{k}, m_n{n}
+    {
+        m_kBlocks = (k + GEMM_KC - 1) / GEMM_KC;
+        m_nBlocks = (n + GEMM_NC - 1) / GEMM_NC;
+        m_paddedCols = (n + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+        m_data.resize(k * m_paddedCols);
+
+        parallelFor(0, m_kBlocks * m_nBlocks, 1, [this, &b](size_t begin, size_t end)
+        {
+            for (size_t tile=begin; tile<end; tile++)
+            {
+                pack(tile / m_nBlocks, tile % m_nBlocks, b);
+            }
+        });
+    }
+
+    size_t rows() const
+    {
+        return m_k;
+    }
+
+    size_t cols() const
+    {
+        return m_n;
+    }
+
+    size_t kBlocks() const
+    {
+        return m_kBlocks;
+    }
+
+    size_t nBlocks() const
+    {
+        return m_nBlocks;
+    }
+
+    // Tile (kBlock, nBlock). Slivers are GEMM_NR * depth(kBlock) apart.
+    const T* tile(size_t kBlock, size_t nBlock) const
+    {
+        return m_data.data() + offset(kBlock, nBlock);
+    }
+
+    size_t depth(size_t kBlock) const
+    {
+        return std::min(GEMM_KC, m_k - kBlock * GEMM_KC);
+    }
+
+    size_t width(size_t nBlock) const
+    {
+        return std::min(GEMM_NC, m_n - nBlock * GEMM_NC);
+    }
+
+private:
+    size_t offset(size_t kBlock, size_t nBlock) const
+    {
+        return kBlock * GEMM_KC * m_paddedCols + depth(kBlock) * nBlock * GEMM_NC;
+    }
+
+    template <typename Access>
+    void pack(size_t kBlock, size_t nBlock, const Access& b)
+    {
+        size_t p0 = kBlock * GEMM_KC;
+        size_t j0 = nBlock * GEMM_NC;
+        size_t kc = depth(kBlock);
+        size_t nc = width(nBlock);
+        T* out = m_data.data() + offset(kBlock, nBlock);
+        for (size_t s=0; s<nc; s+=GEMM_NR)
+        {
+            size_t nr = std::min(GEMM_NR, nc - s);
+            for (size_t p=0; p<kc; p++)
+            {
+                for (size_t c=0; c<nr; c++)
+                {
+                    out[p * GEMM_NR + c] = b(p0 + p, j0 + s + c);
+                }
+                for (size_t c=nr; c<GEMM_NR; c++)
+                {
+                    out[p * GEMM_NR + c] = T(0);
+                }
+            }
+            out += kc * GEMM_NR;
+        }
+    }
+
+    size_t m_k;
+    size_t m_n;
+    size_t m_kBlocks;
+    size_t m_nBlocks;
+    size_t m_paddedCols;
+    std::vector<T> m_data;
+};
+
+// Copies a mc x kc block of the left-hand side into GEMM_MR high row slivers.
+template <typename T, typename Access>
+void packLhs(const Access& a, size_t i0, size_t p0, size_t mc, size_t kc, T* out)
+{
+    for (size_t s=0; s<mc; s+=GEMM_MR)
+    {
+        size_t mr = std::min(GEMM_MR, mc - s);
+        for (size_t p=0; p<kc; p++)
+        {
+            for (size_t r=0; r<mr; r++)
+            {
+                out[p * GEMM_MR + r] = a(i0 + s + r, p0 + p);
+            }
+            for (size_t r=mr; r<GEMM_MR; r++)
+            {
+                out[p * GEMM_MR + r] = T(0);
+            }
+        }
+        out += kc * GEMM_MR;
+    }
+}
+
+/*
+ * Computes a GEMM_MR x GEMM_NR tile of the product from two packed slivers
+ * and adds alpha times it to c. The fixed loop bounds let the compiler keep
+ * the tile in vector registers.
+ */
+template <typename T>
+void microKernel(size_t kc, const T* a, const T* b, T alpha, T* c, size_t ldc, size_t mr, size_t nr)
+{
+    T tile[GEMM_MR][GEMM_NR] = {};
+    for (size_t p=0; p<kc; p++)
+    {
+        for (size_t r=0; r<GEMM_MR; r++)
+        {
+            for (size_t col=0; col<GEMM_NR; col++)
+            {
+                tile[r][col] += a[p * GEMM_MR + r] * b[p * GEMM_NR + col];
+            }
+        }
+    }
+
+    for (size_t r=0; r<mr; r++)
+    {
+        for (size_t col=0; col<nr; col++)
+        {
+            c[r * ldc + col] += alpha * tile[r][col];
+        }
+    }
+}
+
+template <typename T>
+void scaleRows(T* c, size_t ldc, size_t begin, size_t end, size_t n, T beta)
+{
+    for (size_t i=begin; i<end; i++)
+    {
+        T* row = c + i * ldc;
+        if (beta == T(0))
+        {
+            std::fill(row, row + n, T(0));
+        }
+        else if (beta != T(1))
+        {
+            for (size_t j=0; j<n; j++)
+            {
+                row[j] *= beta;
+            }
+        }
+    }
+}
+
+/*
+ * C = alpha * A * B + beta * C with B already packed.
+ *
+ * C is m x n, row-major with leading dimension ldc, and A (m x k) is read
+ * through the accessor a(row, col). Threads own blocks of rows. When a block
+ * is complete, epilogue(rowBegin, rowEnd) is called on the same thread while
+ * the rows are still in cache.
+ */
+template <typename T, typename AccessA, typename Epilogue>
+void gemmPacked(size_t m, T alpha, const AccessA& a, const PackedRhs<T>& b, T beta, T* c, size_t ldc,
+                const Epilogue& epilogue)
+{
+    size_t n = b.cols();
+    size_t k = b.rows();
+
+    // Use smaller row blocks when there are not enough of them for every thread.
+    size_t threads = getNumThreads();
+    size_t mc = std::min(GEMM_MC, std::max(GEMM_MR, (m + threads - 1) / threads));
+    mc = (mc + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    size_t blocks = (m + mc - 1) / mc;
+
+    parallelFor(0, blocks, 1, [&](size_t begin, size_t end)
+    {
+        std::vector<T> packed(mc * std::min(GEMM_KC, std::max<size_t>(k, 1)));
+        for (size_t block=begin; block<end; block++)
+        {
+            size_t i0 = block * mc;
+            size_t rows = std::min(mc, m - i0);
+            scaleRows(c, ldc, i0, i0 + rows, n, beta);
+
+            for (size_t kb=0; kb<b.kBlocks(); kb++)
+            {
+                size_t kc = b.depth(kb);
+                packLhs(a, i0, kb * GEMM_KC, rows, kc, packed.data());
+
+                for (size_t nb=0; nb<b.nBlocks(); nb++)
+                {
+                    const T* tile = b.tile(kb, nb);
+                    size_t j0 = nb * GEMM_NC;
+                    size_t nc = b.width(nb);
+                    for (size_t s=0; s<nc; s+=GEMM_NR)
+                    {
+                        const T* sliver = tile + (s / GEMM_NR) * kc * GEMM_NR;
+                        for (size_t r=0; r<rows; r+=GEMM_MR)
+                        {
+                            microKernel(kc, packed.data() + r * kc, sliver, alpha,
+                                        c + (i0 + r) * ldc + j0 + s, ldc,
+                                        std::min(GEMM_MR, rows - r), std::min(GEMM_NR, nc - s));
+                        }
+                    }
+                }
+            }
+            epilogue(i0, i0 + rows);
+        }
+    });
+}
+
+// Unpacked loops for products too small to pay for packing.
+template <typename T, typename AccessA, typename AccessB, typename Epilogue>
+void gemmSmall(size_t m, size_t n, size_t k, T alpha, const AccessA& a, const AccessB& b, T beta, T* c, size_t ldc,
+               const Epilogue& epilogue)
+{
+    scaleRows(c, ldc, 0, m, n, beta);
+    for (size_t i=0; i<m; i++)
+    {
+        T* row = c + i * ldc;
+        for (size_t p=0; p<k; p++)
+        {
+            T value = alpha * a(i, p);
+            for (size_t j=0; j<n; j++)
+            {
+                row[j] += value * b(p, j);
+            }
+        }
+    }
+    epilogue(0, m);
+}
+
+/*
+ * y = alpha * op(A) * x + beta * y, where A is m x n row-major, in the same
+ * form as the BLAS routine. Without transpose every thread takes a range of
+ * rows and computes their dot products in GEMV_LANES independent lanes. With
+ * transpose every thread takes a range of columns and accumulates the rows
+ * of A into them, so both cases read A contiguously.
+ */
+template <typename T>
+void gemv(Transpose trans, size_t m, size_t n, T alpha, const T* a, size_t lda, const T* x, size_t incx,
+          T beta, T* y, size_t incy)
+{
+    size_t inner = (trans == Transpose::No) ? n : m;
+    size_t outer = (trans == Transpose::No) ? m : n;
+    std::vector<T> contiguous;
+    if (incx != 1)
+    {
+        contiguous.resize(inner);
+        for (size_t i=0; i<inner; i++)
+        {
+            contiguous[i] = x[i * incx];
+        }
+        x = contiguous.data();
+    }
+
+    size_t grain = std::max<size_t>(1, GEMV_GRAIN / std::max<size_t>(inner, 1));
+    parallelFor(0, outer, grain, [&](size_t begin, size_t end)
+    {
+        std::vector<T> acc;
+        if (trans == Transpose::No)
+        {
+            acc.resize(end - begin);
+            for (size_t i=begin; i<end; i++)
+            {
+                const T* row = a + i * lda;
+                T lanes[GEMV_LANES] = {};
+                size_t j = 0;
+                for (; j+GEMV_LANES<=n; j+=GEMV_LANES)
+                {
+                    for (size_t l=0; l<GEMV_LANES; l++)
+                    {
+                        lanes[l] += row[j + l] * x[j + l];
+                    }
+                }
+                for (; j<n; j++)
+                {
+                    lanes[0] += row[j] * x[j];
+                }
+                T total = T(0);
+                for (size_t l=0; l<GEMV_LANES; l++)
+                {
+                    total += lanes[l];
+                }
+                acc[i - begin] = total;
+            }
+        }
+        else
+        {
+            acc.assign(end - begin, T(0));
+            for (size_t i=0; i<m; i++)
+            {
+                T value = x[i];
+                const T* row = a + i * lda + begin;
+                for (size_t j=0; j<end-begin; j++)
+                {
+                    acc[j] += value * row[j];
+                }
+            }
+        }
+
+        for (size_t i=begin; i<end; i++)
+        {
+            T& out = y[i * incy];
+            out = (beta == T(0)) ? alpha * acc[i - begin] : alpha * acc[i - begin] + beta * out;
+        }
+    });
+}
+
+/*
+ * C = alpha * A * B + beta * C where both operands are read through
+ * accessors. A is m x k, B is k x n and C is m x n row-major.
+ */
+template <typename T, typename AccessA, typename AccessB, typename Epilogue>
+void gemm(size_t m, size_t n, size_t k, T alpha, const AccessA& a, const AccessB& b, T beta, T* c, size_t ldc,
+          const Epilogue& epilogue)
+{
+    if (m == 0 || n == 0)
+    {
+        return;
+    }
+    if (m * n * k < GEMM_SMALL)
+    {
+        gemmSmall(m, n, k, alpha, a, b, beta, c, ldc, epilogue);
+        return;
+    }
+    PackedRhs<T> packed(k, n, b);
+    gemmPacked(m, alpha, a, packed, beta, c, ldc, epilogue);
+}
+
+template <typename T, typename AccessA, typename AccessB>
+void gemm(size_t m, size_t n, size_t k, T alpha, const AccessA& a, const AccessB& b, T beta, T* c, size_t ldc)
+{
+    gemm(m, n, k, alpha, a, b, beta, c, ldc, NoEpilogue());
+}
+
+template <typename T, typename AccessA>
+void gemm(Transpose transB, size_t m, size_t n, size_t k, T alpha, const AccessA& a,
+          const T* b, size_t ldb, T beta, T* c, size_t ldc)
+{
+    if (transB == Transpose::No)
+    {
+        gemm(m, n, k, alpha, a, RowMajorAccess<T>{b, ldb}, beta, c, ldc);
+    }
+    else
+    {
+        gemm(m, n, k, alpha, a, TransposedAccess<T>{b, ldb}, beta, c, ldc);
+    }
+}
+
+/*
+ * C = alpha * op(A) * op(B) + beta * C on row-major buffers, in the same
+ * form as the BLAS routine. op(A) is m x k, op(B) is k x n.
+ */
+template <typename T>
+void gemm(Transpose transA, Transpose transB, size_t m, size_t n, size_t k, T alpha,
+          const T* a, size_t lda, const T* b, size_t ldb, T beta, T* c, size_t ldc)
+{
+    // A product with one column is memory bound and does not pay for packing.
+    if (n == 1 && m * k >= GEMM_SMALL)
+    {
+        size_t rows = (transA == Transpose::No) ? m : k;
+        size_t cols = (transA == Transpose::No) ? k : m;
+        gemv(transA, rows, cols, alpha, a, lda, b, (transB == Transpose::No) ? ldb : 1, beta, c, ldc);
+        return;
+    }
+    if (transA == Transpose::No)
+    {
+        gemm(transB, m, n, k, alpha, RowMajorAccess<T>{a, lda}, b, ldb, beta, c, ldc);
+    }
+    else
+    {
+        gemm(transB, m, n, k, alpha, TransposedAccess<T>{a, lda}, b, ldb, beta, c, ldc);
+    }
+}
+} // namespace detail
+
+}; // namespace linalg
+
+#endif // MATRIX_GEMM_H
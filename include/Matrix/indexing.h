@@ -0,0 +1,385 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_INDEXING_H
+#define MATRIX_INDEXING_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "expression.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+// Number of gathered rows (or elements) between a prefetch and its use. The
+// indices are known in advance, so the next random rows are requested while
+// the current one is copied.
+const size_t PREFETCH_DISTANCE = 8;
+
+namespace detail
+{
+inline void prefetch(const void* address)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+inline void checkIndices(const std::vector<size_t>& indices, size_t size, const char* name)
+{
+    for (size_t index : indices)
+    {
+        if (index >= size)
+        {
+            std::cerr << name << " - Index out of range" << std::endl;
+            std::abort();
+        }
+    }
+}
+
+inline void checkDistinct(const std::vector<size_t>& indices, size_t size, const char* name)
+{
+    std::vector<bool> seen(size, false);
+    for (size_t index : indices)
+    {
+        if (index >= size || seen[index])
+        {
+            std::cerr << name << " - Indices should be distinct and in range" << std::endl;
+            std::abort();
+        }
+        seen[index] = true;
+    }
+}
+
+inline void checkPermutation(const std::vector<size_t>& perm, size_t size)
+{
+    if (perm.size() != size)
+    {
+        std::cerr << "Permutation - Size does not match the Matrix" << std::endl;
+        std::abort();
+    }
+    checkDistinct(perm, size, "Permutation");
+}
+
+// Element (row, col) of the Matrix made of the given rows of a row-major operand.
+template <typename T>
+struct GatheredRowsAccess
+{
+    const T* data;
+    size_t ld;
+    const size_t* rows;
+
+    T operator() (size_t row, size_t col) const
+    {
+        return data[rows[row] * ld + col];
+    }
+};
+
+// Copies the listed rows of src to consecutive rows of dst, or the other way
+// round when scatter is true.
+template <typename T>
+void copyRows(const T* src, T* dst, size_t cols, const std::vector<size_t>& rows, bool scatter)
+{
+    size_t count = rows.size();
+    const size_t* index = rows.data();
+    parallelFor(0, count, std::max<size_t>(1, ELEMENTWISE_GRAIN / std::max<size_t>(cols, 1)),
+                [=](size_t begin, size_t end)
+    {
+        for (size_t i=begin; i<end; i++)
+        {
+            if (i + PREFETCH_DISTANCE < end)
+            {
+                size_t ahead = index[i + PREFETCH_DISTANCE] * cols;
+                prefetch(scatter ? static_cast<const void*>(dst + ahead) : static_cast<const void*>(src + ahead));
+            }
+            const T* from = scatter ? src + i * cols : src + index[i] * cols;
+            T* to = scatter ? dst + index[i] * cols : dst + i * cols;
+            std::copy(from, from + cols, to);
+        }
+    });
+}
+} // namespace detail
+
+/**
+ * @brief Returns a Matrix object made of the given rows, in the given order.
+ *
+ * Rows are copied in parallel, and the rows a few indices ahead are
+ * prefetched since their addresses are not sequential. Indices may repeat.
+ *
+ *
+ * @example
+ *
+ * #include "indexing.h"
+ *
+ * linalg::Matrix<int> A{{{1, 2}, {3, 4}, {5, 6}}};
+ * std::cout << linalg::takeRows(A, {2, 0, 2}); // [[5 6] [1 2] [5 6]]
+ *
+ *
+ * @param mat - The Matrix object.
+ * @param rows - Row indices.
+ * @return Matrix object of rows.size() rows.
+ */
+template <typename T>
+Matrix<T> takeRows(const Matrix<T>& mat, const std::vector<size_t>& rows)
+{
+    detail::checkIndices(rows, mat.rows(), "Take rows");
+    Matrix<T> res(rows.size(), mat.cols());
+    detail::copyRows(mat.data(), res.data(), mat.cols(), rows, false);
+    return res;
+}
+
+/**
+ * @brief Returns a Matrix object made of the given columns, in the given
+ * order. Indices may repeat.
+ *
+ *
+ * @example
+ *
+ * #include "indexing.h"
+ *
+ * linalg::Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};
+ * std::cout << linalg::takeCols(A, {2, 0}); // [[3 1] [6 4]]
+ *
+ *
+ * @param mat - The Matrix object.
+ * @param cols - Column indices.
+ * @return Matrix object of cols.size() columns.
+ */
+template <typename T>
+Matrix<T> takeCols(const Matrix<T>& mat, const std::vector<size_t>& cols)
+{
+    detail::checkIndices(cols, mat.cols(), "Take columns");
+    size_t count = cols.size();
+    size_t ld = mat.cols();
+    Matrix<T> res(mat.rows(), count);
+    const T* src = mat.data();
+    T* dst = res.data();
+    const size_t* index = cols.data();
+    detail::parallelFor(0, mat.rows(), std::max<size_t>(1, ELEMENTWISE_GRAIN / std::max<size_t>(count, 1)),
+                        [=](size_t begin, size_t end)
+    {
+        for (size_t i=begin; i<end; i++)
+        {
+            const T* row = src + i * ld;
+            T* out = dst + i * count;
+            for (size_t j=0; j<count; j++)
+            {
+                if (j + PREFETCH_DISTANCE < count)
+                {
+                    detail::prefetch(row + index[j + PREFETCH_DISTANCE]);
+                }
+                out[j] = row[index[j]];
+            }
+        }
+    });
+    return res;
+}
+
+/**
+ * @brief Writes row i of src to row rows[i] of dst, the inverse of
+ * takeRows().
+ *
+ * Rows are written in parallel, so the indices should be distinct. A
+ * repeated index aborts, since two threads would write the same row.
+ *
+ *
+ * @example
+ *
+ * #include "indexing.h"
+ *
+ * linalg::Matrix<int> A{3, 2, 0};
+ * linalg::scatterRows(linalg::Matrix<int>{{{1, 2}, {3, 4}}}, {2, 0}, A);
+ * std::cout << A; // [[3 4] [0 0] [1 2]]
+ *
+ *
+ * @param src - Matrix object of rows.size() rows.
+ * @param rows - Destination row of every row of src, all distinct.
+ * @param dst - Matrix object with as many columns as src.
+ */
+template <typename T>
+void scatterRows(const Matrix<T>& src, const std::vector<size_t>& rows, Matrix<T>& dst)
+{
+    if (src.rows() != rows.size() || src.cols() != dst.cols())
+    {
+        std::cerr << "Scatter rows - Matrix dimension do not match" << std::endl;
+        std::abort();
+    }
+    detail::checkDistinct(rows, dst.rows(), "Scatter rows");
+    detail::copyRows(src.data(), dst.data(), src.cols(), rows, true);
+}
+
+/**
+ * @brief Returns the inverse of a permutation, so that
+ * takeRows(takeRows(A, perm), inversePermutation(perm)) is A.
+ */
+inline std::vector<size_t> inversePermutation(const std::vector<size_t>& perm)
+{
+    detail::checkPermutation(perm, perm.size());
+    std::vector<size_t> res(perm.size());
+    for (size_t i=0; i<perm.size(); i++)
+    {
+        res[perm[i]] = i;
+    }
+    return res;
+}
+
+/**
+ * @brief Reorders the rows of the Matrix object in place, so that row i
+ * becomes the old row perm[i].
+ *
+ * The permutation is applied cycle by cycle with one row of extra storage,
+ * which suits matrices too large to copy. takeRows() gives the same result
+ * out of place and in parallel.
+ *
+ *
+ * @example
+ *
+ * #include "indexing.h"
+ *
+ * linalg::Matrix<int> A{{{1, 1}, {2, 2}, {3, 3}}};
+ * linalg::permuteRowsInPlace(A, {1, 2, 0});
+ * std::cout << A; // [[2 2] [3 3] [1 1]]
+ *
+ *
+ * @param mat - The Matrix object.
+ * @param perm - A permutation of 0 .. mat.rows() - 1.
+ */
+template <typename T>
+void permuteRowsInPlace(Matrix<T>& mat, const std::vector<size_t>& perm)
+{
+    detail::checkPermutation(perm, mat.rows());
+    size_t cols = mat.cols();
+    T* data = mat.data();
+    std::vector<bool> done(perm.size(), false);
+    std::vector<T> saved(cols);
+    for (size_t start=0; start<perm.size(); start++)
+    {
+        if (done[start] || perm[start] == start)
+        {
+            continue;
+        }
+        // Walk the cycle start <- perm[start] <- perm[perm[start]] ...
+        std::copy(data + start * cols, data + (start + 1) * cols, saved.begin());
+        size_t i = start;
+        while (perm[i] != start)
+        {
+            std::copy(data + perm[i] * cols, data + (perm[i] + 1) * cols, data + i * cols);
+            done[i] = true;
+            i = perm[i];
+        }
+        std::copy(saved.begin(), saved.end(), data + i * cols);
+        done[i] = true;
+    }
+}
+
+/**
+ * @brief Rows of a Matrix object selected by an index list, without copying
+ * them.
+ *
+ * The view can be multiplied on either side of a Matrix object. The
+ * multiplication kernel reads the selected rows while it packs its operands,
+ * so the gathered Matrix is never allocated. The view keeps a reference to
+ * the Matrix object, which should outlive it.
+ *
+ *
+ * @example
+ *
+ * #include "indexing.h"
+ *
+ * // Forward pass of a mini-batch.
+ * linalg::IndexedRows<float> batch{inputs, batchIndices};
+ * linalg::Matrix<float> activations{batch * weights};
+ *
+ *
+ * @param mat - The Matrix object.
+ * @param rows - Row indices, which may repeat.
+ */
+template <typename T>
+class IndexedRows
+{
+public:
+    IndexedRows(const Matrix<T>& mat, std::vector<size_t> rows)
+        : m_mat(mat), m_rows{std::move(rows)}
+    {
+        detail::checkIndices(m_rows, mat.rows(), "Indexed rows");
+    }
+
+    size_t rows() const
+    {
+        return m_rows.size();
+    }
+
+    size_t cols() const
+    {
+        return m_mat.cols();
+    }
+
+    const std::vector<size_t>& indices() const
+    {
+        return m_rows;
+    }
+
+   /**
+    * @brief Returns the selected rows as a Matrix object, the same as takeRows().
+    */
+    Matrix<T> materialize() const
+    {
+        return takeRows(m_mat, m_rows);
+    }
+
+    friend Matrix<T> operator* (const IndexedRows<T>& lhs, const Matrix<T>& rhs)
+    {
+        detail::checkProductSize(lhs.cols(), rhs.rows());
+        Matrix<T> res(lhs.rows(), rhs.cols());
+        detail::gemm(lhs.rows(), rhs.cols(), lhs.cols(), T(1), lhs.access(),
+                     detail::RowMajorAccess<T>{rhs.data(), rhs.cols()}, T(0), res.data(), rhs.cols());
+        return res;
+    }
+
+    friend Matrix<T> operator* (const Matrix<T>& lhs, const IndexedRows<T>& rhs)
+    {
+        detail::checkProductSize(lhs.cols(), rhs.rows());
+        Matrix<T> res(lhs.rows(), rhs.cols());
+        detail::gemm(lhs.rows(), rhs.cols(), lhs.cols(), T(1), detail::RowMajorAccess<T>{lhs.data(), lhs.cols()},
+                     rhs.access(), T(0), res.data(), rhs.cols());
+        return res;
+    }
+
+private:
+    detail::GatheredRowsAccess<T> access() const
+    {
+        return detail::GatheredRowsAccess<T>{m_mat.data(), m_mat.cols(), m_rows.data()};
+    }
+
+    const Matrix<T>& m_mat;
+    std::vector<size_t> m_rows;
+};
+
+}; // namespace linalg
+
+#endif // MATRIX_INDEXING_H
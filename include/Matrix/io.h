@@ -0,0 +1,143 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "matrix.h"
+
+
+namespace linalg
+{
+namespace detail
+{
+// Header of a binary Matrix file. The elements follow in row-major order.
+// Everything is stored in the byte order of the machine.
+struct FileHeader
+{
+    char magic[4];
+    uint32_t elementSize;
+    uint64_t rows;
+    uint64_t cols;
+};
+
+const char FILE_MAGIC[4] = {'L', 'M', 'A', 'T'};
+} // namespace detail
+
+/**
+ * @brief Writes the Matrix object to a binary file.
+ *
+ * The file holds a small header with the dimensions and the size of an
+ * element, then the elements as they are in memory, so saving and loading
+ * are single block writes and reads.
+ *
+ *
+ * @example
+ *
+ * #include "io.h"
+ *
+ * linalg::Matrix<double> weights{1024, 1024, 0.5};
+ * if (!linalg::save(weights, "weights.bin"))
+ * {
+ *     std::cerr << "Could not save the weights" << std::endl;
+ * }
+ *
+ *
+ * @param mat - The Matrix object.
+ * @param path - Path of the file, replaced if it exists.
+ * @return Whether the file was written completely.
+ */
+template <typename T>
+bool save(const Matrix<T>& mat, const std::string& path)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    detail::FileHeader header;
+    std::memcpy(header.magic, detail::FILE_MAGIC, sizeof(header.magic));
+    header.elementSize = sizeof(T);
+    header.rows = mat.rows();
+    header.cols = mat.cols();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(mat.data()), mat.rows() * mat.cols() * sizeof(T));
+    file.close();
+    return !file.fail();
+}
+
+/**
+ * @brief Reads a Matrix object written by save().
+ *
+ *
+ * @example
+ *
+ * #include "io.h"
+ *
+ * linalg::Matrix<double> weights{0, 0};
+ * bool loaded = linalg::load("weights.bin", weights);
+ *
+ *
+ * @param path - Path of the file.
+ * @param mat - Replaced by the Matrix object in the file.
+ * @return Whether the file exists, holds elements of the same size as T and
+ *         is complete. mat is left unchanged otherwise.
+ */
+template <typename T>
+bool load(const std::string& path, Matrix<T>& mat)
+{
+    std::ifstream file(path, std::ios::binary);
+    detail::FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, detail::FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.elementSize != sizeof(T))
+    {
+        return false;
+    }
+
+    // Check the dimensions against the rest of the file before allocating,
+    // so a corrupt header cannot ask for more memory than the file holds.
+    std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff end = file.tellg();
+    file.seekg(start);
+    if (start < 0 || end < start || !file)
+    {
+        return false;
+    }
+    uint64_t available = static_cast<uint64_t>(end - start) / sizeof(T);
+    if (header.rows != 0 && header.cols > available / header.rows)
+    {
+        return false;
+    }
+    Matrix<T> res(static_cast<size_t>(header.rows), static_cast<size_t>(header.cols));
+    if (!file.read(reinterpret_cast<char*>(res.data()), res.rows() * res.cols() * sizeof(T)))
+    {
+        return false;
+    }
+    mat = std::move(res);
+    return true;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_IO_H
@@ -0,0 +1,174 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_KRONECKER_H
+#define MATRIX_KRONECKER_H
+
+#include <algorithm>
+#include <vector>
+
+#include "expression.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+namespace detail
+{
+/*
+ * Applies the same small product, out_r = B * in_r, to every one of count
+ * contiguous row-major blocks, where in_r is k x p and out_r is m x p.
+ */
+template <typename T>
+void multiplyBlocks(size_t count, size_t m, size_t p, size_t k, const T* b, const T* in, T* out)
+{
+    if (p == 1)
+    {
+        // The blocks are the rows of a count x k Matrix, so one product
+        // with B^T does them all.
+        gemm(Transpose::No, Transpose::Yes, count, m, k, T(1), in, k, b, k, T(0), out, m);
+        return;
+    }
+    size_t grain = std::max<size_t>(1, GEMM_SMALL / std::max<size_t>(m * p * k, 1));
+    parallelFor(0, count, grain, [=](size_t begin, size_t end)
+    {
+        for (size_t r=begin; r<end; r++)
+        {
+            gemm(Transpose::No, Transpose::No, m, p, k, T(1), b, k, in + r * k * p, p, T(0), out + r * m * p, p);
+        }
+    });
+}
+} // namespace detail
+
+/**
+ * @brief Returns the Kronecker product of two Matrix objects.
+ *
+ * Element (i * B.rows() + k, j * B.cols() + l) is A(i, j) * B(k, l). The
+ * result has A.rows() * B.rows() rows and A.cols() * B.cols() columns, so
+ * prefer kronMultiply() when only its product with a Matrix object is needed.
+ *
+ *
+ * @example
+ *
+ * #include "kronecker.h"
+ *
+ * linalg::Matrix<int> A{{{1, 2}, {3, 4}}};
+ * linalg::Matrix<int> B{{{0, 1}, {1, 0}}};
+ * std::cout << linalg::kron(A, B);
+ * // [[ 0 1 0 2 ]
+ * //  [ 1 0 2 0 ]
+ * //  [ 0 3 0 4 ]
+ * //  [ 3 0 4 0 ]]
+ *
+ *
+ * @param lhs - The left-hand side Matrix object A.
+ * @param rhs - The right-hand side Matrix object B.
+ * @return The Kronecker product A ⊗ B.
+ */
+template <typename T>
+Matrix<T> kron(const Matrix<T>& lhs, const Matrix<T>& rhs)
+{
+    size_t rows = lhs.rows() * rhs.rows();
+    size_t cols = lhs.cols() * rhs.cols();
+    Matrix<T> res(rows, cols);
+    T* out = res.data();
+    detail::parallelFor(0, rows, std::max<size_t>(1, ELEMENTWISE_GRAIN / std::max<size_t>(cols, 1)),
+                        [&lhs, &rhs, out, cols](size_t begin, size_t end)
+    {
+        for (size_t row=begin; row<end; row++)
+        {
+            size_t i = row / rhs.rows();
+            size_t k = row % rhs.rows();
+            T* dst = out + row * cols;
+            for (size_t j=0; j<lhs.cols(); j++)
+            {
+                T scale = lhs(i, j);
+                for (size_t l=0; l<rhs.cols(); l++)
+                {
+                    dst[j * rhs.cols() + l] = scale * rhs(k, l);
+                }
+            }
+        }
+    });
+    return res;
+}
+
+/**
+ * @brief Returns (A ⊗ B) * X without forming the Kronecker product.
+ *
+ * For a single column, reshaping x row by row into an A.cols() x B.cols()
+ * Matrix object X turns the product into A X B^T, so the memory needed is
+ * that of the operands instead of the (mA mB) x (nA nB) Kronecker matrix, and
+ * the work drops from O(mA mB nA nB) to O(mA nA nB + mA mB nB) per column.
+ * Every column of X is treated the same way with a single pass over A and a
+ * batch of products with B. The cheaper of the two orders is chosen.
+ *
+ *
+ * @example
+ *
+ * #include "kronecker.h"
+ *
+ * linalg::Matrix<double> A{300, 300, 0.5};
+ * linalg::Matrix<double> B{300, 300, 0.25};
+ * linalg::Matrix<double> x{90000, 1, 1.0};
+ * linalg::Matrix<double> y{linalg::kronMultiply(A, B, x)}; // 90000 x 1
+ *
+ *
+ * @param lhs - The left factor A of the Kronecker product.
+ * @param rhs - The right factor B of the Kronecker product.
+ * @param mat - Matrix object with A.cols() * B.cols() rows.
+ * @return Matrix object with A.rows() * B.rows() rows.
+ */
+template <typename T>
+Matrix<T> kronMultiply(const Matrix<T>& lhs, const Matrix<T>& rhs, const Matrix<T>& mat)
+{
+    detail::checkProductSize(lhs.cols() * rhs.cols(), mat.rows());
+    size_t ma = lhs.rows();
+    size_t na = lhs.cols();
+    size_t mb = rhs.rows();
+    size_t nb = rhs.cols();
+    size_t p = mat.cols();
+    Matrix<T> res(ma * mb, p);
+
+    // X is A.cols() blocks of B.cols() x p. Either A mixes the blocks first
+    // and B is applied to each of the A.rows() results, or the other way round.
+    if (ma * nb * (na + mb) <= na * mb * (nb + ma))
+    {
+        std::vector<T> mixed(ma * nb * p);
+        detail::gemm(Transpose::No, Transpose::No, ma, nb * p, na, T(1), lhs.data(), na, mat.data(), nb * p,
+                     T(0), mixed.data(), nb * p);
+        detail::multiplyBlocks(ma, mb, p, nb, rhs.data(), mixed.data(), res.data());
+    }
+    else
+    {
+        std::vector<T> mixed(na * mb * p);
+        detail::multiplyBlocks(na, mb, p, nb, rhs.data(), mat.data(), mixed.data());
+        detail::gemm(Transpose::No, Transpose::No, ma, mb * p, na, T(1), lhs.data(), na, mixed.data(), mb * p,
+                     T(0), res.data(), mb * p);
+    }
+    return res;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_KRONECKER_H
@@ -0,0 +1,315 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_LOW_RANK_H
+#define MATRIX_LOW_RANK_H
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "qr.h"
+#include "svd.h"
+
+
+namespace linalg
+{
+namespace detail
+{
+// Number of leading singular values above tolerance times the largest one.
+template <typename T>
+size_t keptRank(const Matrix<T>& s, T tolerance)
+{
+    size_t rank = 0;
+    while (rank < s.rows() && s(rank, 0) > tolerance * s(0, 0))
+    {
+        rank++;
+    }
+    return rank;
+}
+
+// The first rank columns of mat, each multiplied by the matching element of scale.
+template <typename T>
+Matrix<T> leadingColumns(const Matrix<T>& mat, size_t rank, const Matrix<T>* scale)
+{
+    Matrix<T> res(mat.rows(), rank);
+    for (size_t i=0; i<mat.rows(); i++)
+    {
+        for (size_t j=0; j<rank; j++)
+        {
+            res(i, j) = (scale == nullptr) ? mat(i, j) : mat(i, j) * (*scale)(j, 0);
+        }
+    }
+    return res;
+}
+} // namespace detail
+
+/**
+ * @brief A matrix stored in factored form, A = L R^T.
+ *
+ * For an m x n matrix of rank k, L is m x k and R is n x k, so it takes
+ * (m + n) k elements instead of m n, and multiplying it by a Matrix object
+ * with p columns costs O((m + n) k p) instead of O(m n p). Products between
+ * low-rank matrices stay in factored form.
+ *
+ *
+ * @example
+ *
+ * #include "low_rank.h"
+ *
+ * linalg::LowRankMatrix<double> W{linalg::lowRankApproximation(weights, 32)};
+ * linalg::Matrix<double> Y{W * X};          // two thin products
+ * linalg::Matrix<double> dense{W.toDense()};
+ *
+ *
+ * @param left - m x k Matrix object L.
+ * @param right - n x k Matrix object R, with as many columns as L.
+ */
+template <typename T>
+class LowRankMatrix
+{
+public:
+    static_assert(std::is_floating_point<T>::value, "LowRankMatrix needs float or double");
+
+    LowRankMatrix(Matrix<T> left, Matrix<T> right)
+        : m_left{std::move(left)}, m_right{std::move(right)}
+    {
+        if (m_left.cols() != m_right.cols())
+        {
+            std::cerr << "Low-rank matrix - Factors should have the same number of columns" << std::endl;
+            std::abort();
+        }
+    }
+
+    size_t rows() const
+    {
+        return m_left.rows();
+    }
+
+    size_t cols() const
+    {
+        return m_right.rows();
+    }
+
+   /**
+    * @brief Returns the number of columns of the factors, an upper bound of
+    * the rank.
+    */
+    size_t rank() const
+    {
+        return m_left.cols();
+    }
+
+    const Matrix<T>& left() const
+    {
+        return m_left;
+    }
+
+    const Matrix<T>& right() const
+    {
+        return m_right;
+    }
+
+   /**
+    * @brief Returns L R^T as a dense Matrix object.
+    */
+    Matrix<T> toDense() const
+    {
+        Matrix<T> res(rows(), cols());
+        detail::gemm(Transpose::No, Transpose::Yes, rows(), cols(), rank(), T(1), m_left.data(), rank(),
+                     m_right.data(), rank(), T(0), res.data(), cols());
+        return res;
+    }
+
+   /**
+    * @brief Returns the transpose, R L^T, without copying any element twice.
+    */
+    LowRankMatrix<T> transpose() const
+    {
+        return LowRankMatrix<T>(m_right, m_left);
+    }
+
+   /**
+    * @brief Recompresses the factors, dropping the singular values below
+    * tolerance times the largest one.
+    *
+    * Both factors are orthonormalized with QR and only the small k x k
+    * product of their R factors goes through svd(), so the cost is
+    * O((m + n) k^2). The singular values are folded into the left factor.
+    * Useful after a sum, which adds up the ranks.
+    *
+    *
+    * @param tolerance - Relative threshold of the singular values. 0 only
+    *                    removes exactly dependent columns.
+    */
+    void truncate(T tolerance)
+    {
+        if (rank() == 0)
+        {
+            return;
+        }
+        if (rank() > rows() || rank() > cols())
+        {
+            SingularValueDecomposition<T> usv{svd(toDense())};
+            size_t kept = detail::keptRank(usv.s, tolerance);
+            m_left = detail::leadingColumns(usv.u, kept, &usv.s);
+            m_right = detail::leadingColumns(usv.v, kept, static_cast<const Matrix<T>*>(nullptr));
+            return;
+        }
+
+        QRDecomposition<T> leftQr{m_left};
+        QRDecomposition<T> rightQr{m_right};
+        Matrix<T> core(rank(), rank());
+        Matrix<T> leftR{leftQr.r()};
+        Matrix<T> rightR{rightQr.r()};
+        detail::gemm(Transpose::No, Transpose::Yes, rank(), rank(), rank(), T(1), leftR.data(), rank(),
+                     rightR.data(), rank(), T(0), core.data(), rank());
+        SingularValueDecomposition<T> usv{svd(core)};
+        size_t kept = detail::keptRank(usv.s, tolerance);
+        m_left = leftQr.q() * detail::leadingColumns(usv.u, kept, &usv.s);
+        m_right = rightQr.q() * detail::leadingColumns(usv.v, kept, static_cast<const Matrix<T>*>(nullptr));
+    }
+
+   /**
+    * @brief Multiplication of a low-rank matrix by a dense Matrix object,
+    * computed as L (R^T X).
+    */
+    friend Matrix<T> operator* (const LowRankMatrix<T>& lhs, const Matrix<T>& rhs)
+    {
+        detail::checkProductSize(lhs.cols(), rhs.rows());
+        size_t k = lhs.rank();
+        size_t p = rhs.cols();
+        Matrix<T> inner(k, p);
+        detail::gemm(Transpose::Yes, Transpose::No, k, p, lhs.cols(), T(1), lhs.m_right.data(), k,
+                     rhs.data(), p, T(0), inner.data(), p);
+        Matrix<T> res(lhs.rows(), p);
+        detail::gemm(Transpose::No, Transpose::No, lhs.rows(), p, k, T(1), lhs.m_left.data(), k,
+                     inner.data(), p, T(0), res.data(), p);
+        return res;
+    }
+
+   /**
+    * @brief Multiplication of a dense Matrix object by a low-rank matrix,
+    * computed as (X L) R^T.
+    */
+    friend Matrix<T> operator* (const Matrix<T>& lhs, const LowRankMatrix<T>& rhs)
+    {
+        detail::checkProductSize(lhs.cols(), rhs.rows());
+        size_t k = rhs.rank();
+        Matrix<T> inner(lhs.rows(), k);
+        detail::gemm(Transpose::No, Transpose::No, lhs.rows(), k, lhs.cols(), T(1), lhs.data(), lhs.cols(),
+                     rhs.m_left.data(), k, T(0), inner.data(), k);
+        Matrix<T> res(lhs.rows(), rhs.cols());
+        detail::gemm(Transpose::No, Transpose::Yes, lhs.rows(), rhs.cols(), k, T(1), inner.data(), k,
+                     rhs.m_right.data(), k, T(0), res.data(), rhs.cols());
+        return res;
+    }
+
+   /**
+    * @brief Product of two low-rank matrices, L1 (R1^T L2) R2^T. The small
+    * middle factor is merged into the thinner side, so the rank of the
+    * result is the smaller of the two ranks.
+    */
+    friend LowRankMatrix<T> operator* (const LowRankMatrix<T>& lhs, const LowRankMatrix<T>& rhs)
+    {
+        detail::checkProductSize(lhs.cols(), rhs.rows());
+        size_t k1 = lhs.rank();
+        size_t k2 = rhs.rank();
+        Matrix<T> core(k1, k2);
+        detail::gemm(Transpose::Yes, Transpose::No, k1, k2, lhs.cols(), T(1), lhs.m_right.data(), k1,
+                     rhs.m_left.data(), k2, T(0), core.data(), k2);
+        if (k1 <= k2)
+        {
+            // R2 core^T is n x k1.
+            Matrix<T> right(rhs.cols(), k1);
+            detail::gemm(Transpose::No, Transpose::Yes, rhs.cols(), k1, k2, T(1), rhs.m_right.data(), k2,
+                         core.data(), k2, T(0), right.data(), k1);
+            return LowRankMatrix<T>(lhs.m_left, std::move(right));
+        }
+        return LowRankMatrix<T>(lhs.m_left * core, rhs.m_right);
+    }
+
+    friend LowRankMatrix<T> operator* (const LowRankMatrix<T>& lhs, const T& scalar)
+    {
+        return LowRankMatrix<T>(Matrix<T>{lhs.m_left * scalar}, lhs.m_right);
+    }
+
+    friend LowRankMatrix<T> operator* (const T& scalar, const LowRankMatrix<T>& rhs)
+    {
+        return rhs * scalar;
+    }
+
+   /**
+    * @brief Sum of two low-rank matrices. The factors are put side by side,
+    * so the ranks add up. Call truncate() to recompress.
+    */
+    friend LowRankMatrix<T> operator+ (const LowRankMatrix<T>& lhs, const LowRankMatrix<T>& rhs)
+    {
+        if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+        {
+            std::cerr << "Matrix dimension do not match" << std::endl;
+            std::abort();
+        }
+        return LowRankMatrix<T>(sideBySide(lhs.m_left, rhs.m_left), sideBySide(lhs.m_right, rhs.m_right));
+    }
+
+private:
+    static Matrix<T> sideBySide(const Matrix<T>& lhs, const Matrix<T>& rhs)
+    {
+        Matrix<T> res(lhs.rows(), lhs.cols() + rhs.cols());
+        for (size_t i=0; i<lhs.rows(); i++)
+        {
+            std::copy(lhs.data() + i * lhs.cols(), lhs.data() + (i + 1) * lhs.cols(), res.data() + i * res.cols());
+            std::copy(rhs.data() + i * rhs.cols(), rhs.data() + (i + 1) * rhs.cols(),
+                      res.data() + i * res.cols() + lhs.cols());
+        }
+        return res;
+    }
+
+    Matrix<T> m_left;
+    Matrix<T> m_right;
+};
+
+/**
+ * @brief Returns a rank k approximation of a Matrix object, computed with
+ * randomizedSvd(). The singular values are folded into the left factor.
+ *
+ *
+ * @param mat - Matrix object of float or double.
+ * @param k - Rank of the approximation.
+ * @param oversampling - See randomizedSvd().
+ * @param powerIterations - See randomizedSvd().
+ * @return The approximation in factored form.
+ */
+template <typename T>
+LowRankMatrix<T> lowRankApproximation(const Matrix<T>& mat, size_t k, size_t oversampling = 10,
+                                      size_t powerIterations = 2)
+{
+    SingularValueDecomposition<T> usv{randomizedSvd(mat, k, oversampling, powerIterations)};
+    return LowRankMatrix<T>(detail::leadingColumns(usv.u, k, &usv.s), std::move(usv.v));
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_LOW_RANK_H
@@ -0,0 +1,533 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATRIX_LU_H
+#define MATRIX_LU_H
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "dataflow.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "triangular.h"
+
+
+namespace linalg
+{
+// Number of columns factored at once before the trailing update.
+const size_t LU_BLOCK = 64;
+
+// Block columns of the trailing matrix updated by one task.
+const size_t LU_UPDATE_BLOCKS = 4;
+
+namespace detail
+{
+/*
+ * Unblocked LU with partial pivoting of the columns [k0, k0 + kb) of the
+ * n x n row-major buffer a, over the rows [k0, n). Rows are only swapped
+ * within the panel. The other columns get the same interchanges from
+ * swapPanelRows(), when their own tasks run.
+ */
+template <typename T>
+void luPanel(T* a, size_t n, size_t k0, size_t kb, std::vector<size_t>& pivots, bool& singular)
+{
+    for (size_t j=k0; j<k0+kb; j++)
+    {
+        size_t pivot = j;
+        T best = std::abs(a[j * n + j]);
+        for (size_t i=j+1; i<n; i++)
+        {
+            if (std::abs(a[i * n + j]) > best)
+            {
+                best = std::abs(a[i * n + j]);
+                pivot = i;
+            }
+        }
+
+        pivots[j] = pivot;
+        if (pivot != j)
+        {
+            std::swap_ranges(a + j * n + k0, a + j * n + k0 + kb, a + pivot * n + k0);
+        }
+        if (best == T(0))
+        {
+            singular = true;
+            continue;
+        }
+
+        // Eliminate below the pivot, within the panel only.
+        T inverse = T(1) / a[j * n + j];
+        const T* top = a + j * n;
+        size_t last = k0 + kb;
+        parallelFor(j + 1, n, std::max<size_t>(1, ELEMENTWISE_GRAIN / kb), [=](size_t begin, size_t end)
+        {
+            for (size_t i=begin; i<end; i++)
+            {
+                T* row = a + i * n;
+                T factor = row[j] * inverse;
+                row[j] = factor;
+                for (size_t c=j+1; c<last; c++)
+                {
+                    row[c] -= factor * top[c];
+                }
+            }
+        });
+    }
+}
+
+// Applies the row interchanges of the panel at k0 to the columns [c0, c0 + cols).
+template <typename T>
+void swapPanelRows(T* a, size_t n, size_t k0, size_t kb, const std::vector<size_t>& pivots, size_t c0, size_t cols)
+{
+    for (size_t j=k0; j<k0+kb; j++)
+    {
+        if (pivots[j] != j)
+        {
+            std::swap_ranges(a + j * n + c0, a + j * n + c0 + cols, a + pivots[j] * n + c0);
+        }
+    }
+}
+
+/*
+ * Right-looking blocked LU of the n x n row-major buffer a, in place, run as
+ * a graph of tile tasks. The matrix is split into block columns of LU_BLOCK.
+ * For step k the panel task factors block column k, then one task per block
+ * column j > k applies the interchanges, solves for its block of U and
+ * updates the rest of the column with the matrix multiplication kernel.
+ *
+ * Every task waits only for the tasks which wrote its data, so the panel of
+ * step k + 1 starts as soon as block column k + 1 is updated, while the other
+ * updates of step k are still running (lookahead). Panels have the highest
+ * priority since they are on the critical path. The interchanges of each
+ * panel are applied to the columns on its left at the end.
+ */
+template <typename T>
+bool luFactor(T* a, size_t n, std::vector<size_t>& pivots)
+{
+    bool singular = false;
+    pivots.resize(n);
+    size_t blocks = (n + LU_BLOCK - 1) / LU_BLOCK;
+
+    Dataflow flow;
+    // Last task which wrote each block column, if any.
+    std::vector<std::vector<Dataflow::Task>> written(blocks);
+    for (size_t k=0; k<blocks; k++)
+    {
+        size_t k0 = k * LU_BLOCK;
+        size_t kb = std::min(LU_BLOCK, n - k0);
+        size_t rest = n - k0 - kb;
+        std::vector<size_t>* pivot = &pivots;
+        bool* flag = &singular;
+        Dataflow::Task panel = flow.add([=]()
+        {
+            luPanel(a, n, k0, kb, *pivot, *flag);
+        }, written[k], 2);
+
+        // Block column k + 1 gets a task of its own for the lookahead, the
+        // others are updated LU_UPDATE_BLOCKS at a time.
+        for (size_t j=k+1; j<blocks; )
+        {
+            size_t last = (j == k + 1) ? j + 1 : std::min(blocks, j + LU_UPDATE_BLOCKS);
+            size_t j0 = j * LU_BLOCK;
+            size_t jb = std::min(last * LU_BLOCK, n) - j0;
+            std::vector<Dataflow::Task> after{panel};
+            for (size_t c=j; c<last; c++)
+            {
+                after.insert(after.end(), written[c].begin(), written[c].end());
+            }
+            Dataflow::Task update = flow.add([=]()
+            {
+                swapPanelRows(a, n, k0, kb, *pivot, j0, jb);
+
+                // U12 = L11^-1 * A12
+                trsmLeft(Triangle::Lower, Transpose::No, Diagonal::Unit, kb, jb, a + k0 * n + k0, n, a + k0 * n + j0, n);
+
+                // A22 -= L21 * U12
+                gemm(Transpose::No, Transpose::No, rest, jb, kb, T(-1), a + (k0 + kb) * n + k0, n,
+                     a + k0 * n + j0, n, T(1), a + (k0 + kb) * n + j0, n);
+            }, after, (j == k + 1) ? 1 : 0);
+            for (size_t c=j; c<last; c++)
+            {
+                written[c].assign(1, update);
+            }
+            j = last;
+        }
+    }
+    flow.run();
+
+    parallelFor(0, n, std::max<size_t>(1, ELEMENTWISE_GRAIN / std::max<size_t>(n, 1)), [&](size_t begin, size_t end)
+    {
+        for (size_t k0=LU_BLOCK; k0<n; k0+=LU_BLOCK)
+        {
+            size_t stop = std::min(end, k0);
+            if (begin < stop)
+            {
+                swapPanelRows(a, n, k0, std::min(LU_BLOCK, n - k0), pivots, begin, stop - begin);
+            }
+        }
+    });
+    return !singular;
+}
+
+/*
+ * Replaces the LU factors in a with the inverse of A, without a second n x n
+ * buffer, in the same way as the LAPACK routine getri. U is inverted in
+ * place, then X L = inv(U) is solved for X block column by block column from
+ * the right, and the row interchanges are applied to the columns of X in
+ * reverse order.
+ */
+template <typename T>
+void luInvert(T* a, size_t n, const std::vector<size_t>& pivots)
+{
+    trtriUpper(Diagonal::NonUnit, n, a, n);
+
+    std::vector<T> lower;
+    for (size_t end=n; end>0; )
+    {
+        size_t jb = std::min(LU_BLOCK, end);
+        size_t j0 = end - jb;
+        size_t below = n - j0;
+
+        // Move the strictly lower part of the block column of L out of the way.
+        lower.assign(below * jb, T(0));
+        T* out = lower.data();
+        parallelFor(0, below, std::max<size_t>(1, ELEMENTWISE_GRAIN / jb), [=](size_t begin, size_t stop)
+        {
+            for (size_t i=begin; i<stop; i++)
+            {
+                T* row = a + (j0 + i) * n + j0;
+                for (size_t c=0; c<std::min(i, jb); c++)
+                {
+                    out[i * jb + c] = row[c];
+                    row[c] = T(0);
+                }
+            }
+        });
+
+        // X1 = (W1 - X2 * L21) * inv(L11)
+        gemm(Transpose::No, Transpose::No, n, jb, below - jb, T(-1), a + j0 + jb, n, out + jb * jb, jb,
+             T(1), a + j0, n);
+        trsmRight(Triangle::Lower, Transpose::No, Diagonal::Unit, n, jb, out, jb, a + j0, n);
+        end = j0;
+    }
+
+    parallelFor(0, n, std::max<size_t>(1, ELEMENTWISE_GRAIN / std::max<size_t>(n, 1)), [&](size_t begin, size_t stop)
+    {
+        for (size_t i=begin; i<stop; i++)
+        {
+            T* row = a + i * n;
+            for (size_t j=n; j-->0; )
+            {
+                std::swap(row[j], row[pivots[j]]);
+            }
+        }
+    });
+}
+} // namespace detail
+
+/**
+ * @brief LU factorization with partial pivoting, P A = L U.
+ *
+ * L is unit lower triangular and U is upper triangular. Both are stored in
+ * one Matrix object of the same size as A. Only float and double are
+ * supported.
+ *
+ *
+ * @example
+ *
+ * #include "lu.h"
+ *
+ * linalg::Matrix<double> A{{{4, 3}, {6, 3}}};
+ * linalg::Matrix<double> b{{10, 12}};
+ * linalg::LUDecomposition<double> lu{A};
+ * std::cout << lu.solve(b.transpose()); // [[1] [2]]
+ * std::cout << lu.determinant();        // -6
+ *
+ *
+ * @param mat - Square Matrix object. Pass it with std::move to factor it
+ *              without a copy.
+ */
+template <typename T>
+class LUDecomposition
+{
+public:
+    static_assert(std::is_floating_point<T>::value, "LUDecomposition needs a floating point Matrix");
+
+    explicit LUDecomposition(Matrix<T> mat)
+        : m_factors{std::move(mat)}
+    {
+        if (m_factors.rows() != m_factors.cols())
+        {
+            std::cerr << "LU - Matrix should be square" << std::endl;
+            std::abort();
+        }
+        m_singular = !detail::luFactor(m_factors.data(), m_factors.rows(), m_pivots);
+    }
+
+   /**
+    * @brief Solves A X = B.
+    *
+    * B can have any number of columns. The program is aborted if A is
+    * singular or the number of rows of B does not match.
+    *
+    *
+    * @param rhs - The right-hand side B.
+    * @return The solution X, of the same size as B.
+    */
+    Matrix<T> solve(const Matrix<T>& rhs) const
+    {
+        size_t n = m_factors.rows();
+        if (rhs.rows() != n)
+        {
+            std::cerr << "LU solve - Matrix dimension do not match" << std::endl;
+            std::abort();
+        }
+        if (m_singular)
+        {
+            std::cerr << "LU solve - Matrix is singular" << std::endl;
+            std::abort();
+        }
+
+        Matrix<T> res{rhs};
+        size_t cols = res.cols();
+        for (size_t i=0; i<n; i++)
+        {
+            if (m_pivots[i] != i)
+            {
+                std::swap_ranges(res.data() + i * cols, res.data() + (i + 1) * cols, res.data() + m_pivots[i] * cols);
+            }
+        }
+        detail::trsmLeft(Triangle::Lower, Transpose::No, Diagonal::Unit, n, cols, m_factors.data(), n, res.data(), cols);
+        detail::trsmLeft(Triangle::Upper, Transpose::No, Diagonal::NonUnit, n, cols, m_factors.data(), n, res.data(), cols);
+        return res;
+    }
+
+   /**
+    * @brief Returns the inverse of A. The program is aborted if A is
+    * singular.
+    */
+    Matrix<T> inverse() const
+    {
+        if (m_singular)
+        {
+            std::cerr << "LU inverse - Matrix is singular" << std::endl;
+            std::abort();
+        }
+        Matrix<T> res{m_factors};
+        detail::luInvert(res.data(), res.rows(), m_pivots);
+        return res;
+    }
+
+   /**
+    * @brief Returns the determinant of A, the product of the diagonal of U
+    * with the sign of the row permutation.
+    */
+    T determinant() const
+    {
+        T det = T(1);
+        for (size_t i=0; i<m_factors.rows(); i++)
+        {
+            det *= m_factors(i, i);
+            if (m_pivots[i] != i)
+            {
+                det = -det;
+            }
+        }
+        return det;
+    }
+
+   /**
+    * @brief Returns true if a pivot was exactly zero.
+    */
+    bool isSingular() const
+    {
+        return m_singular;
+    }
+
+   /**
+    * @brief Returns the unit lower triangular factor L.
+    */
+    Matrix<T> lower() const
+    {
+        size_t n = m_factors.rows();
+        Matrix<T> res(n, n);
+        for (size_t i=0; i<n; i++)
+        {
+            std::copy(m_factors.data() + i * n, m_factors.data() + i * n + i, res.data() + i * n);
+            res(i, i) = T(1);
+        }
+        return res;
+    }
+
+   /**
+    * @brief Returns the upper triangular factor U.
+    */
+    Matrix<T> upper() const
+    {
+        size_t n = m_factors.rows();
+        Matrix<T> res(n, n);
+        for (size_t i=0; i<n; i++)
+        {
+            std::copy(m_factors.data() + i * n + i, m_factors.data() + (i + 1) * n, res.data() + i * n + i);
+        }
+        return res;
+    }
+
+   /**
+    * @brief Returns the row interchanges. Row i was swapped with row
+    * pivots()[i], in order of increasing i.
+    */
+    const std::vector<size_t>& pivots() const
+    {
+        return m_pivots;
+    }
+
+   /**
+    * @brief Returns L and U packed in one Matrix object. The unit diagonal
+    * of L is not stored.
+    */
+    const Matrix<T>& factors() const
+    {
+        return m_factors;
+    }
+
+private:
+    Matrix<T> m_factors;
+    std::vector<size_t> m_pivots;
+    bool m_singular;
+};
+
+/**
+ * @brief Solves the linear system A X = B with an LU factorization.
+ *
+ *
+ * @example
+ *
+ * #include "lu.h"
+ *
+ * linalg::Matrix<double> A{{{2, 1}, {1, 3}}};
+ * linalg::Matrix<double> B{{{3, 1}, {4, 2}}};
+ * linalg::Matrix<double> X{linalg::solve(A, B)};
+ *
+ *
+ * @param lhs - Square, non-singular Matrix object A.
+ * @param rhs - Right-hand side B with as many rows as A.
+ * @return The solution X.
+ */
+template <typename T>
+Matrix<T> solve(const Matrix<T>& lhs, const Matrix<T>& rhs)
+{
+    return LUDecomposition<T>{lhs}.solve(rhs);
+}
+
+/**
+ * @brief Returns the determinant of a square Matrix object, computed with an
+ * LU factorization.
+ *
+ *
+ * @example
+ *
+ * #include "lu.h"
+ *
+ * linalg::Matrix<double> A{{{1, 2}, {3, 4}}};
+ * std::cout << linalg::determinant(A); // -2
+ *
+ *
+ * @param mat - Square Matrix object.
+ * @return The determinant.
+ */
+template <typename T>
+T determinant(const Matrix<T>& mat)
+{
+    return LUDecomposition<T>{mat}.determinant();
+}
+
+/**
+ * @brief Replaces a square Matrix object with its inverse.
+ *
+ * The Matrix object is factored with the blocked LU, U is inverted with a
+ * blocked triangular inversion, and the inverse is formed from the factors
+ * in place. Only the pivots are allocated. Most of the work goes through the
+ * multithreaded matrix multiplication kernel.
+ *
+ *
+ * @example
+ *
+ * #include "lu.h"
+ *
+ * linalg::Matrix<double> A{{{4, 7}, {2, 6}}};
+ * if (!linalg::invertInPlace(A))
+ * {
+ *     // A is singular
+ * }
+ * // A is [[0.6 -0.7] [-0.2 0.4]]
+ *
+ *
+ * @param mat - Square Matrix object of float or double.
+ * @return false if mat is singular, in which case its content is undefined.
+ */
+template <typename T>
+bool invertInPlace(Matrix<T>& mat)
+{
+    static_assert(std::is_floating_point<T>::value, "invertInPlace needs a floating point Matrix");
+    if (mat.rows() != mat.cols())
+    {
+        std::cerr << "Inverse - Matrix should be square" << std::endl;
+        std::abort();
+    }
+    std::vector<size_t> pivots;
+    if (!detail::luFactor(mat.data(), mat.rows(), pivots))
+    {
+        return false;
+    }
+    detail::luInvert(mat.data(), mat.rows(), pivots);
+    return true;
+}
+
+/**
+ * @brief Returns the inverse of a square Matrix object.
+ *
+ * See invertInPlace(). The program is aborted if the Matrix object is
+ * singular.
+ *
+ *
+ * @param mat - Square Matrix object of float or double.
+ * @return The inverse.
+ */
+template <typename T>
+Matrix<T> inverse(const Matrix<T>& mat)
+{
+    Matrix<T> res{mat};
+    if (!invertInPlace(res))
+    {
+        std::cerr << "Inverse - Matrix is singular" << std::endl;
+        std::abort();
+    }
+    return res;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_LU_H
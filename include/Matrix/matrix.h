@@ -25,13 +25,18 @@
 #include <vector>
 #include <functional>
 
+#include "expression.h"
+#include "gemm.h"
+
 
 namespace linalg
 {
 template <typename T>
-class Matrix
+class Matrix : public MatrixExpression<Matrix<T>>
 {
 public:
+    typedef T value_type;
+
     // Delete the default constructor. Matrix cannot be initialized empty.
     Matrix() = delete;
 
@@ -57,7 +62,7 @@ public:
     * @return Initializes a Matrix object.
     */
     Matrix(const T mat)
-        : m_matrix{1, std::vector<T>(1, mat)}
+        : m_rows{1}, m_cols{1}, m_data(1, mat)
     {
     }
 
@@ -82,7 +87,7 @@ public:
     * @return Initializes a Matrix object.
     */
     Matrix(const std::vector<T>& mat)
-        : m_matrix{1, mat}
+        : m_rows{1}, m_cols{mat.size()}, m_data(mat)
     {
     }
 
@@ -109,17 +114,24 @@ public:
     * @return Initializes a Matrix object.
     */
     Matrix(const std::vector<std::vector<T>>& mat)
-        : m_matrix{mat}
+        : m_rows{mat.size()}, m_cols{mat.empty() ? 0 : mat[0].size()}
     {
-        for (int row=1; row<m_matrix.size(); row++)
+        for (size_t row=1; row<mat.size(); row++)
         {
-            if (m_matrix[row - 1].size() != m_matrix[row].size())
+            if (mat[row - 1].size() != mat[row].size())
             {
-                std::cout << m_matrix[row - 1].size() << ", " << m_matrix[row].size() << '\n';
+                std::cout << mat[row - 1].size() << ", " << mat[row].size() << '\n';
                 std::cerr << "Contructor - Matrix dimension do not match" << std::endl;
                 std::abort();
             }
         }
+
+        // The elements are stored row after row in one contiguous block.
+        m_data.reserve(m_rows * m_cols);
+        for (size_t row=0; row<mat.size(); row++)
+        {
+            m_data.insert(m_data.end(), mat[row].begin(), mat[row].end());
+        }
     }
 
    /**
@@ -148,8 +160,196 @@ public:
     * @return Initializes a Matrix object.
     */
     Matrix(const size_t& row, const size_t& col, T value=0)
-        : m_matrix{row, std::vector<T>(col, value)}
+        : m_rows{row}, m_cols{col}, m_data(row * col, value)
+    {
+    }
+
+   /**
+    * @brief Constructor
+    *
+    * Constructs a Matrix object by evaluating an element-wise expression. 
+    * The expression is computed in a single pass directly into the new 
+    * Matrix object.
+    * 
+    * 
+    * @example
+    * 
+    * #include "Matrix.h"
+    * 
+    * linalg::Matrix<int> A{3, 4, 1};
+    * linalg::Matrix<int> B{3, 4, 2};
+    * linalg::Matrix<int> C{A + B * 3};
+    * 
+    * // outputs (3, 4) with all elements equal to 7.
+    * std::cout << C;
+    * 
+    * 
+    * @param expr - Element-wise expression of Matrix objects.
+    * @return Initializes a Matrix object.
+    */
+    template <typename E>
+    Matrix(const MatrixExpression<E>& expr)
+        : m_rows{expr.derived().rows()}, m_cols{expr.derived().cols()}, m_data(m_rows * m_cols)
+    {
+        detail::evaluate<detail::AssignOp>(m_data.data(), m_rows, m_cols, expr.derived());
+    }
+
+   /**
+    * @brief Assigns the result of an element-wise expression.
+    *
+    * The expression may refer to the Matrix object being assigned, as in 
+    * `A = A + B`.
+    * 
+    * 
+    * @param expr - Element-wise expression of Matrix objects.
+    * @return Reference to this Matrix object.
+    */
+    template <typename E>
+    Matrix<T>& operator= (const MatrixExpression<E>& expr)
+    {
+        const E& src = expr.derived();
+        if (src.rows() != m_rows || src.cols() != m_cols)
+        {
+            // The expression may still read from this object, so the 
+            // result is computed in a new buffer before replacing it.
+            Matrix<T> res(src);
+            *this = std::move(res);
+            return *this;
+        }
+        detail::evaluate<detail::AssignOp>(m_data.data(), m_rows, m_cols, src);
+        return *this;
+    }
+
+   /**
+    * @brief Element-wise compound addition.
+    *
+    * Adds the expression to this Matrix object in place. The expression may 
+    * be a 1-by-N row or an M-by-1 column, which is broadcast to every row or 
+    * column. Otherwise dimensions should match, or the program is aborted.
+    * 
+    * 
+    * @example
+    * 
+    * #include "Matrix.h"
+    * 
+    * linalg::Matrix<int> A{3, 4, 1};
+    * linalg::Matrix<int> B{3, 4, 2};
+    * linalg::Matrix<int> bias{{1, 2, 3, 4}};
+    * A += B * 2; // all elements are 5
+    * A += bias;  // every row is [6 7 8 9]
+    * 
+    * 
+    * @param expr - Element-wise expression of Matrix objects.
+    * @return Reference to this Matrix object.
+    */
+    template <typename E>
+    Matrix<T>& operator+= (const MatrixExpression<E>& expr)
+    {
+        checkCompoundSize(expr.derived());
+        detail::BroadcastOperand<E> src(expr.derived(), m_rows, m_cols);
+        detail::evaluate<detail::AddAssignOp>(m_data.data(), m_rows, m_cols, src);
+        return *this;
+    }
+
+   /**
+    * @brief Element-wise compound subtraction.
+    *
+    * Subtracts the expression from this Matrix object in place. Rows and 
+    * columns are broadcast the same way as operator+=.
+    * 
+    * 
+    * @param expr - Element-wise expression of Matrix objects.
+    * @return Reference to this Matrix object.
+    */
+    template <typename E>
+    Matrix<T>& operator-= (const MatrixExpression<E>& expr)
+    {
+        checkCompoundSize(expr.derived());
+        detail::BroadcastOperand<E> src(expr.derived(), m_rows, m_cols);
+        detail::evaluate<detail::SubtractAssignOp>(m_data.data(), m_rows, m_cols, src);
+        return *this;
+    }
+
+   /**
+    * @brief Multiplies every element by a constant in place.
+    * 
+    * 
+    * @example
+    * 
+    * #include "Matrix.h"
+    * 
+    * linalg::Matrix<int> A{3, 4, 1};
+    * A *= 3; // all elements are 3
+    * 
+    * 
+    * @param scalar - The constant, of the same type as the elements.
+    * @return Reference to this Matrix object.
+    */
+    Matrix<T>& operator*= (const T& scalar)
+    {
+        detail::evaluate<detail::AssignOp>(m_data.data(), m_rows, m_cols, *this * scalar);
+        return *this;
+    }
+
+   /**
+    * @brief Access to the element at the given row and column.
+    * 
+    * Indices are not checked.
+    * 
+    * 
+    * @example
+    * 
+    * #include "Matrix.h"
+    * 
+    * linalg::Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};
+    * A(1, 2) = 7;
+    * std::cout << A(0, 1); // Output: 2
+    * 
+    * 
+    * @param row - Row index, starting from 0.
+    * @param col - Column index, starting from 0.
+    * @return Reference to the element.
+    */
+    T& operator() (size_t row, size_t col)
     {
+        return m_data[row * m_cols + col];
+    }
+
+    const T& operator() (size_t row, size_t col) const
+    {
+        return m_data[row * m_cols + col];
+    }
+
+   /**
+    * @brief Returns the number of rows of the Matrix object.
+    */
+    size_t rows() const
+    {
+        return m_rows;
+    }
+
+   /**
+    * @brief Returns the number of columns of the Matrix object.
+    */
+    size_t cols() const
+    {
+        return m_cols;
+    }
+
+   /**
+    * @brief Returns a pointer to the first element.
+    *
+    * The elements are stored contiguously in row-major order, so element 
+    * (row, col) is at data()[row * cols() + col].
+    */
+    T* data()
+    {
+        return m_data.data();
+    }
+
+    const T* data() const
+    {
+        return m_data.data();
     }
 
    /**
@@ -211,7 +411,7 @@ public:
     * 
     * @return The transpose of the Matrix object.
     */
-    Matrix<T> transpose();
+    Matrix<T> transpose() const;
 
    /**
     * @brief Returns the size of the Matrix object in a Pair.
@@ -233,7 +433,39 @@ public:
     * 
     * @return The size of the Matrix object as STL Pair.
     */
-    std::pair<size_t, size_t> size();
+    std::pair<size_t, size_t> size() const;
+
+   /**
+    * @brief Gives the Matrix object new dimensions with the same number of
+    * elements.
+    *
+    * The elements keep their row-major order, so only the dimensions change
+    * and nothing is copied. Assertion error is raised if rows * cols is not
+    * the number of elements.
+    *
+    *
+    * @example
+    *
+    * #include "Matrix.h"
+    *
+    * linalg::Matrix<int> A{{1, 2, 3, 4, 5, 6}}; // size: (1, 6)
+    * A.reshape(2, 3);
+    * std::cout << A; // [[1 2 3] [4 5 6]]
+    *
+    *
+    * @param rows - The new number of rows.
+    * @param cols - The new number of columns.
+    */
+    void reshape(size_t rows, size_t cols)
+    {
+        if (rows * cols != m_data.size())
+        {
+            std::cerr << "Reshape - Number of elements do not match" << std::endl;
+            std::abort();
+        }
+        m_rows = rows;
+        m_cols = cols;
+    }
 
    /**
     * @brief Output stream overload function for Matrix object.
@@ -311,31 +543,40 @@ public:
     static bool isSame(const linalg::Matrix<T>& m1, const linalg::Matrix<T>& m2);
 
 private:
-    // The actual 2D Matrix.
-    std::vector<std::vector<T>> m_matrix;
+    template <typename E>
+    void checkCompoundSize(const E& expr) const
+    {
+        // The right-hand side can only be broadcast, the left-hand side 
+        // keeps its size.
+        if ((expr.rows() != m_rows && expr.rows() != 1) || (expr.cols() != m_cols && expr.cols() != 1))
+        {
+            std::cerr << "Compound assignment - Matrix dimension do not match" << std::endl;
+            std::abort();
+        }
+    }
+
+    // Dimensions of the Matrix.
+    size_t m_rows;
+    size_t m_cols;
+
+    // The actual 2D Matrix, stored row after row.
+    std::vector<T> m_data;
 };
 
 template <typename T>
 Matrix<T> operator*(const Matrix<T>& mat1, const Matrix<T>& mat2)
 {
-    if (mat1.m_matrix[0].size() != mat2.m_matrix.size())
+    if (mat1.m_cols != mat2.m_rows)
     {
         std::cerr << "Matrix dimension do not match" << std::endl;
         std::abort();
     }
 
-    Matrix<T> res(mat1.m_matrix.size(), mat2.m_matrix[0].size());
+    Matrix<T> res(mat1.m_rows, mat2.m_cols);
 
-    for (int i=0; i<res.m_matrix.size(); i++)
-    {
-        for (int k=0; k<mat1.m_matrix[0].size(); k++)
-        {
-            for (int j=0; j<res.m_matrix[i].size(); j++)
-            {
-                res.m_matrix[i][j] += mat1.m_matrix[i][k] * mat2.m_matrix[k][j];
-            }
-        }
-    }
+    // Blocked and multithreaded, see gemm.h.
+    detail::gemm(Transpose::No, Transpose::No, mat1.m_rows, mat2.m_cols, mat1.m_cols, T(1),
+                 mat1.data(), mat1.m_cols, mat2.data(), mat2.m_cols, T(0), res.data(), res.m_cols);
 
     return res;
 }
@@ -361,29 +602,51 @@ Matrix<T> operator*(const Matrix<T>& mat1, const Matrix<T>& mat2)
 //     return res;
 // }
 
-// TODO: can this be done in-place
-template <typename T>
-Matrix<T> Matrix<T>::transpose()
+namespace detail
 {
-    // Initialize the output matrix.
-    // Notice the dimensions are switched.
-    Matrix<T> res(m_matrix[0].size(), m_matrix.size());
+// Side of the square tiles of transposeBlock().
+const size_t TRANSPOSE_TILE = 32;
 
-    for (int i=0; i<m_matrix.size(); i++)
+// Writes the transpose of the rows x cols block at src, with leading
+// dimension lds, to dst, with leading dimension ldd. It goes a tile at a
+// time, so the rows read and the rows written both stay in cache.
+template <typename T>
+void transposeBlock(size_t rows, size_t cols, const T* src, size_t lds, T* dst, size_t ldd)
+{
+    for (size_t i0=0; i0<rows; i0+=TRANSPOSE_TILE)
     {
-        for (int j=0; j<m_matrix[0].size(); j++)
+        size_t i1 = std::min(rows, i0 + TRANSPOSE_TILE);
+        for (size_t j0=0; j0<cols; j0+=TRANSPOSE_TILE)
         {
-            res.m_matrix[j][i] = m_matrix[i][j];
+            size_t j1 = std::min(cols, j0 + TRANSPOSE_TILE);
+            for (size_t j=j0; j<j1; j++)
+            {
+                for (size_t i=i0; i<i1; i++)
+                {
+                    dst[j * ldd + i] = src[i * lds + j];
+                }
+            }
         }
     }
+}
+} // namespace detail
+
+// TODO: can this be done in-place
+template <typename T>
+Matrix<T> Matrix<T>::transpose() const
+{
+    // Initialize the output matrix.
+    // Notice the dimensions are switched.
+    Matrix<T> res(m_cols, m_rows);
+    detail::transposeBlock(m_rows, m_cols, m_data.data(), m_cols, res.m_data.data(), m_rows);
     return res;
 }
 
 template <typename T>
-std::pair<size_t, size_t> Matrix<T>::size()
+std::pair<size_t, size_t> Matrix<T>::size() const
 {
     // row, col
-    return std::make_pair(this->m_matrix.size(), this->m_matrix[0].size());
+    return std::make_pair(this->m_rows, this->m_cols);
 }
 
 template <typename T>
@@ -391,12 +654,12 @@ std::ostream& operator<< (std::ostream& output, const Matrix<T>& mat)
 {
     // Pushes the first (N-1) rows in the buffer.
     output << '[';
-    for (int i=0; i<mat.m_matrix.size()-1; i++)
+    for (int i=0; i<mat.m_rows-1; i++)
     {
         output << "[ ";
-        for (int j=0; j<mat.m_matrix[i].size(); j++)
+        for (int j=0; j<mat.m_cols; j++)
         {
-            output << mat.m_matrix[i][j] << ' ';
+            output << mat(i, j) << ' ';
         }
         output << "]";
         output << "\n ";
@@ -405,12 +668,12 @@ std::ostream& operator<< (std::ostream& output, const Matrix<T>& mat)
     // Pushes the last row in the buffer.
     // This is done to print the matrix properly.
     // Otherwise, the last bracket is printed on the next line.
-    for (int i=mat.m_matrix.size()-1; i<mat.m_matrix.size(); i++)
+    for (int i=mat.m_rows-1; i<mat.m_rows; i++)
     {
         output << "[ ";
-        for (int j=0; j<mat.m_matrix[i].size(); j++)
+        for (int j=0; j<mat.m_cols; j++)
         {
-            output << mat.m_matrix[i][j] << ' ';
+            output << mat(i, j) << ' ';
         }
         output << "]";
     }
@@ -428,7 +691,7 @@ std::ostream& operator<< (std::ostream& output, const std::pair<size_t, size_t>&
 template <typename T>
 bool operator== (const Matrix<T>& m1, const Matrix<T>& m2)
 {
-    return (m1.m_matrix == m2.m_matrix);
+    return (m1.m_rows == m2.m_rows && m1.m_cols == m2.m_cols && m1.m_data == m2.m_data);
 }
 
 template <typename T>
@@ -0,0 +1,287 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_MATRIX_FUNCTIONS_H
+#define MATRIX_MATRIX_FUNCTIONS_H
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gemm.h"
+#include "lu.h"
+#include "matrix.h"
+#include "reduction.h"
+
+
+namespace linalg
+{
+namespace detail
+{
+template <typename T>
+void checkSquare(const Matrix<T>& mat, const char* name)
+{
+    if (mat.rows() != mat.cols())
+    {
+        std::cerr << name << " - Matrix should be square" << std::endl;
+        std::abort();
+    }
+}
+
+// out = lhs * rhs for square Matrix objects of the same size, into existing storage.
+template <typename T>
+void multiplyInto(const Matrix<T>& lhs, const Matrix<T>& rhs, Matrix<T>& out)
+{
+    size_t n = lhs.rows();
+    gemm(Transpose::No, Transpose::No, n, n, n, T(1), lhs.data(), n, rhs.data(), n, T(0), out.data(), n);
+}
+
+// mat = mat * mat, squaring through the scratch buffer, count times.
+template <typename T>
+void squareRepeatedly(Matrix<T>& mat, Matrix<T>& scratch, size_t count)
+{
+    for (size_t i=0; i<count; i++)
+    {
+        multiplyInto(mat, mat, scratch);
+        std::swap(mat, scratch);
+    }
+}
+
+template <typename T>
+void addIdentity(Matrix<T>& mat, T scale)
+{
+    for (size_t i=0; i<mat.rows(); i++)
+    {
+        mat(i, i) += scale;
+    }
+}
+
+// Largest 1-norm for which the Pade approximant of each degree in expm() is
+// accurate to double precision, from Higham, "The scaling and squaring method
+// for the matrix exponential revisited", 2005.
+const double PADE_THETA[] = {1.495585217958292e-2, 2.539398330063230e-1, 9.504178996162932e-1,
+                             2.097847961257068, 5.371920351148152};
+const int PADE_DEGREE[] = {3, 5, 7, 9, 13};
+
+// Coefficients of the numerator of the Pade approximant of degree 13, and of
+// the lower degrees.
+const double PADE_13[] = {64764752532480000.0, 32382376266240000.0, 7771770303897600.0,
+                          1187353796428800.0, 129060195264000.0, 10559470521600.0, 670442572800.0,
+                          33522128640.0, 1323241920.0, 40840800.0, 960960.0, 16380.0, 182.0, 1.0};
+const double PADE_9[] = {17643225600.0, 8821612800.0, 2075673600.0, 302702400.0, 30270240.0,
+                         2162160.0, 110880.0, 3960.0, 90.0, 1.0};
+const double PADE_7[] = {17297280.0, 8648640.0, 1995840.0, 277200.0, 25200.0, 1512.0, 56.0, 1.0};
+const double PADE_5[] = {30240.0, 15120.0, 3360.0, 420.0, 30.0, 1.0};
+const double PADE_3[] = {120.0, 60.0, 12.0, 1.0};
+
+/*
+ * Returns the Pade approximant of degree 3 to 9 of exp(mat), given the even
+ * powers mat^2, mat^4, ... in powers. U holds the odd terms and V the even
+ * ones, and the approximant is (V - U)^-1 (V + U).
+ */
+template <typename T>
+Matrix<T> padeLowDegree(const Matrix<T>& mat, const std::vector<Matrix<T>>& powers, const double* b, int degree)
+{
+    size_t n = mat.rows();
+    Matrix<T> odd(n, n);
+    Matrix<T> even(n, n);
+    addIdentity(odd, T(b[1]));
+    addIdentity(even, T(b[0]));
+    for (int k=2; k<=degree; k+=2)
+    {
+        const Matrix<T>& power = powers[k / 2 - 1];
+        odd += T(b[k + 1]) * power;
+        even += T(b[k]) * power;
+    }
+    Matrix<T> u(n, n);
+    multiplyInto(mat, odd, u);
+    return solve(Matrix<T>{even - u}, Matrix<T>{even + u});
+}
+
+// Pade approximant of degree 13, with the terms grouped as in Higham (2005)
+// so that only six matrix multiplications are needed.
+template <typename T>
+Matrix<T> padeDegree13(const Matrix<T>& mat, const Matrix<T>& a2, const Matrix<T>& a4, const Matrix<T>& a6)
+{
+    const double* b = PADE_13;
+    size_t n = mat.rows();
+    Matrix<T> inner(T(b[13]) * a6 + T(b[11]) * a4 + T(b[9]) * a2);
+    Matrix<T> odd(n, n);
+    multiplyInto(a6, inner, odd);
+    odd += T(b[7]) * a6 + T(b[5]) * a4 + T(b[3]) * a2;
+    addIdentity(odd, T(b[1]));
+    Matrix<T> u(n, n);
+    multiplyInto(mat, odd, u);
+
+    inner = T(b[12]) * a6 + T(b[10]) * a4 + T(b[8]) * a2;
+    Matrix<T> even(n, n);
+    multiplyInto(a6, inner, even);
+    even += T(b[6]) * a6 + T(b[4]) * a4 + T(b[2]) * a2;
+    addIdentity(even, T(b[0]));
+    return solve(Matrix<T>{even - u}, Matrix<T>{even + u});
+}
+} // namespace detail
+
+/**
+ * @brief Returns mat raised to a non-negative integer power.
+ *
+ * Uses repeated squaring, so about 2 * log2(exponent) matrix multiplications
+ * are needed. Products are written into three buffers allocated up front and
+ * swapped, so no memory is allocated per step.
+ *
+ *
+ * @example
+ *
+ * #include "matrix_functions.h"
+ *
+ * linalg::Matrix<double> transition{{{0.9, 0.1}, {0.5, 0.5}}};
+ * linalg::Matrix<double> longRun{linalg::pow(transition, 1000)};
+ * // every row is the stationary distribution [0.833 0.167]
+ *
+ *
+ * @param mat - Square Matrix object.
+ * @param exponent - The power. 0 returns the identity.
+ * @return mat^exponent.
+ */
+template <typename T>
+Matrix<T> pow(const Matrix<T>& mat, size_t exponent)
+{
+    detail::checkSquare(mat, "Matrix power");
+    size_t n = mat.rows();
+    if (exponent == 0)
+    {
+        Matrix<T> res(n, n);
+        detail::addIdentity(res, T(1));
+        return res;
+    }
+
+    // Squares of mat are built in base. res only starts to be multiplied
+    // once the lowest set bit has been found, instead of starting from I.
+    Matrix<T> base{mat};
+    Matrix<T> res(n, n);
+    Matrix<T> scratch(n, n);
+    bool started = false;
+    while (true)
+    {
+        if (exponent & 1)
+        {
+            if (started)
+            {
+                detail::multiplyInto(res, base, scratch);
+                std::swap(res, scratch);
+            }
+            else
+            {
+                std::copy(base.data(), base.data() + n * n, res.data());
+                started = true;
+            }
+        }
+        exponent >>= 1;
+        if (exponent == 0)
+        {
+            break;
+        }
+        detail::squareRepeatedly(base, scratch, 1);
+    }
+    return res;
+}
+
+/**
+ * @brief Returns the matrix exponential exp(mat).
+ *
+ * Scaling and squaring with Pade approximants (Higham, 2005). The degree of
+ * the approximant, 3 to 13, is chosen from the 1-norm of mat. Above the
+ * range of degree 13, mat is scaled by 2^-s, and the result is squared s
+ * times. The thresholds are the double precision ones, which are also safe,
+ * if a little conservative, for float. All products use the multithreaded
+ * matrix multiplication kernel.
+ *
+ *
+ * @example
+ *
+ * #include "matrix_functions.h"
+ *
+ * linalg::Matrix<double> generator{{{-0.3, 0.3}, {0.1, -0.1}}};
+ * linalg::Matrix<double> transition{linalg::expm(generator * 2.0)};
+ *
+ *
+ * @param mat - Square Matrix object of float or double.
+ * @return exp(mat), or a Matrix object of NaN when mat has an Inf or NaN element.
+ */
+template <typename T>
+Matrix<T> expm(const Matrix<T>& mat)
+{
+    static_assert(std::is_floating_point<T>::value, "expm needs a floating point Matrix");
+    detail::checkSquare(mat, "Matrix exponential");
+    size_t n = mat.rows();
+    if (n == 0)
+    {
+        return mat;
+    }
+
+    // Inf or NaN elements: no scaling works, so the result is all NaN.
+    double norm = static_cast<double>(norm1(mat));
+    if (!std::isfinite(norm))
+    {
+        return Matrix<T>(n, n, std::numeric_limits<T>::quiet_NaN());
+    }
+    const double* coefficients[] = {detail::PADE_3, detail::PADE_5, detail::PADE_7, detail::PADE_9};
+    std::vector<Matrix<T>> powers;
+    for (int i=0; i<4; i++)
+    {
+        if (norm <= detail::PADE_THETA[i])
+        {
+            int degree = detail::PADE_DEGREE[i];
+            powers.push_back(Matrix<T>(n, n));
+            detail::multiplyInto(mat, mat, powers[0]);
+            for (int k=4; k<=degree; k+=2)
+            {
+                powers.push_back(Matrix<T>(n, n));
+                detail::multiplyInto(powers[0], powers[powers.size() - 2], powers.back());
+            }
+            return detail::padeLowDegree(mat, powers, coefficients[i], degree);
+        }
+    }
+
+    size_t squarings = 0;
+    if (norm > detail::PADE_THETA[4])
+    {
+        squarings = static_cast<size_t>(std::ceil(std::log2(norm / detail::PADE_THETA[4])));
+    }
+    Matrix<T> scaled{mat * static_cast<T>(std::ldexp(1.0, -static_cast<int>(squarings)))};
+    Matrix<T> a2(n, n);
+    Matrix<T> a4(n, n);
+    Matrix<T> a6(n, n);
+    detail::multiplyInto(scaled, scaled, a2);
+    detail::multiplyInto(a2, a2, a4);
+    detail::multiplyInto(a2, a4, a6);
+    Matrix<T> res{detail::padeDegree13(scaled, a2, a4, a6)};
+
+    // a2 is reused as the scratch buffer of the squarings.
+    detail::squareRepeatedly(res, a2, squarings);
+    return res;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_MATRIX_FUNCTIONS_H
@@ -0,0 +1,280 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATRIX_PARALLEL_H
+#define MATRIX_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace linalg
+{
+namespace detail
+{
+inline std::atomic<size_t>& threadCount()
+{
+    static std::atomic<size_t> count{std::max<size_t>(1, std::thread::hardware_concurrency())};
+    return count;
+}
+} // namespace detail
+
+/**
+ * @brief Sets the number of threads used by the library.
+ *
+ * Defaults to the number of hardware threads. Setting it to 1 makes
+ * every operation run on the calling thread.
+ *
+ *
+ * @example
+ *
+ * #include "parallel.h"
+ *
+ * linalg::setNumThreads(4);
+ *
+ *
+ * @param num - Number of threads. Values below 1 are treated as 1.
+ */
+inline void setNumThreads(size_t num)
+{
+    detail::threadCount() = std::max<size_t>(1, num);
+}
+
+/**
+ * @brief Returns the number of threads used by the library.
+ */
+inline size_t getNumThreads()
+{
+    return detail::threadCount();
+}
+
+/**
+ * @brief A fixed set of worker threads that run queued tasks.
+ *
+ * The library owns a single pool, created on first use. Workers are added
+ * lazily when more threads are requested and are joined at program exit.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator= (const ThreadPool&) = delete;
+
+   /**
+    * @brief Returns the pool shared by the whole library.
+    */
+    static ThreadPool& instance()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        for (size_t i=0; i<m_workers.size(); i++)
+        {
+            m_workers[i].join();
+        }
+    }
+
+   /**
+    * @brief Makes sure at least the given number of workers are running.
+    *
+    * @param workers - Minimum number of worker threads.
+    */
+    void reserve(size_t workers)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (m_workers.size() < workers)
+        {
+            m_workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+   /**
+    * @brief Queues a task to be run by one of the workers.
+    *
+    * @param task - The task to run.
+    */
+    void enqueue(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+   /**
+    * @brief Queues a task and returns a future of its result.
+    *
+    * The task may itself use the library, whose parallel loops also run on
+    * the calling thread, so it makes progress even when every worker is busy.
+    * Waiting on the future from inside another pool task can deadlock if all
+    * workers are waiting.
+    *
+    *
+    * @example
+    *
+    * #include "parallel.h"
+    *
+    * std::future<int> answer{linalg::ThreadPool::instance().submit([] { return 42; })};
+    * std::cout << answer.get(); // 42
+    *
+    *
+    * @param function - Callable without arguments.
+    * @return Future of the value returned by the function.
+    */
+    template <typename Function>
+    std::future<typename std::result_of<Function()>::type> submit(Function function)
+    {
+        typedef typename std::result_of<Function()>::type Result;
+        std::shared_ptr<std::packaged_task<Result()>> task =
+            std::make_shared<std::packaged_task<Result()>>(std::move(function));
+        std::future<Result> res = task->get_future();
+        reserve(1);
+        enqueue([task]() { (*task)(); });
+        return res;
+    }
+
+   /**
+    * @brief Returns the number of worker threads.
+    */
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_workers.size();
+    }
+
+private:
+    ThreadPool()
+        : m_stop{false}
+    {
+    }
+
+    void work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop;
+};
+
+namespace detail
+{
+// Bookkeeping shared between the caller of parallelFor and its helpers.
+struct ParallelForState
+{
+    std::atomic<size_t> next{0};
+    size_t remaining{0};
+    std::mutex mutex;
+    std::condition_variable done;
+};
+
+/*
+ * Splits [begin, end) into contiguous chunks of at least `grain` indices and
+ * calls function(chunkBegin, chunkEnd) for each of them on the thread pool.
+ *
+ * The calling thread takes chunks as well, so a parallelFor issued from
+ * inside a pool task never waits on a worker that is not running.
+ */
+template <typename Function>
+void parallelFor(size_t begin, size_t end, size_t grain, const Function& function)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    size_t length = end - begin;
+    size_t chunks = std::min(getNumThreads(), (length + std::max<size_t>(grain, 1) - 1) / std::max<size_t>(grain, 1));
+    if (chunks <= 1)
+    {
+        function(begin, end);
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->remaining = chunks;
+
+    std::function<void()> run = [state, chunks, begin, length, &function]()
+    {
+        size_t chunk;
+        while ((chunk = state->next++) < chunks)
+        {
+            function(begin + chunk * length / chunks, begin + (chunk + 1) * length / chunks);
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->remaining == 0)
+            {
+                state->done.notify_all();
+            }
+        }
+    };
+
+    ThreadPool& pool = ThreadPool::instance();
+    pool.reserve(getNumThreads() - 1);
+    for (size_t i=1; i<chunks; i++)
+    {
+        pool.enqueue(run);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state] { return state->remaining == 0; });
+}
+} // namespace detail
+
+}; // namespace linalg
+
+#endif // MATRIX_PARALLEL_H
@@ -0,0 +1,547 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_QR_H
+#define MATRIX_QR_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "triangular.h"
+
+
+namespace linalg
+{
+// Number of Householder reflectors combined into one block reflector.
+const size_t QR_BLOCK = 32;
+
+// Rows summed by one task when a reflector is applied inside a panel. Fixed,
+// so the result does not depend on the number of threads.
+const size_t QR_ROW_CHUNK = 1024;
+
+// Smallest number of rows of one block of the tall-skinny QR in leastSquares().
+const size_t TSQR_BLOCK_ROWS = 2048;
+
+namespace detail
+{
+/*
+ * Householder reflector H = I - tau v v^T with H x = (beta, 0, ..., 0), for
+ * the vector x of length len with stride. x[0] is replaced with beta and the
+ * rest of x with v, whose first element is an implicit 1. Returns tau.
+ */
+template <typename T>
+T householder(T* x, size_t len, size_t stride)
+{
+    T alpha = x[0];
+    T tail = T(0);
+    for (size_t i=1; i<len; i++)
+    {
+        tail += x[i * stride] * x[i * stride];
+    }
+    if (tail == T(0))
+    {
+        return T(0);
+    }
+
+    T beta = -std::copysign(std::sqrt(alpha * alpha + tail), alpha);
+    T scale = T(1) / (alpha - beta);
+    for (size_t i=1; i<len; i++)
+    {
+        x[i * stride] *= scale;
+    }
+    x[0] = beta;
+    return (beta - alpha) / beta;
+}
+
+/*
+ * Unblocked Householder QR of the columns [k0, k0 + kb) of the m-row buffer a,
+ * over the rows [k0, m). Reflectors are only applied inside the panel.
+ */
+template <typename T>
+void qrPanel(T* a, size_t lda, size_t m, size_t k0, size_t kb, T* tau)
+{
+    std::vector<T> partial;
+    std::vector<T> w;
+    size_t last = k0 + kb;
+    for (size_t j=k0; j<last; j++)
+    {
+        tau[j] = householder(a + j * lda + j, m - j, lda);
+        size_t first = j + 1;
+        size_t width = last - first;
+        if (width == 0 || tau[j] == T(0))
+        {
+            continue;
+        }
+
+        // w = tau * v^T A(j:m, first:last), with partial sums over fixed chunks of rows.
+        size_t chunks = (m - first + QR_ROW_CHUNK - 1) / QR_ROW_CHUNK;
+        partial.assign(chunks * width, T(0));
+        parallelFor(0, chunks, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t c=begin; c<end; c++)
+            {
+                T* out = partial.data() + c * width;
+                size_t stop = std::min(m, first + (c + 1) * QR_ROW_CHUNK);
+                for (size_t i=first+c*QR_ROW_CHUNK; i<stop; i++)
+                {
+                    T v = a[i * lda + j];
+                    const T* row = a + i * lda + first;
+                    for (size_t q=0; q<width; q++)
+                    {
+                        out[q] += v * row[q];
+                    }
+                }
+            }
+        });
+        w.assign(a + j * lda + first, a + j * lda + last);
+        for (size_t c=0; c<chunks; c++)
+        {
+            for (size_t q=0; q<width; q++)
+            {
+                w[q] += partial[c * width + q];
+            }
+        }
+        for (size_t q=0; q<width; q++)
+        {
+            w[q] *= tau[j];
+            a[j * lda + first + q] -= w[q];
+        }
+
+        // A(j+1:m, first:last) -= v w^T
+        const T* update = w.data();
+        parallelFor(first, m, std::max<size_t>(1, ELEMENTWISE_GRAIN / width), [=](size_t begin, size_t end)
+        {
+            for (size_t i=begin; i<end; i++)
+            {
+                T* row = a + i * lda;
+                T v = row[j];
+                for (size_t q=0; q<width; q++)
+                {
+                    row[first + q] -= v * update[q];
+                }
+            }
+        });
+    }
+}
+
+/*
+ * Compact WY form I - V T V^T of the reflectors [k0, k0 + kb) of a factored
+ * buffer. V is stored explicitly, with its unit diagonal and zeros above it,
+ * so that applying the block goes through the matrix multiplication kernel.
+ */
+template <typename T>
+class BlockReflector
+{
+public:
+    BlockReflector(const T* a, size_t lda, size_t m, size_t k0, size_t kb, const T* tau)
+        : m_rows{m - k0}, m_width{kb}, m_v(m_rows * kb), m_t(kb * kb, T(0))
+    {
+        T* v = m_v.data();
+        parallelFor(0, m_rows, std::max<size_t>(1, ELEMENTWISE_GRAIN / kb), [=](size_t begin, size_t end)
+        {
+            for (size_t i=begin; i<end; i++)
+            {
+                const T* row = a + (k0 + i) * lda + k0;
+                for (size_t q=0; q<kb; q++)
+                {
+                    v[i * kb + q] = (q < i) ? row[q] : T(q == i);
+                }
+            }
+        });
+
+        // T is upper triangular: T(0:i, i) = -tau_i T(0:i, 0:i) V(:, 0:i)^T v_i.
+        std::vector<T> gram(kb * kb);
+        gemm(Transpose::Yes, Transpose::No, kb, kb, m_rows, T(1), v, kb, v, kb, T(0), gram.data(), kb);
+        for (size_t i=0; i<kb; i++)
+        {
+            T scale = tau[k0 + i];
+            m_t[i * kb + i] = scale;
+            for (size_t p=0; p<i; p++)
+            {
+                T value = T(0);
+                for (size_t q=p; q<i; q++)
+                {
+                    value += m_t[p * kb + q] * gram[q * kb + i];
+                }
+                m_t[p * kb + i] = -scale * value;
+            }
+        }
+    }
+
+    /*
+     * C = Q C, or Q^T C, where Q = I - V T V^T and C holds the rows [k0, m)
+     * of a buffer with n columns.
+     */
+    void apply(Transpose trans, T* c, size_t ldc, size_t n) const
+    {
+        size_t kb = m_width;
+        std::vector<T> w(kb * n);
+        gemm(Transpose::Yes, Transpose::No, kb, n, m_rows, T(1), m_v.data(), kb, c, ldc, T(0), w.data(), n);
+
+        // W = op(T) W, in place, by columns ranges.
+        const T* t = m_t.data();
+        T* out = w.data();
+        parallelFor(0, n, TRIANGULAR_GRAIN, [=](size_t begin, size_t end)
+        {
+            for (size_t step=0; step<kb; step++)
+            {
+                size_t i = (trans == Transpose::Yes) ? kb - 1 - step : step;
+                T* row = out + i * n;
+                for (size_t j=begin; j<end; j++)
+                {
+                    row[j] *= t[i * kb + i];
+                }
+                size_t first = (trans == Transpose::Yes) ? 0 : i + 1;
+                size_t last = (trans == Transpose::Yes) ? i : kb;
+                for (size_t p=first; p<last; p++)
+                {
+                    T factor = (trans == Transpose::Yes) ? t[p * kb + i] : t[i * kb + p];
+                    const T* other = out + p * n;
+                    for (size_t j=begin; j<end; j++)
+                    {
+                        row[j] += factor * other[j];
+                    }
+                }
+            }
+        });
+
+        gemm(Transpose::No, Transpose::No, m_rows, n, kb, T(-1), m_v.data(), kb, w.data(), n, T(1), c, ldc);
+    }
+
+private:
+    size_t m_rows;
+    size_t m_width;
+    std::vector<T> m_v;
+    std::vector<T> m_t;
+};
+
+/*
+ * Blocked Householder QR of the m x n buffer a, in place. The first kmax
+ * columns are factored, and every block reflector is applied to all the
+ * columns on its right. R ends up in the upper triangle and the reflectors
+ * below it.
+ */
+template <typename T>
+void qrFactor(T* a, size_t lda, size_t m, size_t n, size_t kmax, std::vector<T>& tau)
+{
+    size_t steps = std::min(kmax, std::min(m, n));
+    tau.assign(steps, T(0));
+    for (size_t k0=0; k0<steps; k0+=QR_BLOCK)
+    {
+        size_t kb = std::min(QR_BLOCK, steps - k0);
+        qrPanel(a, lda, m, k0, kb, tau.data());
+        if (k0 + kb < n)
+        {
+            BlockReflector<T> block(a, lda, m, k0, kb, tau.data());
+            block.apply(Transpose::Yes, a + k0 * lda + k0 + kb, lda, n - k0 - kb);
+        }
+    }
+}
+
+template <typename T>
+void checkLeastSquaresInput(const Matrix<T>& lhs, const Matrix<T>& rhs)
+{
+    if (lhs.rows() < lhs.cols())
+    {
+        std::cerr << "QR - Matrix should have at least as many rows as columns" << std::endl;
+        std::abort();
+    }
+    if (rhs.rows() != lhs.rows())
+    {
+        std::cerr << "QR solve - Matrix dimension do not match" << std::endl;
+        std::abort();
+    }
+}
+
+/*
+ * True when no diagonal element of the n x n triangle R is below
+ * rows * epsilon * max|R(i, i)|, the usual numerical rank threshold.
+ */
+template <typename T>
+bool isFullRank(const T* r, size_t ldr, size_t n, size_t rows)
+{
+    T largest = T(0);
+    for (size_t i=0; i<n; i++)
+    {
+        largest = std::max(largest, std::abs(r[i * ldr + i]));
+    }
+    T threshold = static_cast<T>(std::max(rows, n)) * std::numeric_limits<T>::epsilon() * largest;
+    for (size_t i=0; i<n; i++)
+    {
+        if (!(std::abs(r[i * ldr + i]) > threshold))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void checkFullRank(const T* r, size_t ldr, size_t n, size_t rows)
+{
+    if (!isFullRank(r, ldr, n, rows))
+    {
+        std::cerr << "QR solve - Matrix is rank deficient" << std::endl;
+        std::abort();
+    }
+}
+} // namespace detail
+
+/**
+ * @brief Householder QR factorization A = Q R of an m x n Matrix object with
+ * m >= n.
+ *
+ * Reflectors are grouped QR_BLOCK at a time in compact WY form, so the
+ * update of the rest of the matrix goes through the multithreaded matrix
+ * multiplication kernel. Q is not formed unless asked for.
+ *
+ *
+ * @example
+ *
+ * #include "qr.h"
+ *
+ * linalg::Matrix<double> A{{{1, 1}, {1, 2}, {1, 3}}};
+ * linalg::Matrix<double> y{{{1, 0}, {2, 0}, {2, 0}}};
+ * linalg::QRDecomposition<double> qr{A};
+ * std::cout << qr.solve(y); // least-squares fit, first column [[0.667] [0.5]]
+ *
+ *
+ * @param mat - Matrix object with at least as many rows as columns. Pass it
+ *              with std::move to factor it without a copy.
+ */
+template <typename T>
+class QRDecomposition
+{
+public:
+    static_assert(std::is_floating_point<T>::value, "QRDecomposition needs a floating point Matrix");
+
+    explicit QRDecomposition(Matrix<T> mat)
+        : m_factors{std::move(mat)}
+    {
+        if (m_factors.rows() < m_factors.cols())
+        {
+            std::cerr << "QR - Matrix should have at least as many rows as columns" << std::endl;
+            std::abort();
+        }
+        detail::qrFactor(m_factors.data(), m_factors.cols(), m_factors.rows(), m_factors.cols(),
+                         m_factors.cols(), m_tau);
+    }
+
+   /**
+    * @brief Returns the X which minimizes the 2-norm of A X - B, column by
+    * column.
+    *
+    * The program is aborted if the number of rows of B does not match or
+    * A is rank deficient, see isFullRank().
+    *
+    *
+    * @param rhs - Matrix object B with as many rows as A.
+    * @return n x B.cols() Matrix object X.
+    */
+    Matrix<T> solve(const Matrix<T>& rhs) const
+    {
+        detail::checkLeastSquaresInput(m_factors, rhs);
+        size_t n = m_factors.cols();
+        detail::checkFullRank(m_factors.data(), n, n, m_factors.rows());
+
+        Matrix<T> qtb{rhs};
+        multiplyQ(Transpose::Yes, qtb);
+        Matrix<T> res(n, rhs.cols());
+        std::copy(qtb.data(), qtb.data() + n * rhs.cols(), res.data());
+        detail::trsmLeft(Triangle::Upper, Transpose::No, Diagonal::NonUnit, n, res.cols(),
+                         m_factors.data(), n, res.data(), res.cols());
+        return res;
+    }
+
+   /**
+    * @brief Replaces B with Q B, or with Q^T B, where Q is the m x m
+    * orthogonal factor.
+    *
+    *
+    * @param trans - Transpose::Yes to multiply by Q^T.
+    * @param mat - Matrix object B with m rows.
+    */
+    void multiplyQ(Transpose trans, Matrix<T>& mat) const
+    {
+        size_t m = m_factors.rows();
+        size_t n = m_factors.cols();
+        if (mat.rows() != m)
+        {
+            std::cerr << "QR - Matrix dimension do not match" << std::endl;
+            std::abort();
+        }
+
+        size_t blocks = (m_tau.size() + QR_BLOCK - 1) / QR_BLOCK;
+        for (size_t step=0; step<blocks; step++)
+        {
+            size_t block = (trans == Transpose::Yes) ? step : blocks - 1 - step;
+            size_t k0 = block * QR_BLOCK;
+            size_t kb = std::min(QR_BLOCK, m_tau.size() - k0);
+            detail::BlockReflector<T> reflector(m_factors.data(), n, m, k0, kb, m_tau.data());
+            reflector.apply(trans, mat.data() + k0 * mat.cols(), mat.cols(), mat.cols());
+        }
+    }
+
+   /**
+    * @brief Returns the first n columns of Q, an m x n Matrix object with
+    * orthonormal columns.
+    */
+    Matrix<T> q() const
+    {
+        Matrix<T> res(m_factors.rows(), m_factors.cols());
+        for (size_t i=0; i<res.cols(); i++)
+        {
+            res(i, i) = T(1);
+        }
+        multiplyQ(Transpose::No, res);
+        return res;
+    }
+
+   /**
+    * @brief Returns the n x n upper triangular factor R.
+    */
+    Matrix<T> r() const
+    {
+        size_t n = m_factors.cols();
+        Matrix<T> res(n, n);
+        for (size_t i=0; i<n; i++)
+        {
+            std::copy(m_factors.data() + i * n + i, m_factors.data() + (i + 1) * n, res.data() + i * n + i);
+        }
+        return res;
+    }
+
+   /**
+    * @brief Returns false if a diagonal element of R is negligible compared
+    * to the largest one, that is if A is numerically rank deficient.
+    */
+    bool isFullRank() const
+    {
+        return detail::isFullRank(m_factors.data(), m_factors.cols(), m_factors.cols(), m_factors.rows());
+    }
+
+private:
+    Matrix<T> m_factors;
+    std::vector<T> m_tau;
+};
+
+/**
+ * @brief Returns the X which minimizes the 2-norm of A X - B.
+ *
+ * Tall matrices are split into blocks of at least TSQR_BLOCK_ROWS rows which
+ * are factored in parallel, together with their rows of B, and only their
+ * R factors are stacked and factored again (TSQR). Every block fits in cache
+ * and Q is never formed. The blocks depend only on the size of A, so the
+ * result does not depend on the number of threads.
+ *
+ *
+ * @example
+ *
+ * #include "qr.h"
+ *
+ * linalg::Matrix<double> A{200000, 50};
+ * linalg::Matrix<double> y{200000, 1};
+ * // ... fill A and y
+ * linalg::Matrix<double> coefficients{linalg::leastSquares(A, y)};
+ *
+ *
+ * @param lhs - m x n Matrix object A with m >= n and full column rank.
+ * @param rhs - m x r Matrix object B.
+ * @return n x r Matrix object X.
+ */
+template <typename T>
+Matrix<T> leastSquares(const Matrix<T>& lhs, const Matrix<T>& rhs)
+{
+    static_assert(std::is_floating_point<T>::value, "leastSquares needs a floating point Matrix");
+    detail::checkLeastSquaresInput(lhs, rhs);
+    size_t m = lhs.rows();
+    size_t n = lhs.cols();
+    size_t r = rhs.cols();
+    size_t width = n + r;
+
+    // Copies the rows [begin, end) of [A B] into out.
+    auto augment = [&](size_t begin, size_t end, T* out)
+    {
+        for (size_t i=begin; i<end; i++)
+        {
+            std::copy(lhs.data() + i * n, lhs.data() + (i + 1) * n, out);
+            std::copy(rhs.data() + i * r, rhs.data() + (i + 1) * r, out + n);
+            out += width;
+        }
+    };
+
+    // Only the first n columns are factored. The first n rows of the last r
+    // columns then hold the first n rows of Q^T B.
+    size_t blocks = std::max<size_t>(1, m / std::max(TSQR_BLOCK_ROWS, 2 * width));
+    std::vector<T> tau;
+    Matrix<T> top(blocks * n, width);
+    if (blocks == 1)
+    {
+        Matrix<T> whole(m, width);
+        augment(0, m, whole.data());
+        detail::qrFactor(whole.data(), width, m, width, n, tau);
+        std::copy(whole.data(), whole.data() + n * width, top.data());
+    }
+    else
+    {
+        detail::parallelFor(0, blocks, 1, [&](size_t begin, size_t end)
+        {
+            std::vector<T> local;
+            std::vector<T> localTau;
+            for (size_t block=begin; block<end; block++)
+            {
+                size_t first = block * m / blocks;
+                size_t rows = (block + 1) * m / blocks - first;
+                local.resize(rows * width);
+                augment(first, first + rows, local.data());
+                detail::qrFactor(local.data(), width, rows, width, n, localTau);
+                for (size_t i=0; i<n; i++)
+                {
+                    T* out = top.data() + (block * n + i) * width;
+                    std::fill(out, out + i, T(0));
+                    std::copy(local.data() + i * width + i, local.data() + (i + 1) * width, out + i);
+                }
+            }
+        });
+        detail::qrFactor(top.data(), width, blocks * n, width, n, tau);
+    }
+
+    detail::checkFullRank(top.data(), width, n, m);
+    detail::trsmLeft(Triangle::Upper, Transpose::No, Diagonal::NonUnit, n, r, top.data(), width,
+                     top.data() + n, width);
+    Matrix<T> res(n, r);
+    for (size_t i=0; i<n; i++)
+    {
+        std::copy(top.data() + i * width + n, top.data() + (i + 1) * width, res.data() + i * r);
+    }
+    return res;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_QR_H
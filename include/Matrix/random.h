@@ -0,0 +1,289 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_RANDOM_H
+#define MATRIX_RANDOM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "expression.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+// Counters run through the generator together. The rounds of independent
+// counters are interleaved, which the compiler turns into vector code.
+const size_t RANDOM_LANES = 8;
+
+namespace detail
+{
+const uint32_t PHILOX_M0 = 0xD2511F53;
+const uint32_t PHILOX_M1 = 0xCD9E8D57;
+const uint32_t PHILOX_W0 = 0x9E3779B9;
+const uint32_t PHILOX_W1 = 0xBB67AE85;
+const int PHILOX_ROUNDS = 10;
+
+/*
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+ * 3", 2011) of RANDOM_LANES consecutive counters starting at first. The
+ * counter of block b is (low(b), high(b), 0, 0) and the key is the seed, so
+ * every block is a pure function of its index and the seed. out[w][l] is
+ * word w of block first + l.
+ */
+inline void philoxBatch(uint64_t first, uint64_t seed, uint32_t out[4][RANDOM_LANES])
+{
+    uint32_t c0[RANDOM_LANES];
+    uint32_t c1[RANDOM_LANES];
+    uint32_t c2[RANDOM_LANES];
+    uint32_t c3[RANDOM_LANES];
+    for (size_t l=0; l<RANDOM_LANES; l++)
+    {
+        c0[l] = static_cast<uint32_t>(first + l);
+        c1[l] = static_cast<uint32_t>((first + l) >> 32);
+        c2[l] = 0;
+        c3[l] = 0;
+    }
+    uint32_t k0 = static_cast<uint32_t>(seed);
+    uint32_t k1 = static_cast<uint32_t>(seed >> 32);
+    for (int round=0; round<PHILOX_ROUNDS; round++)
+    {
+        for (size_t l=0; l<RANDOM_LANES; l++)
+        {
+            uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c0[l];
+            uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c2[l];
+            uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1[l] ^ k0;
+            uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3[l] ^ k1;
+            c1[l] = static_cast<uint32_t>(p1);
+            c3[l] = static_cast<uint32_t>(p0);
+            c0[l] = n0;
+            c2[l] = n2;
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    for (size_t l=0; l<RANDOM_LANES; l++)
+    {
+        out[0][l] = c0[l];
+        out[1][l] = c1[l];
+        out[2][l] = c2[l];
+        out[3][l] = c3[l];
+    }
+}
+
+// Uniform values in [0, 1) from the four words of a block. float takes 24
+// bits of one word, double 53 bits of two words.
+template <typename T>
+struct UnitTraits;
+
+template <>
+struct UnitTraits<float>
+{
+    static const size_t PER_BLOCK = 4;
+    static float unit(const uint32_t* words, size_t i)
+    {
+        return static_cast<float>(words[i] >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+template <>
+struct UnitTraits<double>
+{
+    static const size_t PER_BLOCK = 2;
+    static double unit(const uint32_t* words, size_t i)
+    {
+        uint64_t bits = (static_cast<uint64_t>(words[2 * i]) << 32) | words[2 * i + 1];
+        return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+/*
+ * Fills the Matrix object in row-major order, perBlock elements per Philox
+ * block. generate(words, values) turns the four words of a block into
+ * perBlock values. Element e always comes from block e / perBlock, so the
+ * result does not depend on the number of threads.
+ */
+template <typename T, typename Generate>
+void fillRandom(Matrix<T>& mat, uint64_t seed, size_t perBlock, const Generate& generate)
+{
+    size_t count = mat.rows() * mat.cols();
+    size_t batch = RANDOM_LANES * perBlock;
+    size_t batches = (count + batch - 1) / batch;
+    T* out = mat.data();
+    parallelFor(0, batches, std::max<size_t>(1, ELEMENTWISE_GRAIN / batch), [=, &generate](size_t begin, size_t end)
+    {
+        uint32_t words[4][RANDOM_LANES];
+        T values[4];
+        for (size_t b=begin; b<end; b++)
+        {
+            philoxBatch(static_cast<uint64_t>(b) * RANDOM_LANES, seed, words);
+            for (size_t l=0; l<RANDOM_LANES; l++)
+            {
+                size_t first = (b * RANDOM_LANES + l) * perBlock;
+                if (first >= count)
+                {
+                    break;
+                }
+                uint32_t block[4] = {words[0][l], words[1][l], words[2][l], words[3][l]};
+                generate(block, values);
+                std::copy(values, values + std::min(perBlock, count - first), out + first);
+            }
+        }
+    });
+}
+} // namespace detail
+
+/**
+ * @brief Returns a Matrix object of values drawn uniformly from [low, high).
+ *
+ * Values come from the counter-based Philox4x32-10 generator: element e is a
+ * function of e and the seed only, so it is filled in parallel and the
+ * result is the same for any number of threads.
+ *
+ *
+ * @example
+ *
+ * #include "random.h"
+ *
+ * linalg::Matrix<double> A{linalg::randomUniform<double>(4096, 4096, -1.0, 1.0, 42)};
+ *
+ *
+ * @param rows - Number of rows.
+ * @param cols - Number of columns.
+ * @param low - Lower bound, included.
+ * @param high - Upper bound, excluded.
+ * @param seed - Seed of the generator. Different seeds give independent streams.
+ * @return Matrix object of float or double.
+ */
+template <typename T>
+Matrix<T> randomUniform(size_t rows, size_t cols, T low = T(0), T high = T(1), uint64_t seed = 0)
+{
+    static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value,
+                  "randomUniform needs float or double");
+    typedef detail::UnitTraits<T> Traits;
+    Matrix<T> res(rows, cols);
+    T scale = high - low;
+    detail::fillRandom(res, seed, Traits::PER_BLOCK, [low, scale](const uint32_t* words, T* values)
+    {
+        for (size_t i=0; i<Traits::PER_BLOCK; i++)
+        {
+            values[i] = low + scale * Traits::unit(words, i);
+        }
+    });
+    return res;
+}
+
+/**
+ * @brief Returns a Matrix object of normally distributed values.
+ *
+ * Pairs of uniform values are turned into pairs of normal values with the
+ * Box-Muller transform. Like randomUniform(), the result only depends on the
+ * seed.
+ *
+ *
+ * @example
+ *
+ * #include "random.h"
+ *
+ * linalg::Matrix<float> noise{linalg::randomNormal<float>(1024, 1024, 0.0f, 0.1f, 7)};
+ *
+ *
+ * @param rows - Number of rows.
+ * @param cols - Number of columns.
+ * @param mean - Mean of the distribution.
+ * @param stddev - Standard deviation of the distribution.
+ * @param seed - Seed of the generator.
+ * @return Matrix object of float or double.
+ */
+template <typename T>
+Matrix<T> randomNormal(size_t rows, size_t cols, T mean = T(0), T stddev = T(1), uint64_t seed = 0)
+{
+    static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value,
+                  "randomNormal needs float or double");
+    typedef detail::UnitTraits<T> Traits;
+    Matrix<T> res(rows, cols);
+    const T TWO_PI = T(6.283185307179586);
+    detail::fillRandom(res, seed, Traits::PER_BLOCK, [mean, stddev, TWO_PI](const uint32_t* words, T* values)
+    {
+        for (size_t i=0; i<Traits::PER_BLOCK; i+=2)
+        {
+            // 1 - u is in (0, 1], so the logarithm is finite.
+            T radius = stddev * std::sqrt(T(-2) * std::log(T(1) - Traits::unit(words, i)));
+            T angle = TWO_PI * Traits::unit(words, i + 1);
+            values[i] = mean + radius * std::cos(angle);
+            values[i + 1] = mean + radius * std::sin(angle);
+        }
+    });
+    return res;
+}
+
+/**
+ * @brief Returns a Matrix object of integers drawn uniformly from
+ * [low, high], both included.
+ *
+ * Every element takes 64 random bits reduced modulo the size of the range,
+ * so the bias is below range / 2^64.
+ *
+ *
+ * @example
+ *
+ * #include "random.h"
+ *
+ * linalg::Matrix<int> dice{linalg::randomIntegers<int>(100, 100, 1, 6, 3)};
+ *
+ *
+ * @param rows - Number of rows.
+ * @param cols - Number of columns.
+ * @param low - Smallest value.
+ * @param high - Largest value.
+ * @param seed - Seed of the generator.
+ * @return Matrix object of an integer type.
+ */
+template <typename T>
+Matrix<T> randomIntegers(size_t rows, size_t cols, T low, T high, uint64_t seed = 0)
+{
+    static_assert(std::is_integral<T>::value, "randomIntegers needs an integer type");
+    if (high < low)
+    {
+        std::cerr << "Random integers - Upper bound is smaller than the lower bound" << std::endl;
+        std::abort();
+    }
+    Matrix<T> res(rows, cols);
+    // A range of 0 stands for the full 64 bit range.
+    uint64_t range = static_cast<uint64_t>(high) - static_cast<uint64_t>(low) + 1;
+    detail::fillRandom(res, seed, 2, [low, range](const uint32_t* words, T* values)
+    {
+        for (size_t i=0; i<2; i++)
+        {
+            uint64_t bits = (static_cast<uint64_t>(words[2 * i]) << 32) | words[2 * i + 1];
+            values[i] = static_cast<T>(static_cast<uint64_t>(low) + (range == 0 ? bits : bits % range));
+        }
+    });
+    return res;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_RANDOM_H
@@ -0,0 +1,549 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATRIX_REDUCTION_H
+#define MATRIX_REDUCTION_H
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+// Whole-matrix reductions work on blocks of this many elements. The blocks
+// do not depend on the number of threads, so results are reproducible.
+const size_t REDUCTION_BLOCK = 16384;
+
+// Number of independent accumulators. They map onto SIMD lanes.
+const size_t REDUCTION_LANES = 8;
+
+/**
+ * @brief Summation algorithm used by sum().
+ *
+ * Naive     - Plain accumulation in REDUCTION_LANES independent lanes.
+ * Kahan     - Compensated summation. The error does not grow with the number
+ *             of elements.
+ * Pairwise  - Recursive halving. The error grows with the logarithm of the
+ *             number of elements at almost the cost of Naive.
+ *
+ * Integer Matrix objects are always summed exactly, so the algorithm only
+ * matters for floating point.
+ */
+enum class Summation
+{
+    Naive,
+    Kahan,
+    Pairwise
+};
+
+/**
+ * @brief Value and position of the smallest or largest element.
+ */
+template <typename T>
+struct Extremum
+{
+    T value;
+    size_t row;
+    size_t col;
+};
+
+namespace detail
+{
+template <typename T>
+T absolute(const T& value)
+{
+    return (value < T(0)) ? T(0) - value : value;
+}
+
+struct Identity
+{
+    template <typename T>
+    T operator() (const T& value) const
+    {
+        return value;
+    }
+};
+
+struct Absolute
+{
+    template <typename T>
+    T operator() (const T& value) const
+    {
+        return absolute(value);
+    }
+};
+
+struct Square
+{
+    template <typename T>
+    T operator() (const T& value) const
+    {
+        return value * value;
+    }
+};
+
+// Adds the lanes together as a balanced tree.
+template <typename T>
+T combineLanes(T* lanes, size_t count)
+{
+    for (size_t width=count/2; width>0; width/=2)
+    {
+        for (size_t k=0; k<width; k++)
+        {
+            lanes[k] += lanes[k + width];
+        }
+    }
+    return lanes[0];
+}
+
+// Sums map(data[i]) with independent accumulators, so the loop is not bound
+// by the latency of a single addition chain and vectorizes.
+template <typename T, typename Map>
+T laneSum(const T* data, size_t count, const Map& map)
+{
+    T lanes[REDUCTION_LANES] = {};
+    size_t i = 0;
+    for (; i+REDUCTION_LANES<=count; i+=REDUCTION_LANES)
+    {
+        for (size_t k=0; k<REDUCTION_LANES; k++)
+        {
+            lanes[k] += map(data[i + k]);
+        }
+    }
+    for (size_t k=0; i<count; i++, k++)
+    {
+        lanes[k] += map(data[i]);
+    }
+    return combineLanes(lanes, REDUCTION_LANES);
+}
+
+// Kahan summation carried out independently in every lane.
+template <typename T, typename Map>
+T kahanSum(const T* data, size_t count, const Map& map)
+{
+    T lanes[REDUCTION_LANES] = {};
+    T errors[REDUCTION_LANES] = {};
+    size_t i = 0;
+    for (; i+REDUCTION_LANES<=count; i+=REDUCTION_LANES)
+    {
+        for (size_t k=0; k<REDUCTION_LANES; k++)
+        {
+            T y = map(data[i + k]) - errors[k];
+            T t = lanes[k] + y;
+            errors[k] = (t - lanes[k]) - y;
+            lanes[k] = t;
+        }
+    }
+    for (size_t k=0; i<count; i++, k++)
+    {
+        T y = map(data[i]) - errors[k];
+        T t = lanes[k] + y;
+        errors[k] = (t - lanes[k]) - y;
+        lanes[k] = t;
+    }
+
+    T total = 0;
+    T error = 0;
+    for (size_t k=0; k<REDUCTION_LANES; k++)
+    {
+        T y = (lanes[k] - errors[k]) - error;
+        T t = total + y;
+        error = (t - total) - y;
+        total = t;
+    }
+    return total;
+}
+
+template <typename T, typename Map>
+T pairwiseSum(const T* data, size_t count, const Map& map)
+{
+    if (count <= 32 * REDUCTION_LANES)
+    {
+        return laneSum(data, count, map);
+    }
+    size_t half = count / 2;
+    return pairwiseSum(data, half, map) + pairwiseSum(data + half, count - half, map);
+}
+
+template <typename T, typename Map>
+T blockSum(const T* data, size_t count, Summation method, const Map& map)
+{
+    if (!std::is_floating_point<T>::value || method == Summation::Naive)
+    {
+        return laneSum(data, count, map);
+    }
+    if (method == Summation::Kahan)
+    {
+        return kahanSum(data, count, map);
+    }
+    return pairwiseSum(data, count, map);
+}
+
+/*
+ * Sums map(x) over all elements. Blocks are summed in parallel, then the
+ * partial sums are combined with the same algorithm, which is a tree
+ * reduction for Naive and Pairwise.
+ */
+template <typename T, typename Map>
+T reduceSum(const Matrix<T>& mat, Summation method, const Map& map)
+{
+    size_t count = mat.rows() * mat.cols();
+    size_t blocks = (count + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    if (blocks <= 1)
+    {
+        return blockSum(mat.data(), count, method, map);
+    }
+
+    std::vector<T> partial(blocks);
+    const T* data = mat.data();
+    parallelFor(0, blocks, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t b=begin; b<end; b++)
+        {
+            size_t first = b * REDUCTION_BLOCK;
+            partial[b] = blockSum(data + first, std::min(REDUCTION_BLOCK, count - first), method, map);
+        }
+    });
+
+    if (method == Summation::Kahan)
+    {
+        return blockSum(partial.data(), blocks, method, Identity());
+    }
+    return pairwiseSum(partial.data(), blocks, Identity());
+}
+
+// Returns the first extremum according to better(candidate, current).
+template <typename T, typename Better>
+Extremum<T> reduceExtremum(const Matrix<T>& mat, const Better& better)
+{
+    size_t count = mat.rows() * mat.cols();
+    if (count == 0)
+    {
+        std::cerr << "Reduction - Matrix is empty" << std::endl;
+        std::abort();
+    }
+
+    size_t blocks = (count + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    std::vector<size_t> partial(blocks);
+    const T* data = mat.data();
+    parallelFor(0, blocks, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t b=begin; b<end; b++)
+        {
+            size_t first = b * REDUCTION_BLOCK;
+            size_t last = std::min(count, first + REDUCTION_BLOCK);
+            size_t best = first;
+            for (size_t i=first+1; i<last; i++)
+            {
+                if (better(data[i], data[best]))
+                {
+                    best = i;
+                }
+            }
+            partial[b] = best;
+        }
+    });
+
+    size_t best = partial[0];
+    for (size_t b=1; b<blocks; b++)
+    {
+        if (better(data[partial[b]], data[best]))
+        {
+            best = partial[b];
+        }
+    }
+    return Extremum<T>{data[best], best / mat.cols(), best % mat.cols()};
+}
+
+// Reduces every row to one value with combine(accumulator, element).
+template <typename T, typename Combine>
+Matrix<T> reduceRows(const Matrix<T>& mat, const Combine& combine)
+{
+    Matrix<T> res(mat.rows(), 1);
+    size_t cols = mat.cols();
+    parallelFor(0, mat.rows(), std::max<size_t>(1, REDUCTION_BLOCK / std::max<size_t>(cols, 1)), [&](size_t begin, size_t end)
+    {
+        for (size_t i=begin; i<end; i++)
+        {
+            const T* row = mat.data() + i * cols;
+            T acc = row[0];
+            for (size_t j=1; j<cols; j++)
+            {
+                acc = combine(acc, row[j]);
+            }
+            res(i, 0) = acc;
+        }
+    });
+    return res;
+}
+
+// Reduces every column to one value with combine(accumulator, map(element)).
+// Threads own ranges of columns and sweep the rows, so the inner loop runs
+// along contiguous memory.
+template <typename T, typename Map, typename Combine>
+Matrix<T> reduceCols(const Matrix<T>& mat, const Map& map, const Combine& combine)
+{
+    Matrix<T> res(1, mat.cols());
+    size_t cols = mat.cols();
+    parallelFor(0, cols, std::max<size_t>(1, REDUCTION_BLOCK / std::max<size_t>(mat.rows(), 1)), [&](size_t begin, size_t end)
+    {
+        T* acc = res.data();
+        for (size_t j=begin; j<end; j++)
+        {
+            acc[j] = map(mat.data()[j]);
+        }
+        for (size_t i=1; i<mat.rows(); i++)
+        {
+            const T* row = mat.data() + i * cols;
+            for (size_t j=begin; j<end; j++)
+            {
+                acc[j] = combine(acc[j], map(row[j]));
+            }
+        }
+    });
+    return res;
+}
+
+template <typename T>
+void checkNotEmpty(const Matrix<T>& mat)
+{
+    if (mat.rows() == 0 || mat.cols() == 0)
+    {
+        std::cerr << "Reduction - Matrix is empty" << std::endl;
+        std::abort();
+    }
+}
+} // namespace detail
+
+/**
+ * @brief Returns the sum of all the elements.
+ *
+ *
+ * @example
+ *
+ * #include "reduction.h"
+ *
+ * linalg::Matrix<double> A{1000, 1000, 0.1};
+ * double total = linalg::sum(A, linalg::Summation::Kahan);
+ *
+ *
+ * @param mat - The Matrix object.
+ * @param method - Summation algorithm for floating point. Defaults to Naive.
+ * @return Sum of the elements.
+ */
+template <typename T>
+T sum(const Matrix<T>& mat, Summation method=Summation::Naive)
+{
+    return detail::reduceSum(mat, method, detail::Identity());
+}
+
+/**
+ * @brief Returns the smallest element and its position.
+ *
+ * When the smallest value appears several times, the first one in row-major
+ * order is returned. The Matrix object should not be empty.
+ *
+ *
+ * @example
+ *
+ * #include "reduction.h"
+ *
+ * linalg::Matrix<int> A{{{4, 1}, {0, 3}}};
+ * linalg::Extremum<int> low = linalg::minElement(A);
+ * // low.value == 0, low.row == 1, low.col == 0
+ *
+ *
+ * @param mat - The Matrix object.
+ * @return The value, row and column of the smallest element.
+ */
+template <typename T>
+Extremum<T> minElement(const Matrix<T>& mat)
+{
+    return detail::reduceExtremum(mat, [](const T& lhs, const T& rhs) { return lhs < rhs; });
+}
+
+/**
+ * @brief Returns the largest element and its position.
+ *
+ * When the largest value appears several times, the first one in row-major
+ * order is returned. The Matrix object should not be empty.
+ *
+ *
+ * @param mat - The Matrix object.
+ * @return The value, row and column of the largest element.
+ */
+template <typename T>
+Extremum<T> maxElement(const Matrix<T>& mat)
+{
+    return detail::reduceExtremum(mat, [](const T& lhs, const T& rhs) { return rhs < lhs; });
+}
+
+/**
+ * @brief Returns the Frobenius norm, the square root of the sum of the
+ * squares of all the elements.
+ *
+ *
+ * @param mat - Matrix object of floating point type.
+ * @param method - Summation algorithm. Defaults to Naive.
+ * @return The Frobenius norm.
+ */
+template <typename T>
+T norm(const Matrix<T>& mat, Summation method=Summation::Naive)
+{
+    static_assert(std::is_floating_point<T>::value, "norm() needs a floating point Matrix");
+    return std::sqrt(detail::reduceSum(mat, method, detail::Square()));
+}
+
+/**
+ * @brief Returns the 1-norm, the largest sum of absolute values of a column.
+ *
+ *
+ * @param mat - The Matrix object.
+ * @return The 1-norm.
+ */
+template <typename T>
+T norm1(const Matrix<T>& mat)
+{
+    detail::checkNotEmpty(mat);
+    Matrix<T> sums = detail::reduceCols(mat, detail::Absolute(), [](const T& acc, const T& value) { return acc + value; });
+    return maxElement(sums).value;
+}
+
+/**
+ * @brief Returns the infinity norm, the largest sum of absolute values of a
+ * row.
+ *
+ *
+ * @param mat - The Matrix object.
+ * @return The infinity norm.
+ */
+template <typename T>
+T normInf(const Matrix<T>& mat)
+{
+    detail::checkNotEmpty(mat);
+    Matrix<T> sums(mat.rows(), 1);
+    detail::parallelFor(0, mat.rows(), std::max<size_t>(1, REDUCTION_BLOCK / mat.cols()), [&](size_t begin, size_t end)
+    {
+        for (size_t i=begin; i<end; i++)
+        {
+            sums(i, 0) = detail::laneSum(mat.data() + i * mat.cols(), mat.cols(), detail::Absolute());
+        }
+    });
+    return maxElement(sums).value;
+}
+
+/**
+ * @brief Returns the sum of every row as an M-by-1 Matrix object.
+ *
+ *
+ * @example
+ *
+ * #include "reduction.h"
+ *
+ * linalg::Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};
+ * std::cout << linalg::rowSums(A); // [[6] [15]]
+ *
+ *
+ * @param mat - The Matrix object.
+ * @return Column of row sums.
+ */
+template <typename T>
+Matrix<T> rowSums(const Matrix<T>& mat)
+{
+    Matrix<T> res(mat.rows(), 1);
+    detail::parallelFor(0, mat.rows(), std::max<size_t>(1, REDUCTION_BLOCK / std::max<size_t>(mat.cols(), 1)), [&](size_t begin, size_t end)
+    {
+        for (size_t i=begin; i<end; i++)
+        {
+            res(i, 0) = detail::laneSum(mat.data() + i * mat.cols(), mat.cols(), detail::Identity());
+        }
+    });
+    return res;
+}
+
+/**
+ * @brief Returns the sum of every column as a 1-by-N Matrix object.
+ *
+ *
+ * @example
+ *
+ * #include "reduction.h"
+ *
+ * linalg::Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};
+ * std::cout << linalg::colSums(A); // [[5 7 9]]
+ *
+ *
+ * @param mat - The Matrix object.
+ * @return Row of column sums.
+ */
+template <typename T>
+Matrix<T> colSums(const Matrix<T>& mat)
+{
+    detail::checkNotEmpty(mat);
+    return detail::reduceCols(mat, detail::Identity(), [](const T& acc, const T& value) { return acc + value; });
+}
+
+/**
+ * @brief Returns the smallest element of every row as an M-by-1 Matrix object.
+ */
+template <typename T>
+Matrix<T> rowMin(const Matrix<T>& mat)
+{
+    detail::checkNotEmpty(mat);
+    return detail::reduceRows(mat, [](const T& acc, const T& value) { return (value < acc) ? value : acc; });
+}
+
+/**
+ * @brief Returns the largest element of every row as an M-by-1 Matrix object.
+ */
+template <typename T>
+Matrix<T> rowMax(const Matrix<T>& mat)
+{
+    detail::checkNotEmpty(mat);
+    return detail::reduceRows(mat, [](const T& acc, const T& value) { return (acc < value) ? value : acc; });
+}
+
+/**
+ * @brief Returns the smallest element of every column as a 1-by-N Matrix object.
+ */
+template <typename T>
+Matrix<T> colMin(const Matrix<T>& mat)
+{
+    detail::checkNotEmpty(mat);
+    return detail::reduceCols(mat, detail::Identity(), [](const T& acc, const T& value) { return (value < acc) ? value : acc; });
+}
+
+/**
+ * @brief Returns the largest element of every column as a 1-by-N Matrix object.
+ */
+template <typename T>
+Matrix<T> colMax(const Matrix<T>& mat)
+{
+    detail::checkNotEmpty(mat);
+    return detail::reduceCols(mat, detail::Identity(), [](const T& acc, const T& value) { return (acc < value) ? value : acc; });
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_REDUCTION_H
@@ -0,0 +1,240 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_SHAPE_H
+#define MATRIX_SHAPE_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "expression.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+/**
+ * @brief Direction in which Matrix objects are joined by concat().
+ *
+ * Rows - The parts are put on top of each other, like vstack().
+ * Cols - The parts are put side by side, like hstack().
+ */
+enum class Axis
+{
+    Rows,
+    Cols
+};
+
+namespace detail
+{
+/*
+ * Copies the parts into one preallocated Matrix object. Threads take ranges
+ * of output rows: along the rows every output row is a row of one part,
+ * along the columns it is made of one row of every part.
+ */
+template <typename T>
+Matrix<T> concatenate(const std::vector<const Matrix<T>*>& parts, Axis axis)
+{
+    if (parts.empty())
+    {
+        return Matrix<T>(0, 0);
+    }
+
+    // offsets[p] is the first output row (or column) of part p.
+    std::vector<size_t> offsets(parts.size() + 1, 0);
+    for (size_t p=0; p<parts.size(); p++)
+    {
+        size_t along = (axis == Axis::Rows) ? parts[p]->rows() : parts[p]->cols();
+        size_t across = (axis == Axis::Rows) ? parts[p]->cols() : parts[p]->rows();
+        size_t expected = (axis == Axis::Rows) ? parts[0]->cols() : parts[0]->rows();
+        if (across != expected)
+        {
+            std::cerr << "Concatenation - Matrix dimension do not match" << std::endl;
+            std::abort();
+        }
+        offsets[p + 1] = offsets[p] + along;
+    }
+
+    size_t rows = (axis == Axis::Rows) ? offsets.back() : parts[0]->rows();
+    size_t cols = (axis == Axis::Rows) ? parts[0]->cols() : offsets.back();
+    Matrix<T> res(rows, cols);
+    T* out = res.data();
+    parallelFor(0, rows, std::max<size_t>(1, ELEMENTWISE_GRAIN / std::max<size_t>(cols, 1)),
+                [&parts, &offsets, axis, out, cols](size_t begin, size_t end)
+    {
+        if (axis == Axis::Cols)
+        {
+            for (size_t i=begin; i<end; i++)
+            {
+                for (size_t p=0; p<parts.size(); p++)
+                {
+                    const T* row = parts[p]->data() + i * parts[p]->cols();
+                    std::copy(row, row + parts[p]->cols(), out + i * cols + offsets[p]);
+                }
+            }
+            return;
+        }
+        // Parts are contiguous, so the range is a few block copies.
+        size_t p = std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+        for (size_t i=begin; i<end; p++)
+        {
+            size_t last = std::min(end, offsets[p + 1]);
+            const T* src = parts[p]->data() + (i - offsets[p]) * cols;
+            std::copy(src, src + (last - i) * cols, out + i * cols);
+            i = last;
+        }
+    });
+    return res;
+}
+
+template <typename T>
+void collect(std::vector<const Matrix<T>*>&)
+{
+}
+
+template <typename T, typename... Rest>
+void collect(std::vector<const Matrix<T>*>& parts, const Matrix<T>& first, const Rest&... rest)
+{
+    parts.push_back(&first);
+    collect(parts, rest...);
+}
+} // namespace detail
+
+/**
+ * @brief Joins Matrix objects along the given axis into one new Matrix
+ * object.
+ *
+ * The result is allocated once and every part is copied straight into its
+ * place, in parallel. Along the rows the parts should have the same number
+ * of columns, along the columns the same number of rows.
+ *
+ *
+ * @example
+ *
+ * #include "shape.h"
+ *
+ * std::vector<linalg::Matrix<double>> batches;
+ * for (size_t b=0; b<16; b++)
+ * {
+ *     batches.emplace_back(256, 64, static_cast<double>(b));
+ * }
+ * linalg::Matrix<double> all{linalg::concat(batches, linalg::Axis::Rows)}; // 4096 x 64
+ *
+ *
+ * @param parts - The Matrix objects, in order.
+ * @param axis - Axis::Rows to put them on top of each other, Axis::Cols to put them side by side.
+ * @return The joined Matrix object.
+ */
+template <typename T>
+Matrix<T> concat(const std::vector<Matrix<T>>& parts, Axis axis)
+{
+    std::vector<const Matrix<T>*> pointers;
+    pointers.reserve(parts.size());
+    for (const Matrix<T>& part : parts)
+    {
+        pointers.push_back(&part);
+    }
+    return detail::concatenate(pointers, axis);
+}
+
+/**
+ * @brief Puts Matrix objects side by side.
+ *
+ *
+ * @example
+ *
+ * #include "shape.h"
+ *
+ * linalg::Matrix<int> A{{{1, 2}, {3, 4}}};
+ * linalg::Matrix<int> B{linalg::Matrix<int>{{5, 6}}.transpose()};
+ * std::cout << linalg::hstack(A, B); // [[1 2 5] [3 4 6]]
+ *
+ *
+ * @param first - The left-most Matrix object.
+ * @param rest - The other Matrix objects, with as many rows as the first.
+ * @return The joined Matrix object.
+ */
+template <typename T, typename... Rest>
+Matrix<T> hstack(const Matrix<T>& first, const Rest&... rest)
+{
+    std::vector<const Matrix<T>*> parts;
+    detail::collect(parts, first, rest...);
+    return detail::concatenate(parts, Axis::Cols);
+}
+
+/**
+ * @brief Puts Matrix objects on top of each other.
+ *
+ *
+ * @example
+ *
+ * #include "shape.h"
+ *
+ * linalg::Matrix<int> A{{{1, 2}, {3, 4}}};
+ * linalg::Matrix<int> B{{5, 6}};
+ * std::cout << linalg::vstack(A, B); // [[1 2] [3 4] [5 6]]
+ *
+ *
+ * @param first - The top Matrix object.
+ * @param rest - The other Matrix objects, with as many columns as the first.
+ * @return The joined Matrix object.
+ */
+template <typename T, typename... Rest>
+Matrix<T> vstack(const Matrix<T>& first, const Rest&... rest)
+{
+    std::vector<const Matrix<T>*> parts;
+    detail::collect(parts, first, rest...);
+    return detail::concatenate(parts, Axis::Rows);
+}
+
+/**
+ * @brief Returns the Matrix object with new dimensions and the same
+ * row-major elements.
+ *
+ * The Matrix object is taken by value, so passing a temporary or a
+ * std::move()d Matrix object moves its storage into the result and nothing
+ * is copied. See Matrix::reshape() to reshape in place.
+ *
+ *
+ * @example
+ *
+ * #include "shape.h"
+ *
+ * linalg::Matrix<double> flat{linalg::reshape(std::move(images), 1, 28 * 28 * batch)};
+ *
+ *
+ * @param mat - The Matrix object.
+ * @param rows - The new number of rows.
+ * @param cols - The new number of columns.
+ * @return The reshaped Matrix object.
+ */
+template <typename T>
+Matrix<T> reshape(Matrix<T> mat, size_t rows, size_t cols)
+{
+    mat.reshape(rows, cols);
+    return mat;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_SHAPE_H
@@ -0,0 +1,348 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_SHARED_MATRIX_H
+#define MATRIX_SHARED_MATRIX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gemm.h"
+#include "matrix.h"
+
+
+namespace linalg
+{
+namespace detail
+{
+// Header at the start of a shared memory segment. The elements follow at
+// SHARED_DATA_OFFSET in row-major order.
+struct SharedHeader
+{
+    char magic[4];
+    uint32_t elementSize;
+    uint64_t rows;
+    uint64_t cols;
+};
+
+const char SHARED_MAGIC[4] = {'L', 'S', 'H', 'M'};
+
+// The elements start one cache line into the segment, so they are as
+// aligned as the mapping itself.
+const size_t SHARED_DATA_OFFSET = 64;
+} // namespace detail
+
+/**
+ * @brief A matrix stored in named POSIX shared memory, which other processes
+ * of the machine can map without copying it.
+ *
+ * One process creates the segment and fills it. The other processes attach
+ * to it by name and get a read-only mapping of the same physical pages, so a
+ * matrix shared by any number of workers takes the memory of one copy. The
+ * object can be multiplied on either side of a Matrix object, and the
+ * multiplication kernel reads straight from the mapping.
+ *
+ * The name is removed when the object of the creator is destroyed or
+ * detached. Processes which attached before that keep their mapping until
+ * they detach. Attaching should wait until the creator has filled the
+ * matrix, for example behind a barrier().
+ *
+ *
+ * @example
+ *
+ * #include "shared_matrix.h"
+ *
+ * // In the loading process.
+ * linalg::SharedMatrix<float> weights;
+ * weights.create("/weights", loaded);
+ *
+ * // In every worker, once the loader is done.
+ * linalg::SharedMatrix<float> shared;
+ * if (shared.attach("/weights"))
+ * {
+ *     linalg::Matrix<float> out{batch * shared};
+ * }
+ */
+template <typename T>
+class SharedMatrix
+{
+public:
+    SharedMatrix()
+        : m_base{nullptr}, m_bytes{0}, m_rows{0}, m_cols{0}, m_writable{false}
+    {
+    }
+
+    SharedMatrix(const SharedMatrix&) = delete;
+    SharedMatrix& operator= (const SharedMatrix&) = delete;
+
+    SharedMatrix(SharedMatrix&& other)
+        : SharedMatrix()
+    {
+        swap(other);
+    }
+
+    SharedMatrix& operator= (SharedMatrix&& other)
+    {
+        if (this != &other)
+        {
+            detach();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~SharedMatrix()
+    {
+        detach();
+    }
+
+   /**
+    * @brief Creates a segment for a rows x cols matrix of zeros, mapped for
+    * reading and writing.
+    *
+    * @param name - Name of the segment, such as "/weights".
+    * @param rows - Number of rows.
+    * @param cols - Number of columns.
+    * @return Whether the segment was created. Fails if the name is taken or
+    *         the size does not fit in memory.
+    */
+    bool create(const std::string& name, size_t rows, size_t cols)
+    {
+        detach();
+        if (rows != 0 && cols > (std::numeric_limits<size_t>::max() - detail::SHARED_DATA_OFFSET) / sizeof(T) / rows)
+        {
+            return false;
+        }
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+        {
+            return false;
+        }
+        size_t bytes = detail::SHARED_DATA_OFFSET + rows * cols * sizeof(T);
+        void* base = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+        {
+            base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        detail::SharedHeader header;
+        std::memcpy(header.magic, detail::SHARED_MAGIC, sizeof(header.magic));
+        header.elementSize = sizeof(T);
+        header.rows = rows;
+        header.cols = cols;
+        std::memcpy(base, &header, sizeof(header));
+        m_base = static_cast<char*>(base);
+        m_bytes = bytes;
+        m_rows = rows;
+        m_cols = cols;
+        m_writable = true;
+        m_name = name;
+        return true;
+    }
+
+   /**
+    * @brief Creates a segment holding a copy of a Matrix object.
+    */
+    bool create(const std::string& name, const Matrix<T>& mat)
+    {
+        if (!create(name, mat.rows(), mat.cols()))
+        {
+            return false;
+        }
+        std::copy(mat.data(), mat.data() + mat.rows() * mat.cols(), data());
+        return true;
+    }
+
+   /**
+    * @brief Maps an existing segment read-only.
+    *
+    * @param name - Name given to create().
+    * @return Whether the segment exists and holds a matrix of T.
+    */
+    bool attach(const std::string& name)
+    {
+        detach();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat info;
+        void* base = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= detail::SHARED_DATA_OFFSET)
+        {
+            base = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            return false;
+        }
+
+        size_t bytes = static_cast<size_t>(info.st_size);
+        detail::SharedHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        // Checked by division, so dimensions whose product overflows cannot
+        // pass for a small segment.
+        uint64_t available = (bytes - detail::SHARED_DATA_OFFSET) / sizeof(T);
+        if (std::memcmp(header.magic, detail::SHARED_MAGIC, sizeof(header.magic)) != 0
+            || header.elementSize != sizeof(T)
+            || (header.rows != 0 && header.cols > available / header.rows))
+        {
+            munmap(base, bytes);
+            return false;
+        }
+        m_base = static_cast<char*>(base);
+        m_bytes = bytes;
+        m_rows = header.rows;
+        m_cols = header.cols;
+        m_writable = false;
+        return true;
+    }
+
+   /**
+    * @brief Unmaps the segment. For the creator, it also removes the name.
+    */
+    void detach()
+    {
+        if (m_base != nullptr)
+        {
+            munmap(m_base, m_bytes);
+        }
+        if (m_writable)
+        {
+            shm_unlink(m_name.c_str());
+        }
+        m_base = nullptr;
+        m_bytes = 0;
+        m_rows = 0;
+        m_cols = 0;
+        m_writable = false;
+        m_name.clear();
+    }
+
+    bool isAttached() const
+    {
+        return m_base != nullptr;
+    }
+
+   /**
+    * @brief Returns whether this process created the segment and can write it.
+    */
+    bool isWritable() const
+    {
+        return m_writable;
+    }
+
+    size_t rows() const
+    {
+        return m_rows;
+    }
+
+    size_t cols() const
+    {
+        return m_cols;
+    }
+
+    const T* data() const
+    {
+        return reinterpret_cast<const T*>(m_base + detail::SHARED_DATA_OFFSET);
+    }
+
+   /**
+    * @brief Returns the elements for writing. The mapping of a process which
+    * attached is read-only, so writing through it there faults.
+    */
+    T* data()
+    {
+        return reinterpret_cast<T*>(m_base + detail::SHARED_DATA_OFFSET);
+    }
+
+    T operator() (size_t row, size_t col) const
+    {
+        return data()[row * m_cols + col];
+    }
+
+   /**
+    * @brief Returns a private copy as a Matrix object.
+    */
+    Matrix<T> toMatrix() const
+    {
+        Matrix<T> res(m_rows, m_cols);
+        std::copy(data(), data() + m_rows * m_cols, res.data());
+        return res;
+    }
+
+    friend Matrix<T> operator* (const SharedMatrix<T>& lhs, const Matrix<T>& rhs)
+    {
+        detail::checkProductSize(lhs.cols(), rhs.rows());
+        Matrix<T> res(lhs.rows(), rhs.cols());
+        detail::gemm(Transpose::No, Transpose::No, lhs.rows(), rhs.cols(), lhs.cols(), T(1), lhs.data(),
+                     lhs.cols(), rhs.data(), rhs.cols(), T(0), res.data(), rhs.cols());
+        return res;
+    }
+
+    friend Matrix<T> operator* (const Matrix<T>& lhs, const SharedMatrix<T>& rhs)
+    {
+        detail::checkProductSize(lhs.cols(), rhs.rows());
+        Matrix<T> res(lhs.rows(), rhs.cols());
+        detail::gemm(Transpose::No, Transpose::No, lhs.rows(), rhs.cols(), lhs.cols(), T(1), lhs.data(),
+                     lhs.cols(), rhs.data(), rhs.cols(), T(0), res.data(), rhs.cols());
+        return res;
+    }
+
+private:
+    void swap(SharedMatrix& other)
+    {
+        std::swap(m_base, other.m_base);
+        std::swap(m_bytes, other.m_bytes);
+        std::swap(m_rows, other.m_rows);
+        std::swap(m_cols, other.m_cols);
+        std::swap(m_writable, other.m_writable);
+        std::swap(m_name, other.m_name);
+    }
+
+    char* m_base;
+    size_t m_bytes;
+    size_t m_rows;
+    size_t m_cols;
+    bool m_writable;
+    std::string m_name;
+};
+
+}; // namespace linalg
+
+#endif // MATRIX_SHARED_MATRIX_H
@@ -0,0 +1,317 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATRIX_SOFTMAX_H
+#define MATRIX_SOFTMAX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "reduction.h"
+
+
+namespace linalg
+{
+namespace detail
+{
+// Constants of the exponential approximation for each floating point type.
+template <typename T>
+struct ExpTraits;
+
+template <>
+struct ExpTraits<float>
+{
+    typedef int32_t Bits;
+    static const int MANTISSA = 23;
+    static const int BIAS = 127;
+    static const int DEGREE = 6;
+    static float lowest() { return -87.0f; }
+    static float highest() { return 88.0f; }
+};
+
+template <>
+struct ExpTraits<double>
+{
+    typedef int64_t Bits;
+    static const int MANTISSA = 52;
+    static const int BIAS = 1023;
+    static const int DEGREE = 12;
+    static double lowest() { return -708.0; }
+    static double highest() { return 709.0; }
+};
+
+// Returns condition ? lhs : rhs through the bit patterns. A plain ternary on
+// floating point values is not if-converted under the default trapping math
+// rules, which stops the surrounding loop from being vectorized.
+template <typename T>
+T blend(bool condition, T lhs, T rhs)
+{
+    typedef typename ExpTraits<T>::Bits Bits;
+    Bits mask = -static_cast<Bits>(condition);
+    Bits lhsBits;
+    Bits rhsBits;
+    std::memcpy(&lhsBits, &lhs, sizeof(T));
+    std::memcpy(&rhsBits, &rhs, sizeof(T));
+    Bits bits = (lhsBits & mask) | (rhsBits & ~mask);
+    T res;
+    std::memcpy(&res, &bits, sizeof(T));
+    return res;
+}
+
+/*
+ * Branch-free exponential which the compiler vectorizes inside loops.
+ *
+ * x is split into n * ln(2) + r with |r| <= ln(2) / 2. e^r is the Taylor
+ * polynomial of degree ExpTraits<T>::DEGREE, and 2^n is written straight
+ * into the exponent bits. The truncation error of the polynomial is below
+ * 1.2e-7 for float and 1.7e-16 for double, so the relative error is within
+ * a few units in the last place. Inputs below lowest() return 0 and inputs
+ * are clamped to highest().
+ */
+template <typename T>
+T fastExp(T x)
+{
+    typedef ExpTraits<T> Traits;
+    typedef typename Traits::Bits Bits;
+
+    const T LOG2E = T(1.4426950408889634);
+    const T LN2_HI = T(0.693145751953125);
+    const T LN2_LO = T(1.4286068203094172e-06);
+    // Adding 1.5 * 2^MANTISSA rounds to the nearest integer n and leaves n 
+    // in the low bits, so no float to integer conversion is needed.
+    const T ROUND = T(1.5) * T(Bits(1) << Traits::MANTISSA);
+
+    T clamped = blend(x < Traits::lowest(), Traits::lowest(), x);
+    clamped = blend(clamped > Traits::highest(), Traits::highest(), clamped);
+    T shifted = clamped * LOG2E + ROUND;
+    T rounded = shifted - ROUND;
+    Bits shiftedBits;
+    Bits roundBits;
+    std::memcpy(&shiftedBits, &shifted, sizeof(T));
+    std::memcpy(&roundBits, &ROUND, sizeof(T));
+    Bits n = shiftedBits - roundBits;
+    T r = (clamped - rounded * LN2_HI) - rounded * LN2_LO;
+
+    // Horner evaluation of sum(r^k / k!).
+    T p = T(1);
+    for (int k=Traits::DEGREE; k>0; k--)
+    {
+        p = T(1) + p * r * (T(1) / T(k));
+    }
+
+    Bits bits = (n + Traits::BIAS) << Traits::MANTISSA;
+    T scale;
+    std::memcpy(&scale, &bits, sizeof(T));
+    return blend(x < Traits::lowest(), T(0), p * scale);
+}
+
+// Largest element of a row, kept in REDUCTION_LANES independent lanes.
+template <typename T>
+T rowMaximum(const T* row, size_t cols)
+{
+    T lanes[REDUCTION_LANES];
+    std::fill(lanes, lanes + REDUCTION_LANES, row[0]);
+    size_t j = 0;
+    for (; j+REDUCTION_LANES<=cols; j+=REDUCTION_LANES)
+    {
+        for (size_t k=0; k<REDUCTION_LANES; k++)
+        {
+            lanes[k] = (lanes[k] < row[j + k]) ? row[j + k] : lanes[k];
+        }
+    }
+    for (; j<cols; j++)
+    {
+        lanes[0] = (lanes[0] < row[j]) ? row[j] : lanes[0];
+    }
+    return *std::max_element(lanes, lanes + REDUCTION_LANES);
+}
+
+// Writes exp(row - max) to out and returns its sum.
+template <typename T>
+T shiftedExp(const T* row, T* out, size_t cols, T max)
+{
+    for (size_t j=0; j<cols; j++)
+    {
+        out[j] = fastExp(row[j] - max);
+    }
+    return laneSum(out, cols, Identity());
+}
+
+// Replaces every row in [begin, end) of a row-major buffer with its softmax.
+template <typename T>
+void softmaxRows(T* data, size_t cols, size_t begin, size_t end)
+{
+    for (size_t i=begin; i<end; i++)
+    {
+        T* row = data + i * cols;
+        T total = shiftedExp(row, row, cols, rowMaximum(row, cols));
+        T inverse = T(1) / total;
+        for (size_t j=0; j<cols; j++)
+        {
+            row[j] *= inverse;
+        }
+    }
+}
+
+template <typename T>
+void checkSoftmaxInput(const Matrix<T>& mat)
+{
+    static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value,
+                  "softmax needs a float or double Matrix");
+    if (mat.rows() == 0 || mat.cols() == 0)
+    {
+        std::cerr << "Softmax - Matrix is empty" << std::endl;
+        std::abort();
+    }
+}
+} // namespace detail
+
+/**
+ * @brief Replaces every row of the Matrix object with its softmax.
+ *
+ * Each row is shifted by its largest element before the exponential, so
+ * large logits do not overflow. Rows are processed in parallel.
+ *
+ *
+ * @example
+ *
+ * #include "softmax.h"
+ *
+ * linalg::Matrix<float> logits{{{1, 2, 3}, {1, 1, 1}}};
+ * linalg::softmaxInPlace(logits);
+ * // every row sums to 1, the second row is [1/3 1/3 1/3]
+ *
+ *
+ * @param mat - Matrix object of float or double.
+ */
+template <typename T>
+void softmaxInPlace(Matrix<T>& mat)
+{
+    detail::checkSoftmaxInput(mat);
+    T* data = mat.data();
+    size_t cols = mat.cols();
+    detail::parallelFor(0, mat.rows(), std::max<size_t>(1, ELEMENTWISE_GRAIN / cols), [data, cols](size_t begin, size_t end)
+    {
+        detail::softmaxRows(data, cols, begin, end);
+    });
+}
+
+/**
+ * @brief Returns the row-wise softmax of the Matrix object.
+ *
+ *
+ * @param mat - Matrix object of float or double.
+ * @return Matrix object of the same size where every row sums to 1.
+ */
+template <typename T>
+Matrix<T> softmax(const Matrix<T>& mat)
+{
+    Matrix<T> res{mat};
+    softmaxInPlace(res);
+    return res;
+}
+
+/**
+ * @brief Returns log(sum(exp(row))) of every row as an M-by-1 Matrix object.
+ *
+ * Computed as max + log(sum(exp(row - max))), so it does not overflow for
+ * large values.
+ *
+ *
+ * @example
+ *
+ * #include "softmax.h"
+ *
+ * linalg::Matrix<double> A{{1000, 1000}};
+ * std::cout << linalg::logSumExp(A); // [[1000.69]]
+ *
+ *
+ * @param mat - Matrix object of float or double.
+ * @return Column of the log-sum-exp of every row.
+ */
+template <typename T>
+Matrix<T> logSumExp(const Matrix<T>& mat)
+{
+    detail::checkSoftmaxInput(mat);
+    Matrix<T> res(mat.rows(), 1);
+    size_t cols = mat.cols();
+    detail::parallelFor(0, mat.rows(), std::max<size_t>(1, ELEMENTWISE_GRAIN / cols), [&](size_t begin, size_t end)
+    {
+        std::vector<T> scratch(cols);
+        for (size_t i=begin; i<end; i++)
+        {
+            const T* row = mat.data() + i * cols;
+            T max = detail::rowMaximum(row, cols);
+            res(i, 0) = max + std::log(detail::shiftedExp(row, scratch.data(), cols, max));
+        }
+    });
+    return res;
+}
+
+/**
+ * @brief Returns softmax(lhs * rhs), applying the softmax as the last step of
+ * the matrix multiplication.
+ *
+ * Each thread multiplies a block of rows and normalizes it while the block is
+ * still in cache, so the logits are never written out and read back as a
+ * whole Matrix object.
+ *
+ *
+ * @example
+ *
+ * #include "softmax.h"
+ *
+ * linalg::Matrix<float> X{64, 512, 0.01f};
+ * linalg::Matrix<float> W{512, 1000, 0.02f};
+ * linalg::Matrix<float> P{linalg::multiplySoftmax(X, W)};
+ *
+ *
+ * @param lhs - The left-hand side Matrix object.
+ * @param rhs - The right-hand side Matrix object.
+ * @return Row-wise softmax of the product.
+ */
+template <typename T>
+Matrix<T> multiplySoftmax(const Matrix<T>& lhs, const Matrix<T>& rhs)
+{
+    detail::checkSoftmaxInput(rhs);
+    detail::checkProductSize(lhs.cols(), rhs.rows());
+
+    Matrix<T> res(lhs.rows(), rhs.cols());
+    T* out = res.data();
+    size_t cols = rhs.cols();
+    detail::gemm(lhs.rows(), cols, lhs.cols(), T(1), detail::RowMajorAccess<T>{lhs.data(), lhs.cols()},
+                 detail::RowMajorAccess<T>{rhs.data(), cols}, T(0), out, cols,
+                 [out, cols](size_t begin, size_t end)
+    {
+        detail::softmaxRows(out, cols, begin, end);
+    });
+    return res;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_SOFTMAX_H
@@ -0,0 +1,296 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_STREAMING_H
+#define MATRIX_STREAMING_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+
+
+namespace linalg
+{
+// Default number of rows multiplied together by a StreamingMultiplier.
+const size_t STREAM_BATCH_ROWS = 256;
+
+// Default number of batches a StreamingMultiplier queues on each side.
+const size_t STREAM_CAPACITY = 4;
+
+/**
+ * @brief Multiplies a stream of rows by a fixed Matrix object, returning the
+ * rows of the product in chunks as they are computed.
+ *
+ * One thread pushes row chunks of A of any size and another pulls chunks of
+ * A * B, in the same order. B is packed once for the multiplication kernel
+ * when the stream is constructed. A worker thread of the stream multiplies
+ * the rows in batches of up to batchRows: while it is busy, pushed rows
+ * collect into full batches, and when it is idle it takes the rows which
+ * have arrived, so a slow stream still gets its results right away.
+ *
+ * At most capacity batches wait to be multiplied and capacity results wait
+ * to be pulled. push() blocks while the input side is full and the worker
+ * stops while the output side is full, so a producer cannot run ahead of
+ * the consumer and memory stays bounded however long the stream is.
+ *
+ *
+ * @example
+ *
+ * #include "streaming.h"
+ *
+ * linalg::StreamingMultiplier<float> stream{weights};
+ * std::thread producer([&]()
+ * {
+ *     while (source.read(rows))
+ *     {
+ *         stream.push(rows);
+ *     }
+ *     stream.close();
+ * });
+ * linalg::Matrix<float> chunk{0, 0};
+ * while (stream.pull(chunk))
+ * {
+ *     sink.write(chunk); // rows of source * weights, in order
+ * }
+ * producer.join();
+ *
+ *
+ * @param rhs - The fixed right-hand side. It is copied into the packed form.
+ * @param batchRows - Largest number of rows multiplied at once.
+ * @param capacity - Number of batches queued on each side before blocking.
+ */
+template <typename T>
+class StreamingMultiplier
+{
+public:
+    StreamingMultiplier(const Matrix<T>& rhs, size_t batchRows=STREAM_BATCH_ROWS, size_t capacity=STREAM_CAPACITY)
+        : m_packed(rhs.rows(), rhs.cols(), detail::RowMajorAccess<T>{rhs.data(), rhs.cols()}),
+          m_batchRows{std::max<size_t>(batchRows, 1)}, m_capacity{std::max<size_t>(capacity, 1)},
+          m_fillingRows{0}, m_closed{false}, m_done{false}, m_stop{false}
+    {
+        m_worker = std::thread(&StreamingMultiplier::work, this);
+    }
+
+    StreamingMultiplier(const StreamingMultiplier&) = delete;
+    StreamingMultiplier& operator= (const StreamingMultiplier&) = delete;
+
+   /**
+    * @brief Stops the worker. Results which were not pulled are dropped.
+    */
+    ~StreamingMultiplier()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_changed.notify_all();
+        m_worker.join();
+    }
+
+    size_t inner() const
+    {
+        return m_packed.rows();
+    }
+
+    size_t cols() const
+    {
+        return m_packed.cols();
+    }
+
+   /**
+    * @brief Appends rows to the stream. Blocks while capacity batches are
+    * waiting to be multiplied.
+    *
+    * @param rows - Rows of A, with inner() columns.
+    */
+    void push(const Matrix<T>& rows)
+    {
+        if (rows.cols() != inner())
+        {
+            std::cerr << "Streaming multiplier - Matrix dimension do not match" << std::endl;
+            std::abort();
+        }
+        size_t k = inner();
+        size_t done = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_closed)
+        {
+            std::cerr << "Streaming multiplier - Push after close" << std::endl;
+            std::abort();
+        }
+        while (done < rows.rows())
+        {
+            size_t count = std::min(rows.rows() - done, m_batchRows - m_fillingRows);
+            m_filling.reserve(m_batchRows * k);
+            m_filling.insert(m_filling.end(), rows.data() + done * k, rows.data() + (done + count) * k);
+            m_fillingRows += count;
+            done += count;
+            if (m_fillingRows == m_batchRows)
+            {
+                m_changed.wait(lock, [this]() { return m_ready.size() < m_capacity || m_fillingRows == 0; });
+                if (m_fillingRows == m_batchRows)
+                {
+                    m_ready.push_back(Batch{m_fillingRows, std::move(m_filling)});
+                    m_filling.clear();
+                    m_fillingRows = 0;
+                }
+            }
+            m_changed.notify_all();
+        }
+    }
+
+   /**
+    * @brief Ends the stream. The rows pushed so far are still multiplied and
+    * can be pulled.
+    */
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_changed.notify_all();
+    }
+
+   /**
+    * @brief Waits for the next chunk of the product.
+    *
+    * @param chunk - Receives the next rows of A * B.
+    * @return false once the stream is closed and every chunk has been pulled.
+    */
+    bool pull(Matrix<T>& chunk)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this]() { return !m_results.empty() || m_done; });
+        return take(chunk);
+    }
+
+   /**
+    * @brief Takes the next chunk of the product if it is ready, without waiting.
+    *
+    * It returns false both when no chunk is ready yet and at the end of the
+    * stream. A consumer which only polls tells them apart with finished().
+    */
+    bool tryPull(Matrix<T>& chunk)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return take(chunk);
+    }
+
+   /**
+    * @brief Returns whether the stream is closed and every chunk has been
+    * pulled, so pull() and tryPull() will not return another one.
+    */
+    bool finished() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_done && m_results.empty();
+    }
+
+private:
+    struct Batch
+    {
+        size_t rows;
+        std::vector<T> data;
+    };
+
+    bool take(Matrix<T>& chunk)
+    {
+        if (m_results.empty())
+        {
+            return false;
+        }
+        chunk = std::move(m_results.front());
+        m_results.pop_front();
+        m_changed.notify_all();
+        return true;
+    }
+
+    void work()
+    {
+        size_t k = inner();
+        size_t n = cols();
+        while (true)
+        {
+            Batch batch;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_changed.wait(lock, [this]()
+                {
+                    return m_stop || !m_ready.empty() || m_fillingRows > 0 || m_closed;
+                });
+                if (m_stop || (m_ready.empty() && m_fillingRows == 0))
+                {
+                    m_done = true;
+                    m_changed.notify_all();
+                    return;
+                }
+                if (!m_ready.empty())
+                {
+                    batch = std::move(m_ready.front());
+                    m_ready.pop_front();
+                }
+                else
+                {
+                    // Idle with a partial batch: take it rather than wait.
+                    batch = Batch{m_fillingRows, std::move(m_filling)};
+                    m_filling.clear();
+                    m_fillingRows = 0;
+                }
+            }
+            m_changed.notify_all();
+
+            Matrix<T> res(batch.rows, n);
+            detail::gemmPacked(batch.rows, T(1), detail::RowMajorAccess<T>{batch.data.data(), k}, m_packed, T(0),
+                               res.data(), n, detail::NoEpilogue());
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this]() { return m_stop || m_results.size() < m_capacity; });
+            m_results.push_back(std::move(res));
+            m_changed.notify_all();
+        }
+    }
+
+    detail::PackedRhs<T> m_packed;
+    size_t m_batchRows;
+    size_t m_capacity;
+    std::vector<T> m_filling;
+    size_t m_fillingRows;
+    std::deque<Batch> m_ready;
+    std::deque<Matrix<T>> m_results;
+    bool m_closed;
+    bool m_done;
+    bool m_stop;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::thread m_worker;
+};
+
+}; // namespace linalg
+
+#endif // MATRIX_STREAMING_H
@@ -0,0 +1,306 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_SVD_H
+#define MATRIX_SVD_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "eigen.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "qr.h"
+
+
+namespace linalg
+{
+// Largest number of sweeps of the one-sided Jacobi SVD.
+const size_t SVD_SWEEPS = 64;
+
+/**
+ * @brief Thin singular value decomposition A = U diag(s) V^T.
+ *
+ * For k singular triplets, u is m x k, s is k x 1 by decreasing value and
+ * v is n x k. The columns of u and v are orthonormal.
+ */
+template <typename T>
+struct SingularValueDecomposition
+{
+    Matrix<T> u;
+    Matrix<T> s;
+    Matrix<T> v;
+};
+
+namespace detail
+{
+/*
+ * One-sided Jacobi on the r x c row-major buffer w, r <= c. Pairs of rows are
+ * rotated until they are all orthogonal, so that R W0 = W with R orthogonal.
+ * The rotations are accumulated in the r x r buffer rot, which should start
+ * as the identity. Every sweep visits the pairs in round-robin order: the
+ * r / 2 pairs of a round are disjoint and are rotated in parallel, so the
+ * result does not depend on the number of threads.
+ */
+template <typename T>
+void jacobiRows(T* w, size_t r, size_t c, T* rot)
+{
+    size_t players = r + (r % 2);
+    std::vector<size_t> seats(players);
+    std::iota(seats.begin(), seats.end(), size_t(0));
+    T eps = std::numeric_limits<T>::epsilon();
+
+    for (size_t sweep=0; sweep<SVD_SWEEPS; sweep++)
+    {
+        std::atomic<bool> rotated{false};
+        for (size_t round=0; round+1<players; round++)
+        {
+            parallelFor(0, players / 2, 1, [&](size_t begin, size_t end)
+            {
+                for (size_t pair=begin; pair<end; pair++)
+                {
+                    size_t p = std::min(seats[pair], seats[players - 1 - pair]);
+                    size_t q = std::max(seats[pair], seats[players - 1 - pair]);
+                    if (q >= r)
+                    {
+                        continue;
+                    }
+                    T* wp = w + p * c;
+                    T* wq = w + q * c;
+                    T alpha = dot(wp, wp, c);
+                    T beta = dot(wq, wq, c);
+                    T gamma = dot(wp, wq, c);
+                    if (!(std::abs(gamma) > eps * std::sqrt(alpha * beta)))
+                    {
+                        continue;
+                    }
+                    rotated = true;
+
+                    T zeta = (beta - alpha) / (T(2) * gamma);
+                    T t = T(1) / (std::abs(zeta) + std::sqrt(T(1) + zeta * zeta));
+                    t = (zeta < T(0)) ? -t : t;
+                    T cs = T(1) / std::sqrt(T(1) + t * t);
+                    T sn = cs * t;
+                    for (size_t j=0; j<c; j++)
+                    {
+                        T a = wp[j];
+                        T b = wq[j];
+                        wp[j] = cs * a - sn * b;
+                        wq[j] = sn * a + cs * b;
+                    }
+                    for (size_t j=0; j<r; j++)
+                    {
+                        T a = rot[p * r + j];
+                        T b = rot[q * r + j];
+                        rot[p * r + j] = cs * a - sn * b;
+                        rot[q * r + j] = sn * a + cs * b;
+                    }
+                }
+            });
+            // Keep the first seat and rotate the others.
+            std::rotate(seats.begin() + 1, seats.end() - 1, seats.end());
+        }
+        if (!rotated)
+        {
+            return;
+        }
+    }
+}
+
+/*
+ * SVD of the r x c Matrix object w, r <= c, as w = left diag(s) right^T with
+ * left r x r and right c x r. w is overwritten.
+ */
+template <typename T>
+void svdWide(Matrix<T>& w, Matrix<T>& left, std::vector<T>& s, Matrix<T>& right)
+{
+    size_t r = w.rows();
+    size_t c = w.cols();
+    Matrix<T> rot(r, r);
+    for (size_t i=0; i<r; i++)
+    {
+        rot(i, i) = T(1);
+    }
+    jacobiRows(w.data(), r, c, rot.data());
+
+    std::vector<T> norms(r);
+    for (size_t i=0; i<r; i++)
+    {
+        norms[i] = std::sqrt(dot(w.data() + i * c, w.data() + i * c, c));
+    }
+    std::vector<size_t> order(r);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) { return norms[lhs] > norms[rhs]; });
+
+    // w0 = rot^T w, so the left vectors are the rows of rot and the right
+    // vectors are the normalized rows of w.
+    left = Matrix<T>(r, r);
+    right = Matrix<T>(c, r);
+    s.resize(r);
+    for (size_t j=0; j<r; j++)
+    {
+        size_t row = order[j];
+        s[j] = norms[row];
+        T inverse = (norms[row] > T(0)) ? T(1) / norms[row] : T(0);
+        for (size_t i=0; i<r; i++)
+        {
+            left(i, j) = rot(row, i);
+        }
+        for (size_t i=0; i<c; i++)
+        {
+            right(i, j) = w(row, i) * inverse;
+        }
+    }
+}
+
+template <typename T>
+SingularValueDecomposition<T> truncate(const Matrix<T>& u, const std::vector<T>& s, const Matrix<T>& v, size_t k)
+{
+    SingularValueDecomposition<T> res{Matrix<T>(u.rows(), k), Matrix<T>(k, 1), Matrix<T>(v.rows(), k)};
+    for (size_t i=0; i<u.rows(); i++)
+    {
+        std::copy(u.data() + i * u.cols(), u.data() + i * u.cols() + k, res.u.data() + i * k);
+    }
+    for (size_t i=0; i<v.rows(); i++)
+    {
+        std::copy(v.data() + i * v.cols(), v.data() + i * v.cols() + k, res.v.data() + i * k);
+    }
+    for (size_t j=0; j<k; j++)
+    {
+        res.s(j, 0) = s[j];
+    }
+    return res;
+}
+} // namespace detail
+
+/**
+ * @brief Returns the thin singular value decomposition of a Matrix object.
+ *
+ * Uses one-sided Jacobi, which is accurate, also for small singular values,
+ * and costs O(min(m, n)^2 max(m, n)) per sweep. Rotations of disjoint pairs
+ * run in parallel. Meant for small and medium matrices, and as the last
+ * step of randomizedSvd().
+ *
+ *
+ * @example
+ *
+ * #include "svd.h"
+ *
+ * linalg::Matrix<double> A{{{3, 0}, {0, -2}, {0, 0}}};
+ * linalg::SingularValueDecomposition<double> usv{linalg::svd(A)};
+ * // usv.s is [[3] [2]]
+ *
+ *
+ * @param mat - Matrix object of float or double.
+ * @return The min(m, n) singular triplets.
+ */
+template <typename T>
+SingularValueDecomposition<T> svd(const Matrix<T>& mat)
+{
+    static_assert(std::is_floating_point<T>::value, "svd needs a floating point Matrix");
+    Matrix<T> left(0, 0);
+    Matrix<T> right(0, 0);
+    std::vector<T> s;
+    if (mat.rows() <= mat.cols())
+    {
+        Matrix<T> w{mat};
+        detail::svdWide(w, left, s, right);
+        return detail::truncate(left, s, right, s.size());
+    }
+    Matrix<T> w{mat.transpose()};
+    detail::svdWide(w, left, s, right);
+    return detail::truncate(right, s, left, s.size());
+}
+
+/**
+ * @brief Returns an approximation of the k largest singular triplets with
+ * the randomized range finder of Halko, Martinsson and Tropp (2011).
+ *
+ * The range of A is sampled with k + oversampling random vectors,
+ * sharpened with a few power iterations, orthonormalized with QR, and the
+ * small projected matrix Q^T A is decomposed with svd(). A is read in
+ * 2 + 2 * powerIterations matrix multiplications, and everything else is
+ * done on matrices with k + oversampling columns or rows.
+ *
+ *
+ * @example
+ *
+ * #include "svd.h"
+ *
+ * linalg::Matrix<double> A{20000, 5000};
+ * // ... fill A
+ * linalg::SingularValueDecomposition<double> usv{linalg::randomizedSvd(A, 20)};
+ *
+ *
+ * @param mat - Matrix object of float or double.
+ * @param k - Number of singular triplets.
+ * @param oversampling - Additional random vectors, which improve accuracy.
+ * @param powerIterations - Passes of A A^T, which help when the singular
+ *                          values decay slowly.
+ * @return k singular triplets.
+ */
+template <typename T>
+SingularValueDecomposition<T> randomizedSvd(const Matrix<T>& mat, size_t k, size_t oversampling = 10,
+                                            size_t powerIterations = 2)
+{
+    static_assert(std::is_floating_point<T>::value, "randomizedSvd needs a floating point Matrix");
+    size_t m = mat.rows();
+    size_t n = mat.cols();
+    if (k == 0 || k > std::min(m, n))
+    {
+        std::cerr << "Randomized SVD - Number of triplets should be between 1 and the smallest dimension" << std::endl;
+        std::abort();
+    }
+    size_t l = std::min(k + oversampling, std::min(m, n));
+
+    Matrix<T> sketch(m, l);
+    Matrix<T> omega{detail::startBlock<T>(n, l, 0)};
+    detail::gemm(Transpose::No, Transpose::No, m, l, n, T(1), mat.data(), n, omega.data(), l, T(0), sketch.data(), l);
+    Matrix<T> q{QRDecomposition<T>{std::move(sketch)}.q()};
+    for (size_t i=0; i<powerIterations; i++)
+    {
+        detail::gemm(Transpose::Yes, Transpose::No, n, l, m, T(1), mat.data(), n, q.data(), l, T(0), omega.data(), l);
+        Matrix<T> z{QRDecomposition<T>{omega}.q()};
+        Matrix<T> y(m, l);
+        detail::gemm(Transpose::No, Transpose::No, m, l, n, T(1), mat.data(), n, z.data(), l, T(0), y.data(), l);
+        q = QRDecomposition<T>{std::move(y)}.q();
+    }
+
+    // B = Q^T A is l x n, and B = left diag(s) right^T.
+    Matrix<T> b(l, n);
+    detail::gemm(Transpose::Yes, Transpose::No, l, n, m, T(1), q.data(), l, mat.data(), n, T(0), b.data(), n);
+    Matrix<T> left(0, 0);
+    Matrix<T> right(0, 0);
+    std::vector<T> s;
+    detail::svdWide(b, left, s, right);
+    Matrix<T> u{q * left};
+    return detail::truncate(u, s, right, k);
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_SVD_H
@@ -0,0 +1,198 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_TASK_GRAPH_H
+#define MATRIX_TASK_GRAPH_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "dataflow.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+/**
+ * @brief A graph of dependent Matrix operations, run with independent
+ * operations in parallel.
+ *
+ * Every operation returns a node which later operations take as input, so
+ * the graph is built in dependency order and cannot have cycles. run()
+ * starts the operations whose inputs are ready and, as each one finishes,
+ * starts the operations it unblocks, through a Dataflow. Threads without a
+ * ready operation sleep on a condition variable instead of polling. Operations keep using the
+ * parallel kernels of the library, so a single large product still uses
+ * every thread.
+ *
+ * The library targets C++11, so dependencies are continuations on the thread
+ * pool rather than coroutines.
+ *
+ *
+ * @example
+ *
+ * #include "task_graph.h"
+ *
+ * linalg::TaskGraph<double> graph;
+ * auto a = graph.input(A);
+ * auto b = graph.input(B);
+ * auto c = graph.input(C);
+ * auto d = graph.input(D);
+ * auto sum = graph.add(graph.multiply(a, b), graph.multiply(c, d)); // products run concurrently
+ * auto out = graph.transpose(sum);
+ * graph.run();
+ * std::cout << graph.result(out);
+ */
+template <typename T>
+class TaskGraph
+{
+public:
+    typedef size_t Node;
+    typedef std::function<Matrix<T>(const std::vector<const Matrix<T>*>&)> Operation;
+
+   /**
+    * @brief Adds a Matrix object as an input of the graph. It is read by
+    * reference, so it should outlive run().
+    */
+    Node input(const Matrix<T>& mat)
+    {
+        m_tasks.push_back(Task{std::vector<Node>(), Operation()});
+        m_values.push_back(&mat);
+        m_owned.emplace_back();
+        return m_tasks.size() - 1;
+    }
+
+   /**
+    * @brief Adds an operation on the results of other nodes.
+    *
+    * @param inputs - Nodes whose results are passed to the operation, in order.
+    * @param operation - Callable taking the input Matrix objects and returning the result.
+    * @return The new node.
+    */
+    Node apply(const std::vector<Node>& inputs, Operation operation)
+    {
+        Node node = m_tasks.size();
+        for (Node in : inputs)
+        {
+            if (in >= node)
+            {
+                std::cerr << "Task graph - Input node does not exist" << std::endl;
+                std::abort();
+            }
+        }
+        m_tasks.push_back(Task{inputs, std::move(operation)});
+        m_values.push_back(nullptr);
+        m_owned.emplace_back();
+        return node;
+    }
+
+    Node multiply(Node lhs, Node rhs)
+    {
+        return apply({lhs, rhs}, [](const std::vector<const Matrix<T>*>& in) { return Matrix<T>{*in[0] * *in[1]}; });
+    }
+
+    Node add(Node lhs, Node rhs)
+    {
+        return apply({lhs, rhs}, [](const std::vector<const Matrix<T>*>& in) { return Matrix<T>{*in[0] + *in[1]}; });
+    }
+
+    Node subtract(Node lhs, Node rhs)
+    {
+        return apply({lhs, rhs}, [](const std::vector<const Matrix<T>*>& in) { return Matrix<T>{*in[0] - *in[1]}; });
+    }
+
+    Node transpose(Node mat)
+    {
+        return apply({mat}, [](const std::vector<const Matrix<T>*>& in) { return in[0]->transpose(); });
+    }
+
+   /**
+    * @brief Runs every operation of the graph and returns when all are done.
+    *
+    * The calling thread runs operations too. With a single thread the
+    * operations run one after the other in the order they were added.
+    */
+    void run()
+    {
+        Dataflow flow;
+        std::vector<Dataflow::Task> tasks(m_tasks.size());
+        for (Node node=0; node<m_tasks.size(); node++)
+        {
+            if (!m_tasks[node].operation)
+            {
+                continue;
+            }
+            std::vector<Dataflow::Task> after;
+            for (Node in : m_tasks[node].inputs)
+            {
+                if (m_tasks[in].operation)
+                {
+                    after.push_back(tasks[in]);
+                }
+            }
+            tasks[node] = flow.add([this, node]() { execute(node); }, after);
+        }
+        flow.run();
+    }
+
+   /**
+    * @brief Returns the result of a node once run() has returned.
+    */
+    const Matrix<T>& result(Node node) const
+    {
+        if (node >= m_values.size() || m_values[node] == nullptr)
+        {
+            std::cerr << "Task graph - Node has not been computed" << std::endl;
+            std::abort();
+        }
+        return *m_values[node];
+    }
+
+private:
+    struct Task
+    {
+        std::vector<Node> inputs;
+        Operation operation;
+    };
+
+    void execute(Node node)
+    {
+        const Task& task = m_tasks[node];
+        std::vector<const Matrix<T>*> inputs;
+        inputs.reserve(task.inputs.size());
+        for (Node in : task.inputs)
+        {
+            inputs.push_back(m_values[in]);
+        }
+        m_owned[node].reset(new Matrix<T>(task.operation(inputs)));
+        m_values[node] = m_owned[node].get();
+    }
+
+    std::vector<Task> m_tasks;
+    std::vector<const Matrix<T>*> m_values;
+    std::vector<std::unique_ptr<Matrix<T>>> m_owned;
+};
+
+}; // namespace linalg
+
+#endif // MATRIX_TASK_GRAPH_H
@@ -0,0 +1,575 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_TRANSPORT_H
+#define MATRIX_TRANSPORT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+
+namespace linalg
+{
+/**
+ * @brief Point-to-point messages between the processes of a distributed
+ * computation.
+ *
+ * Processes are numbered from 0 to size() - 1. A message is identified by its
+ * source and a tag chosen by the caller. Messages with the same source and tag
+ * are received in the order they were sent, and a message with another tag
+ * never blocks one being waited for. The distributed algorithms of the
+ * library only use this interface and the collectives built on it, so they can
+ * run over LocalTransport on one machine or over an MPI-backed implementation
+ * of the same four calls.
+ */
+class Transport
+{
+public:
+    virtual ~Transport()
+    {
+    }
+
+    virtual size_t rank() const = 0;
+    virtual size_t size() const = 0;
+
+   /**
+    * @brief Sends bytes to a process. Returns once the buffer can be reused.
+    */
+    virtual void send(size_t dest, int tag, const void* data, size_t bytes) = 0;
+
+   /**
+    * @brief Waits for the next message with the given source and tag. Its
+    * size should be bytes.
+    */
+    virtual void recv(size_t source, int tag, void* data, size_t bytes) = 0;
+
+   /**
+    * @brief Returns the number of bytes this process has sent to other processes.
+    */
+    virtual size_t bytesSent() const = 0;
+};
+
+// Tags below this value are used by the collectives of the library.
+const int TRANSPORT_RESERVED_TAG = -1000;
+
+/**
+ * @brief Returns when every process has called barrier().
+ */
+inline void barrier(Transport& transport)
+{
+    const int TAG = TRANSPORT_RESERVED_TAG - 1;
+    char token = 0;
+    if (transport.rank() == 0)
+    {
+        for (size_t p=1; p<transport.size(); p++)
+        {
+            transport.recv(p, TAG, &token, 1);
+        }
+        for (size_t p=1; p<transport.size(); p++)
+        {
+            transport.send(p, TAG, &token, 1);
+        }
+    }
+    else
+    {
+        transport.send(0, TAG, &token, 1);
+        transport.recv(0, TAG, &token, 1);
+    }
+}
+
+namespace detail
+{
+// Position of the calling process in group.
+inline size_t groupPosition(const Transport& transport, const std::vector<size_t>& group, const char* name)
+{
+    for (size_t i=0; i<group.size(); i++)
+    {
+        if (group[i] == transport.rank())
+        {
+            return i;
+        }
+    }
+    std::cerr << name << " - Process is not in the group" << std::endl;
+    std::abort();
+}
+} // namespace detail
+
+/**
+ * @brief Sends bytes from group[root] to every process of the group along a
+ * binomial tree, so the root sends log2(group size) messages instead of one
+ * per process.
+ *
+ * Every process of the group calls it with the same arguments, and only they
+ * do. The root returns as soon as its own messages are sent.
+ *
+ *
+ * @param transport - The transport of the calling process.
+ * @param group - Ranks of the processes taking part.
+ * @param root - Position of the sender in group.
+ * @param data - Data to send on the root, buffer to receive into on the others.
+ * @param bytes - Size of the data.
+ * @param tag - Tag of the messages.
+ */
+inline void broadcast(Transport& transport, const std::vector<size_t>& group, size_t root, void* data,
+                      size_t bytes, int tag)
+{
+    size_t count = group.size();
+    size_t me = detail::groupPosition(transport, group, "Broadcast");
+
+    // Positions relative to the root. Position r receives from r minus its
+    // lowest set bit, then sends to r + 2^i for the smaller powers of two.
+    size_t relative = (me + count - root) % count;
+    size_t mask = 1;
+    while (mask < count)
+    {
+        if (relative & mask)
+        {
+            transport.recv(group[(relative - mask + root) % count], tag, data, bytes);
+            break;
+        }
+        mask <<= 1;
+    }
+    for (mask >>= 1; mask > 0; mask >>= 1)
+    {
+        if (relative + mask < count)
+        {
+            transport.send(group[(relative + mask + root) % count], tag, data, bytes);
+        }
+    }
+}
+
+/**
+ * @brief Sums arrays of the processes of a group into the array of
+ * group[root], along a binomial tree, so no process receives more than
+ * log2(group size) arrays.
+ *
+ * Every process of the group calls it with the same arguments, and only they
+ * do. On the other processes data is left holding a partial sum.
+ *
+ *
+ * @param transport - The transport of the calling process.
+ * @param group - Ranks of the processes taking part.
+ * @param root - Position of the receiver of the sum in group.
+ * @param data - Array of count elements, replaced by the sum on the root.
+ * @param count - Number of elements.
+ * @param tag - Tag of the messages.
+ */
+template <typename T>
+void reduceSum(Transport& transport, const std::vector<size_t>& group, size_t root, T* data, size_t count, int tag)
+{
+    size_t size = group.size();
+    size_t relative = (detail::groupPosition(transport, group, "Reduce") + size - root) % size;
+    std::vector<T> incoming;
+
+    // Position r adds in the sums of r + 2^i for the powers of two below its
+    // lowest set bit, then sends its own sum to r minus that bit.
+    for (size_t mask=1; mask<size; mask<<=1)
+    {
+        if (relative & mask)
+        {
+            transport.send(group[(relative - mask + root) % size], tag, data, count * sizeof(T));
+            return;
+        }
+        if (relative + mask < size)
+        {
+            incoming.resize(count);
+            transport.recv(group[(relative + mask + root) % size], tag, incoming.data(), count * sizeof(T));
+            for (size_t e=0; e<count; e++)
+            {
+                data[e] += incoming[e];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Transport between the processes of one machine, over a Unix
+ * socket pair for every pair of processes. Created by runProcesses().
+ *
+ * A progress thread reads every socket as data arrives and files the messages
+ * in per-source mailboxes. Sends never wait for the receiver to post a
+ * receive, so exchanges where everyone sends before receiving do not deadlock.
+ * A receive waiting on a process which has exited aborts instead of hanging.
+ */
+class LocalTransport : public Transport
+{
+public:
+    LocalTransport(size_t rank, std::vector<int> sockets)
+        : m_rank{rank}, m_sockets(std::move(sockets)), m_mailboxes(m_sockets.size()),
+          m_closed(m_sockets.size(), false), m_bytesSent{0}
+    {
+        for (size_t p=0; p<m_sockets.size(); p++)
+        {
+            m_sendLocks.emplace_back(new std::mutex);
+        }
+        if (pipe(m_wakeup) != 0)
+        {
+            std::cerr << "Local transport - Could not create a pipe" << std::endl;
+            std::abort();
+        }
+        m_progress = std::thread(&LocalTransport::progress, this);
+    }
+
+    LocalTransport(const LocalTransport&) = delete;
+    LocalTransport& operator= (const LocalTransport&) = delete;
+
+    ~LocalTransport()
+    {
+        char stop = 0;
+        writeFully(m_wakeup[1], &stop, 1);
+        m_progress.join();
+        close(m_wakeup[0]);
+        close(m_wakeup[1]);
+        for (int fd : m_sockets)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    size_t rank() const override
+    {
+        return m_rank;
+    }
+
+    size_t size() const override
+    {
+        return m_sockets.size();
+    }
+
+    void send(size_t dest, int tag, const void* data, size_t bytes) override
+    {
+        if (dest == m_rank)
+        {
+            deliver(dest, tag, std::vector<char>(static_cast<const char*>(data), static_cast<const char*>(data) + bytes));
+            return;
+        }
+        Header header{static_cast<int64_t>(tag), static_cast<uint64_t>(bytes)};
+        std::lock_guard<std::mutex> lock(*m_sendLocks[dest]);
+        writeFully(m_sockets[dest], &header, sizeof(header));
+        writeFully(m_sockets[dest], data, bytes);
+        m_bytesSent += bytes;
+    }
+
+    void recv(size_t source, int tag, void* data, size_t bytes) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::deque<Message>& box = m_mailboxes[source];
+        std::deque<Message>::iterator found;
+        m_arrived.wait(lock, [&]()
+        {
+            found = std::find_if(box.begin(), box.end(), [tag](const Message& m) { return m.tag == tag; });
+            return found != box.end() || m_closed[source];
+        });
+        if (found == box.end())
+        {
+            std::cerr << "Local transport - Process " << source << " exited before sending" << std::endl;
+            std::abort();
+        }
+        if (found->data.size() != bytes)
+        {
+            std::cerr << "Local transport - Message size does not match the receive" << std::endl;
+            std::abort();
+        }
+        std::memcpy(data, found->data.data(), bytes);
+        box.erase(found);
+    }
+
+    size_t bytesSent() const override
+    {
+        return m_bytesSent;
+    }
+
+private:
+    struct Header
+    {
+        int64_t tag;
+        uint64_t bytes;
+    };
+
+    struct Message
+    {
+        int tag;
+        std::vector<char> data;
+    };
+
+    static void writeFully(int fd, const void* data, size_t bytes)
+    {
+        const char* next = static_cast<const char*>(data);
+        while (bytes > 0)
+        {
+            ssize_t written = write(fd, next, bytes);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                std::cerr << "Local transport - Write failed: " << std::strerror(errno) << std::endl;
+                std::abort();
+            }
+            next += written;
+            bytes -= static_cast<size_t>(written);
+        }
+    }
+
+    // Returns false if the peer closed the socket before the first byte.
+    static bool readFully(int fd, void* data, size_t bytes)
+    {
+        char* next = static_cast<char*>(data);
+        size_t total = bytes;
+        while (bytes > 0)
+        {
+            ssize_t got = read(fd, next, bytes);
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got == 0 && bytes == total)
+            {
+                return false;
+            }
+            if (got <= 0)
+            {
+                std::cerr << "Local transport - Read failed" << std::endl;
+                std::abort();
+            }
+            next += got;
+            bytes -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+
+    void deliver(size_t source, int tag, std::vector<char> data)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_mailboxes[source].push_back(Message{tag, std::move(data)});
+        }
+        m_arrived.notify_all();
+    }
+
+    // A sender writes a whole message under its lock, so once a header is
+    // readable the rest of the message follows without waiting on anyone.
+    void progress()
+    {
+        std::vector<pollfd> fds;
+        std::vector<size_t> peers;
+        while (true)
+        {
+            fds.assign(1, pollfd{m_wakeup[0], POLLIN, 0});
+            peers.assign(1, m_rank);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (size_t p=0; p<m_sockets.size(); p++)
+                {
+                    if (m_sockets[p] >= 0 && !m_closed[p])
+                    {
+                        fds.push_back(pollfd{m_sockets[p], POLLIN, 0});
+                        peers.push_back(p);
+                    }
+                }
+            }
+            if (poll(fds.data(), fds.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                std::cerr << "Local transport - Poll failed" << std::endl;
+                std::abort();
+            }
+            if (fds[0].revents != 0)
+            {
+                return;
+            }
+            for (size_t i=1; i<fds.size(); i++)
+            {
+                if (fds[i].revents == 0)
+                {
+                    continue;
+                }
+                Header header;
+                if (!readFully(fds[i].fd, &header, sizeof(header)))
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_closed[peers[i]] = true;
+                    }
+                    m_arrived.notify_all();
+                    continue;
+                }
+                std::vector<char> data(header.bytes);
+                if (header.bytes > 0 && !readFully(fds[i].fd, data.data(), data.size()))
+                {
+                    std::cerr << "Local transport - Message cut short" << std::endl;
+                    std::abort();
+                }
+                deliver(peers[i], static_cast<int>(header.tag), std::move(data));
+            }
+        }
+    }
+
+    size_t m_rank;
+    std::vector<int> m_sockets;
+    std::vector<std::deque<Message>> m_mailboxes;
+    std::vector<bool> m_closed;
+    std::vector<std::unique_ptr<std::mutex>> m_sendLocks;
+    std::mutex m_mutex;
+    std::condition_variable m_arrived;
+    std::atomic<size_t> m_bytesSent;
+    int m_wakeup[2];
+    std::thread m_progress;
+};
+
+/**
+ * @brief Runs a function in the given number of processes, connected by a
+ * LocalTransport, and waits for all of them.
+ *
+ * The processes are forked from the caller, so they start with a copy of its
+ * memory, which is a simple way to hand them their input. Each one runs the
+ * library single-threaded, since the thread pool of the parent is not copied
+ * by fork(), and leaves with _exit() once every process is done. Call it
+ * while no other thread of the caller holds a lock.
+ *
+ *
+ * @example
+ *
+ * #include "transport.h"
+ *
+ * bool ok = linalg::runProcesses(4, [](linalg::Transport& transport)
+ * {
+ *     double value = 1.0 + transport.rank();
+ *     std::vector<size_t> everyone{0, 1, 2, 3};
+ *     linalg::broadcast(transport, everyone, 2, &value, sizeof(value), 0);
+ *     return value == 3.0 ? 0 : 1; // every process gets the value of rank 2
+ * });
+ *
+ *
+ * @param count - Number of processes.
+ * @param function - Called with the transport of each process. Its return
+ *                   value is the exit status of the process.
+ * @return Whether every process exited with status 0.
+ */
+inline bool runProcesses(size_t count, const std::function<int(Transport&)>& function)
+{
+    // sockets[i][j] is the end held by process i of its link to process j.
+    std::vector<std::vector<int>> sockets(count, std::vector<int>(count, -1));
+    for (size_t i=0; i<count; i++)
+    {
+        for (size_t j=i+1; j<count; j++)
+        {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+            {
+                std::cerr << "Run processes - Could not create a socket pair" << std::endl;
+                std::abort();
+            }
+            sockets[i][j] = pair[0];
+            sockets[j][i] = pair[1];
+        }
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::vector<pid_t> children;
+    for (size_t r=0; r<count; r++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            std::cerr << "Run processes - Could not fork" << std::endl;
+            std::abort();
+        }
+        if (pid == 0)
+        {
+            for (size_t i=0; i<count; i++)
+            {
+                for (size_t j=0; j<count; j++)
+                {
+                    if (i != r && sockets[i][j] >= 0)
+                    {
+                        close(sockets[i][j]);
+                    }
+                }
+            }
+            signal(SIGPIPE, SIG_IGN);
+            setNumThreads(1);
+            int status;
+            {
+                LocalTransport transport(r, sockets[r]);
+                status = function(transport);
+                barrier(transport);
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            _exit(status);
+        }
+        children.push_back(pid);
+    }
+
+    for (size_t i=0; i<count; i++)
+    {
+        for (size_t j=0; j<count; j++)
+        {
+            if (sockets[i][j] >= 0)
+            {
+                close(sockets[i][j]);
+            }
+        }
+    }
+    bool ok = true;
+    for (pid_t pid : children)
+    {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return ok;
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_TRANSPORT_H
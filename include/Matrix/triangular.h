@@ -0,0 +1,516 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATRIX_TRIANGULAR_H
+#define MATRIX_TRIANGULAR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "parallel.h"
+
+
+namespace linalg
+{
+/**
+ * @brief Which triangle of a square operand holds the data.
+ */
+enum class Triangle
+{
+    Lower,
+    Upper
+};
+
+/**
+ * @brief Whether the triangular operand is on the left or on the right of
+ * the unknown.
+ */
+enum class Side
+{
+    Left,
+    Right
+};
+
+/**
+ * @brief Whether the diagonal of a triangular operand is stored or is all
+ * ones.
+ */
+enum class Diagonal
+{
+    NonUnit,
+    Unit
+};
+
+// Blocking of the triangular kernels. Diagonal blocks are solved directly and
+// everything else goes through the matrix multiplication kernel.
+const size_t TRIANGULAR_BLOCK = 64;
+
+// Smallest number of right-hand side columns, or rows, given to one thread.
+const size_t TRIANGULAR_GRAIN = 16;
+
+// Rows of C computed by one call to the matrix multiplication in syrkLower().
+const size_t SYRK_BLOCK = 256;
+
+namespace detail
+{
+// True when op(A) is lower triangular.
+inline bool isLower(Triangle uplo, Transpose trans)
+{
+    return (uplo == Triangle::Lower) == (trans == Transpose::No);
+}
+
+// Address of element (row, col) of op(A), to be read with the accessor for trans.
+template <typename T>
+const T* opBlock(Transpose trans, const T* a, size_t lda, size_t row, size_t col)
+{
+    return (trans == Transpose::No) ? a + row * lda + col : a + col * lda + row;
+}
+
+/*
+ * Unblocked solve of A X = B for the columns [begin, end) of B, where A
+ * is the kb x kb triangle read through the accessor a. Lower means forward
+ * substitution.
+ */
+template <typename T, typename Access>
+void trsmDiagonal(bool lower, Diagonal diag, size_t kb, const Access& a, T* b, size_t ldb, size_t begin, size_t end)
+{
+    for (size_t step=0; step<kb; step++)
+    {
+        size_t i = lower ? step : kb - 1 - step;
+        size_t first = lower ? 0 : i + 1;
+        size_t last = lower ? i : kb;
+        T* row = b + i * ldb;
+        for (size_t p=first; p<last; p++)
+        {
+            T factor = a(i, p);
+            const T* solved = b + p * ldb;
+            for (size_t j=begin; j<end; j++)
+            {
+                row[j] -= factor * solved[j];
+            }
+        }
+        if (diag == Diagonal::NonUnit)
+        {
+            T inverse = T(1) / a(i, i);
+            for (size_t j=begin; j<end; j++)
+            {
+                row[j] *= inverse;
+            }
+        }
+    }
+}
+
+/*
+ * Unblocked solve of X A = B for the rows [begin, end) of B, where A is the
+ * kb x kb triangle read through the accessor a. Every row is independent and
+ * is solved left to right when A is upper triangular.
+ */
+template <typename T, typename Access>
+void trsmDiagonalRight(bool lower, Diagonal diag, size_t kb, const Access& a, T* b, size_t ldb,
+                       size_t begin, size_t end)
+{
+    for (size_t i=begin; i<end; i++)
+    {
+        T* row = b + i * ldb;
+        for (size_t step=0; step<kb; step++)
+        {
+            size_t j = lower ? kb - 1 - step : step;
+            size_t first = lower ? j + 1 : 0;
+            size_t last = lower ? kb : j;
+            T value = row[j];
+            for (size_t p=first; p<last; p++)
+            {
+                value -= row[p] * a(p, j);
+            }
+            row[j] = (diag == Diagonal::NonUnit) ? value / a(j, j) : value;
+        }
+    }
+}
+
+// Solves a diagonal block for all the columns of B, split between threads.
+template <typename T>
+void trsmBlock(bool lower, Transpose trans, Diagonal diag, size_t kb, const T* a, size_t lda,
+               T* b, size_t ldb, size_t n)
+{
+    parallelFor(0, n, TRIANGULAR_GRAIN, [&](size_t begin, size_t end)
+    {
+        if (trans == Transpose::No)
+        {
+            trsmDiagonal(lower, diag, kb, RowMajorAccess<T>{a, lda}, b, ldb, begin, end);
+        }
+        else
+        {
+            trsmDiagonal(lower, diag, kb, TransposedAccess<T>{a, lda}, b, ldb, begin, end);
+        }
+    });
+}
+
+// Solves a diagonal block for all the rows of B, split between threads.
+template <typename T>
+void trsmBlockRight(bool lower, Transpose trans, Diagonal diag, size_t kb, const T* a, size_t lda,
+                    T* b, size_t ldb, size_t m)
+{
+    parallelFor(0, m, TRIANGULAR_GRAIN, [&](size_t begin, size_t end)
+    {
+        if (trans == Transpose::No)
+        {
+            trsmDiagonalRight(lower, diag, kb, RowMajorAccess<T>{a, lda}, b, ldb, begin, end);
+        }
+        else
+        {
+            trsmDiagonalRight(lower, diag, kb, TransposedAccess<T>{a, lda}, b, ldb, begin, end);
+        }
+    });
+}
+
+/*
+ * Solves op(A) X = B in place of B, where A is an m x m triangle and B is
+ * m x n, both row-major. Diagonal blocks are solved by column ranges in
+ * parallel and the rest of B is updated with the multithreaded matrix
+ * multiplication.
+ */
+template <typename T>
+void trsmLeft(Triangle uplo, Transpose trans, Diagonal diag, size_t m, size_t n,
+              const T* a, size_t lda, T* b, size_t ldb)
+{
+    bool lower = isLower(uplo, trans);
+    for (size_t done=0; done<m; )
+    {
+        size_t kb = std::min(TRIANGULAR_BLOCK, m - done);
+        size_t k0 = lower ? done : m - done - kb;
+        trsmBlock(lower, trans, diag, kb, opBlock(trans, a, lda, k0, k0), lda, b + k0 * ldb, ldb, n);
+
+        if (lower)
+        {
+            // B2 -= A21 * X1
+            gemm(trans, Transpose::No, m - k0 - kb, n, kb, T(-1), opBlock(trans, a, lda, k0 + kb, k0), lda,
+                 b + k0 * ldb, ldb, T(1), b + (k0 + kb) * ldb, ldb);
+        }
+        else
+        {
+            // B0 -= A01 * X1
+            gemm(trans, Transpose::No, k0, n, kb, T(-1), opBlock(trans, a, lda, size_t(0), k0), lda,
+                 b + k0 * ldb, ldb, T(1), b, ldb);
+        }
+        done += kb;
+    }
+}
+
+/*
+ * Solves X op(A) = B in place of B, where A is an n x n triangle and B is
+ * m x n, both row-major. Diagonal blocks are solved by row ranges in
+ * parallel and the rest of B is updated with the matrix multiplication.
+ */
+template <typename T>
+void trsmRight(Triangle uplo, Transpose trans, Diagonal diag, size_t m, size_t n,
+               const T* a, size_t lda, T* b, size_t ldb)
+{
+    bool lower = isLower(uplo, trans);
+    for (size_t done=0; done<n; )
+    {
+        size_t kb = std::min(TRIANGULAR_BLOCK, n - done);
+        size_t k0 = lower ? n - done - kb : done;
+        trsmBlockRight(lower, trans, diag, kb, opBlock(trans, a, lda, k0, k0), lda, b + k0, ldb, m);
+
+        if (lower)
+        {
+            // B0 -= X1 * A10
+            gemm(Transpose::No, trans, m, k0, kb, T(-1), b + k0, ldb, opBlock(trans, a, lda, k0, size_t(0)), lda,
+                 T(1), b, ldb);
+        }
+        else
+        {
+            // B2 -= X1 * A12
+            gemm(Transpose::No, trans, m, n - k0 - kb, kb, T(-1), b + k0, ldb, opBlock(trans, a, lda, k0, k0 + kb),
+                 lda, T(1), b + k0 + kb, ldb);
+        }
+        done += kb;
+    }
+}
+
+/*
+ * Lower triangle of C = alpha * A * A^T + beta * C, where A is n x k and C is
+ * n x n, both row-major. Blocks left of the diagonal go straight through the
+ * matrix multiplication. Diagonal blocks are computed in a scratch buffer so
+ * the strictly upper triangle of C is never written.
+ */
+template <typename T>
+void syrkLower(size_t n, size_t k, T alpha, const T* a, size_t lda, T beta, T* c, size_t ldc)
+{
+    std::vector<T> diagonal;
+    for (size_t i0=0; i0<n; i0+=SYRK_BLOCK)
+    {
+        size_t rows = std::min(SYRK_BLOCK, n - i0);
+        gemm(Transpose::No, Transpose::Yes, rows, i0, k, alpha, a + i0 * lda, lda, a, lda, beta, c + i0 * ldc, ldc);
+
+        diagonal.assign(rows * rows, T(0));
+        gemm(Transpose::No, Transpose::Yes, rows, rows, k, alpha, a + i0 * lda, lda, a + i0 * lda, lda,
+             T(0), diagonal.data(), rows);
+        for (size_t r=0; r<rows; r++)
+        {
+            T* out = c + (i0 + r) * ldc + i0;
+            const T* in = diagonal.data() + r * rows;
+            for (size_t j=0; j<=r; j++)
+            {
+                out[j] = (beta == T(0)) ? in[j] : beta * out[j] + in[j];
+            }
+        }
+    }
+}
+
+/*
+ * B = U B in place, where U is the m x m upper triangle at a and B is m x n.
+ * Row blocks are done top down: each one only needs the rows below it, which
+ * are not overwritten yet.
+ */
+template <typename T>
+void trmmUpperLeft(Diagonal diag, size_t m, size_t n, const T* a, size_t lda, T* b, size_t ldb)
+{
+    for (size_t i0=0; i0<m; i0+=TRIANGULAR_BLOCK)
+    {
+        size_t ib = std::min(TRIANGULAR_BLOCK, m - i0);
+        const T* block = a + i0 * lda + i0;
+        T* rows = b + i0 * ldb;
+        parallelFor(0, n, TRIANGULAR_GRAIN, [=](size_t begin, size_t end)
+        {
+            for (size_t r=0; r<ib; r++)
+            {
+                T* row = rows + r * ldb;
+                if (diag == Diagonal::NonUnit)
+                {
+                    T scale = block[r * lda + r];
+                    for (size_t j=begin; j<end; j++)
+                    {
+                        row[j] *= scale;
+                    }
+                }
+                for (size_t p=r+1; p<ib; p++)
+                {
+                    T factor = block[r * lda + p];
+                    const T* other = rows + p * ldb;
+                    for (size_t j=begin; j<end; j++)
+                    {
+                        row[j] += factor * other[j];
+                    }
+                }
+            }
+        });
+
+        // B1 += U12 * B2
+        gemm(Transpose::No, Transpose::No, ib, n, m - i0 - ib, T(1), block + ib, lda,
+             rows + ib * ldb, ldb, T(1), rows, ldb);
+    }
+}
+
+// Unblocked inverse of the kb x kb upper triangle at a, in place.
+template <typename T>
+void trtriDiagonal(Diagonal diag, size_t kb, T* a, size_t lda)
+{
+    for (size_t j=0; j<kb; j++)
+    {
+        T scale = T(-1);
+        if (diag == Diagonal::NonUnit)
+        {
+            a[j * lda + j] = T(1) / a[j * lda + j];
+            scale = -a[j * lda + j];
+        }
+
+        // Column j above the diagonal = -U(j, j)^-1 * inv(U00) * U01(:, j)
+        for (size_t i=0; i<j; i++)
+        {
+            T value = (diag == Diagonal::NonUnit) ? a[i * lda + i] * a[i * lda + j] : a[i * lda + j];
+            for (size_t p=i+1; p<j; p++)
+            {
+                value += a[i * lda + p] * a[p * lda + j];
+            }
+            a[i * lda + j] = value * scale;
+        }
+    }
+}
+
+/*
+ * Inverse of the n x n upper triangle at a, in place. Block columns are done
+ * left to right: with inv(U00) already in place, U01 becomes
+ * -inv(U00) U01 inv(U11) through a triangular multiplication and a
+ * triangular solve, then U11 is inverted.
+ */
+template <typename T>
+void trtriUpper(Diagonal diag, size_t n, T* a, size_t lda)
+{
+    for (size_t j0=0; j0<n; j0+=TRIANGULAR_BLOCK)
+    {
+        size_t jb = std::min(TRIANGULAR_BLOCK, n - j0);
+        T* column = a + j0;
+        trmmUpperLeft(diag, j0, jb, a, lda, column, lda);
+        trsmRight(Triangle::Upper, Transpose::No, diag, j0, jb, a + j0 * lda + j0, lda, column, lda);
+        parallelFor(0, j0, std::max<size_t>(1, ELEMENTWISE_GRAIN / jb), [=](size_t begin, size_t end)
+        {
+            for (size_t i=begin; i<end; i++)
+            {
+                for (size_t c=0; c<jb; c++)
+                {
+                    column[i * lda + c] = -column[i * lda + c];
+                }
+            }
+        });
+        trtriDiagonal(diag, jb, a + j0 * lda + j0, lda);
+    }
+}
+
+// Swaps A(i, j) and A(j, i) for all i < j of the n x n buffer a.
+template <typename T>
+void transposeSquare(size_t n, T* a, size_t lda)
+{
+    parallelFor(0, n, std::max<size_t>(1, ELEMENTWISE_GRAIN / std::max<size_t>(n, 1)), [=](size_t begin, size_t end)
+    {
+        for (size_t i=begin; i<end; i++)
+        {
+            for (size_t j=i+1; j<n; j++)
+            {
+                std::swap(a[i * lda + j], a[j * lda + i]);
+            }
+        }
+    });
+}
+} // namespace detail
+
+/**
+ * @brief Solves op(A) X = B, or X op(A) = B, in place of B.
+ *
+ * A is a square triangular Matrix object and only its triangle uplo is read.
+ * op(A) is A or its transpose. B can have any number of right-hand sides.
+ * Diagonal blocks are solved in parallel and the rest of the work goes
+ * through the matrix multiplication kernel.
+ *
+ *
+ * @example
+ *
+ * #include "triangular.h"
+ *
+ * linalg::Matrix<double> L{{{2, 0}, {1, 1}}};
+ * linalg::Matrix<double> B{{{2, 4}, {2, 3}}};
+ * linalg::solveTriangularInPlace(L, B, linalg::Triangle::Lower);
+ * // B is [[1 2] [1 1]]
+ *
+ *
+ * @param tri - Square triangular Matrix object A.
+ * @param rhs - Matrix object B, overwritten with X.
+ * @param uplo - Triangle of A which holds the data.
+ * @param side - Left for op(A) X = B, Right for X op(A) = B.
+ * @param trans - Transpose::Yes to use the transpose of A.
+ * @param diag - Diagonal::Unit if the diagonal of A is all ones and not read.
+ */
+template <typename T>
+void solveTriangularInPlace(const Matrix<T>& tri, Matrix<T>& rhs, Triangle uplo, Side side = Side::Left,
+                            Transpose trans = Transpose::No, Diagonal diag = Diagonal::NonUnit)
+{
+    size_t n = tri.rows();
+    size_t inner = (side == Side::Left) ? rhs.rows() : rhs.cols();
+    if (tri.cols() != n || inner != n)
+    {
+        std::cerr << "Triangular solve - Matrix dimension do not match" << std::endl;
+        std::abort();
+    }
+
+    if (side == Side::Left)
+    {
+        detail::trsmLeft(uplo, trans, diag, n, rhs.cols(), tri.data(), n, rhs.data(), rhs.cols());
+    }
+    else
+    {
+        detail::trsmRight(uplo, trans, diag, rhs.rows(), n, tri.data(), n, rhs.data(), rhs.cols());
+    }
+}
+
+/**
+ * @brief Returns the solution X of op(A) X = B, or X op(A) = B.
+ *
+ * See solveTriangularInPlace() for the parameters.
+ */
+template <typename T>
+Matrix<T> solveTriangular(const Matrix<T>& tri, const Matrix<T>& rhs, Triangle uplo, Side side = Side::Left,
+                          Transpose trans = Transpose::No, Diagonal diag = Diagonal::NonUnit)
+{
+    Matrix<T> res{rhs};
+    solveTriangularInPlace(tri, res, uplo, side, trans, diag);
+    return res;
+}
+
+/**
+ * @brief Replaces a triangular Matrix object with its inverse.
+ *
+ * Only the triangle uplo is read and written. The work is blocked, and most
+ * of it goes through the multithreaded matrix multiplication kernel. The
+ * program is aborted if a diagonal element is zero.
+ *
+ *
+ * @example
+ *
+ * #include "triangular.h"
+ *
+ * linalg::Matrix<double> U{{{2, 1}, {0, 4}}};
+ * linalg::invertTriangularInPlace(U, linalg::Triangle::Upper);
+ * // U is [[0.5 -0.125] [0 0.25]]
+ *
+ *
+ * @param mat - Square triangular Matrix object.
+ * @param uplo - Triangle of mat which holds the data.
+ * @param diag - Diagonal::Unit if the diagonal is all ones and not read.
+ */
+template <typename T>
+void invertTriangularInPlace(Matrix<T>& mat, Triangle uplo, Diagonal diag = Diagonal::NonUnit)
+{
+    size_t n = mat.rows();
+    if (mat.cols() != n)
+    {
+        std::cerr << "Triangular inverse - Matrix should be square" << std::endl;
+        std::abort();
+    }
+    if (diag == Diagonal::NonUnit)
+    {
+        for (size_t i=0; i<n; i++)
+        {
+            if (mat(i, i) == T(0))
+            {
+                std::cerr << "Triangular inverse - Matrix is singular" << std::endl;
+                std::abort();
+            }
+        }
+    }
+
+    // The inverse of L is the transpose of the inverse of L^T, which is upper.
+    if (uplo == Triangle::Lower)
+    {
+        detail::transposeSquare(n, mat.data(), n);
+    }
+    detail::trtriUpper(diag, n, mat.data(), n);
+    if (uplo == Triangle::Lower)
+    {
+        detail::transposeSquare(n, mat.data(), n);
+    }
+}
+
+}; // namespace linalg
+
+#endif // MATRIX_TRIANGULAR_H
@@ -0,0 +1,145 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <Matrix/async.h>
+#include <Matrix/parallel.h>
+
+
+// Matrix object whose element (i, j) is (i * cols + j) % 17 - 8.
+static linalg::Matrix<double> testMatrix(size_t rows, size_t cols)
+{
+    linalg::Matrix<double> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            res(i, j) = static_cast<double>((i * cols + j) % 17) - 8.0;
+        }
+    }
+    return res;
+}
+
+TEST_CASE("thread_pool_submit")
+{
+    std::future<int> answer{linalg::ThreadPool::instance().submit([] { return 42; })};
+    CHECK(answer.get() == 42);
+
+    std::vector<std::future<size_t>> squares;
+    for (size_t i=0; i<16; i++)
+    {
+        squares.push_back(linalg::ThreadPool::instance().submit([i] { return i * i; }));
+    }
+    for (size_t i=0; i<16; i++)
+    {
+        CHECK(squares[i].get() == i * i);
+    }
+}
+
+TEST_CASE("save_and_load")
+{
+    const char* path = "test_async_matrix.bin";
+    linalg::Matrix<double> A{testMatrix(37, 53)};
+    REQUIRE(linalg::save(A, path));
+
+    linalg::Matrix<double> B{1, 1};
+    CHECK(linalg::load(path, B));
+    CHECK(B == A);
+
+    // Elements of another size are rejected and leave the Matrix unchanged.
+    linalg::Matrix<float> C{2, 2, 1.0f};
+    CHECK(!linalg::load(path, C));
+    CHECK(C == linalg::Matrix<float>{2, 2, 1.0f});
+    CHECK(!linalg::load("missing_matrix_file.bin", B));
+
+    linalg::Matrix<double> empty{0, 5};
+    REQUIRE(linalg::save(empty, path));
+    CHECK(linalg::load(path, B));
+    CHECK(B.rows() == 0);
+    CHECK(B.cols() == 5);
+    std::remove(path);
+}
+
+TEST_CASE("load_rejects_corrupt_headers")
+{
+    const char* path = "test_async_corrupt.bin";
+    linalg::Matrix<double> A{testMatrix(4, 6)};
+    linalg::Matrix<double> B{1, 1, 7.0};
+
+    // Truncated: the header asks for more elements than the file holds.
+    REQUIRE(linalg::save(A, path));
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        uint64_t rows = 5;
+        file.seekp(8);
+        file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    }
+    CHECK(!linalg::load(path, B));
+
+    // Dimensions whose product overflows.
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        uint64_t huge[2] = {uint64_t(1) << 33, uint64_t(1) << 33};
+        file.seekp(8);
+        file.write(reinterpret_cast<const char*>(huge), sizeof(huge));
+    }
+    CHECK(!linalg::load(path, B));
+    CHECK(B == linalg::Matrix<double>{1, 1, 7.0});
+    std::remove(path);
+}
+
+TEST_CASE("huge_async_operations_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    linalg::Matrix<double> A{testMatrix(400, 300)};
+    linalg::Matrix<double> B{testMatrix(300, 500)};
+    linalg::Matrix<double> expected{A * B};
+
+    // Several products in flight, each using the pool for its own loops.
+    std::vector<std::future<linalg::Matrix<double>>> products;
+    for (size_t i=0; i<4; i++)
+    {
+        products.push_back(linalg::multiplyAsync(A, B));
+    }
+    std::future<linalg::Matrix<double>> transposed{linalg::transposeAsync(A)};
+    for (size_t i=0; i<products.size(); i++)
+    {
+        CHECK(products[i].get() == expected);
+    }
+    CHECK(transposed.get() == A.transpose());
+
+    const char* path = "test_async_huge.bin";
+    REQUIRE(linalg::saveAsync(expected, path).get());
+    linalg::Matrix<double> loaded{1, 1};
+    std::future<bool> pending{linalg::loadAsync(path, loaded)};
+    REQUIRE(pending.get());
+    CHECK(loaded == expected);
+    std::remove(path);
+    linalg::setNumThreads(threads);
+}
@@ -0,0 +1,103 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <doctest/doctest.h>
+#include <Matrix/matrix.h>
+
+
+TEST_SUITE_BEGIN("test_broadcast");
+
+TEST_CASE("row_bias")
+{
+    using namespace linalg;
+    Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};     // (2, 3)
+    Matrix<int> bias{{10, 20, 30}};             // (1, 3)
+    Matrix<int> C{{{11, 22, 33}, {14, 25, 36}}};
+    CHECK(isSame(C, Matrix<int>{A + bias}) == 1);
+    CHECK(isSame(C, Matrix<int>{bias + A}) == 1);
+}
+
+TEST_CASE("column_scale")
+{
+    using namespace linalg;
+    Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};     // (2, 3)
+    Matrix<int> scale{{2, 3, 4}};               // (1, 3)
+    Matrix<int> C{{{2, 6, 12}, {8, 15, 24}}};
+    CHECK(isSame(C, Matrix<int>{hadamard(A, scale)}) == 1);
+}
+
+TEST_CASE("column_vector")
+{
+    using namespace linalg;
+    Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};     // (2, 3)
+    Matrix<int> col{{1, 2}};
+    col = col.transpose();                      // (2, 1)
+    Matrix<int> C{{{0, 1, 2}, {2, 3, 4}}};
+    CHECK(isSame(C, Matrix<int>{A - col}) == 1);
+}
+
+TEST_CASE("outer_sum")
+{
+    using namespace linalg;
+    Matrix<int> row{{1, 2, 3}};                 // (1, 3)
+    Matrix<int> col{{10, 20}};
+    col = col.transpose();                      // (2, 1)
+    Matrix<int> C{{{11, 12, 13}, {21, 22, 23}}};
+    CHECK(isSame(C, Matrix<int>{row + col}) == 1);
+}
+
+TEST_CASE("compound_broadcast")
+{
+    using namespace linalg;
+    Matrix<int> A{3, 4, 1};
+    Matrix<int> bias{{1, 2, 3, 4}};
+    Matrix<int> col{{1, 2, 3}};
+    col = col.transpose();
+    A += bias * 2;
+    CHECK(isSame(A, Matrix<int>{{{3, 5, 7, 9}, {3, 5, 7, 9}, {3, 5, 7, 9}}}) == 1);
+    A -= col;
+    CHECK(isSame(A, Matrix<int>{{{2, 4, 6, 8}, {1, 3, 5, 7}, {0, 2, 4, 6}}}) == 1);
+}
+
+TEST_CASE("assign_grows")
+{
+    using namespace linalg;
+    Matrix<int> A{{1, 2}};                      // (1, 2)
+    Matrix<int> B{3, 2, 1};
+    A = A + B;
+    CHECK(isSame(A, Matrix<int>{{{2, 3}, {2, 3}, {2, 3}}}) == 1);
+}
+
+TEST_CASE("huge_matrix_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{700, 900, 2.0};
+    Matrix<double> bias{1, 900, 0.5};
+    Matrix<double> scale{700, 1, 3.0};
+    Matrix<double> C{700, 900, 7.5};
+    Matrix<double> D{hadamard(A + bias, scale)};
+    setNumThreads(threads);
+    CHECK(isSame(C, D) == 1);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,176 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/cholesky.h>
+
+
+#include <Matrix/lu.h>
+
+#include "test_helpers.h"
+
+
+// Deterministic test data in [-1, 1].
+static linalg::Matrix<double> testMatrix(size_t rows, size_t cols)
+{
+    linalg::Matrix<double> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            res(i, j) = static_cast<double>((i * 37 + j * 91 + 11) % 199) / 99.0 - 1.0;
+        }
+    }
+    return res;
+}
+
+// Symmetric positive-definite matrix G G^T + n I.
+static linalg::Matrix<double> spdMatrix(size_t n)
+{
+    linalg::Matrix<double> G{testMatrix(n, n)};
+    linalg::Matrix<double> res{G * G.transpose()};
+    for (size_t i=0; i<n; i++)
+    {
+        res(i, i) += static_cast<double>(n);
+    }
+    return res;
+}
+
+TEST_SUITE_BEGIN("test_cholesky");
+
+TEST_CASE("small_cholesky")
+{
+    using namespace linalg;
+    Matrix<double> A{{{4, 2}, {2, 5}}};
+    CHECK(choleskyInPlace(A) == true);
+    CHECK(isSame(A, Matrix<double>{{{2, 0}, {1, 2}}}) == 1);
+
+    Matrix<double> B{{{1, 2}, {2, 1}}};
+    CHECK(choleskyInPlace(B) == false);
+}
+
+TEST_CASE("triangular_solve_variants")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> T{testMatrix(150, 150)};
+    for (size_t i=0; i<T.rows(); i++)
+    {
+        T(i, i) += 10;
+    }
+    Matrix<double> lower{T};
+    Matrix<double> upper{T};
+    for (size_t i=0; i<T.rows(); i++)
+    {
+        for (size_t j=0; j<T.cols(); j++)
+        {
+            if (j > i)
+            {
+                lower(i, j) = 0;
+            }
+            if (j < i)
+            {
+                upper(i, j) = 0;
+            }
+        }
+    }
+    Matrix<double> tall{testMatrix(150, 20)};
+    Matrix<double> wide{testMatrix(30, 150)};
+
+    const Triangle uplos[] = {Triangle::Lower, Triangle::Upper};
+    const Transpose transposes[] = {Transpose::No, Transpose::Yes};
+    for (Triangle uplo : uplos)
+    {
+        for (Transpose trans : transposes)
+        {
+            // Only the triangle uplo of T is read, the rest holds other data.
+            const Matrix<double>& exact = (uplo == Triangle::Lower) ? lower : upper;
+            Matrix<double> op{(trans == Transpose::Yes) ? exact.transpose() : exact};
+
+            Matrix<double> X{solveTriangular(T, tall, uplo, Side::Left, trans)};
+            CHECK(maxDifference(op * X, tall) < 1e-10);
+
+            Matrix<double> Y{solveTriangular(T, wide, uplo, Side::Right, trans)};
+            CHECK(maxDifference(Y * op, wide) < 1e-10);
+        }
+    }
+    setNumThreads(threads);
+}
+
+TEST_CASE("unit_diagonal")
+{
+    using namespace linalg;
+    Matrix<double> L{{{5, 0}, {3, 7}}};
+    Matrix<double> B{{{1, 2}, {4, 8}}};
+    solveTriangularInPlace(L, B, Triangle::Lower, Side::Left, Transpose::No, Diagonal::Unit);
+    CHECK(isSame(B, Matrix<double>{{{1, 2}, {1, 2}}}) == 1);
+}
+
+TEST_CASE("syrk_lower")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{testMatrix(300, 45)};
+    Matrix<double> C{300, 300, -1.0};
+    detail::syrkLower(size_t(300), size_t(45), 2.0, A.data(), size_t(45), 1.0, C.data(), size_t(300));
+    setNumThreads(threads);
+
+    Matrix<double> expected{A * A.transpose()};
+    double worst = 0;
+    for (size_t i=0; i<C.rows(); i++)
+    {
+        for (size_t j=0; j<C.cols(); j++)
+        {
+            double value = (j <= i) ? 2 * expected(i, j) - 1 : -1;
+            worst = std::max(worst, std::abs(C(i, j) - value));
+        }
+    }
+    CHECK(worst < 1e-10);
+}
+
+TEST_CASE("huge_cholesky_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{spdMatrix(333)};
+    Matrix<double> B{testMatrix(333, 5)};
+    CholeskyDecomposition<double> chol{A};
+    CHECK(chol.isPositiveDefinite() == true);
+
+    const Matrix<double>& L = chol.factor();
+    CHECK(maxDifference(L * L.transpose(), A) < 1e-8);
+    CHECK(L(0, 1) == 0);
+
+    Matrix<double> X{chol.solve(B)};
+    CHECK(maxDifference(A * X, B) < 1e-10);
+    setNumThreads(threads);
+
+    Matrix<double> small{spdMatrix(40)};
+    double logDet = CholeskyDecomposition<double>{small}.logDeterminant();
+    CHECK(logDet == doctest::Approx(std::log(determinant(small))));
+}
+
+TEST_SUITE_END();
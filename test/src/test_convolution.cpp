@@ -0,0 +1,122 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/convolution.h>
+#include <Matrix/parallel.h>
+
+#include "test_helpers.h"
+
+
+// Convolution straight from the definition.
+static linalg::Matrix<double> directConvolution(const linalg::Matrix<double>& input, size_t height, size_t width,
+                                                const linalg::Matrix<double>& filters, size_t kh, size_t kw,
+                                                size_t stride, size_t padding)
+{
+    size_t channels = input.cols();
+    size_t batch = input.rows() / (height * width);
+    size_t oh = (height + 2 * padding - kh) / stride + 1;
+    size_t ow = (width + 2 * padding - kw) / stride + 1;
+    linalg::Matrix<double> res{batch * oh * ow, filters.rows(), 0.0};
+    for (size_t n=0; n<batch; n++)
+    {
+        for (size_t y=0; y<oh; y++)
+        {
+            for (size_t x=0; x<ow; x++)
+            {
+                for (size_t o=0; o<filters.rows(); o++)
+                {
+                    double sum = 0;
+                    for (size_t ky=0; ky<kh; ky++)
+                    {
+                        for (size_t kx=0; kx<kw; kx++)
+                        {
+                            long iy = static_cast<long>(y * stride + ky) - static_cast<long>(padding);
+                            long ix = static_cast<long>(x * stride + kx) - static_cast<long>(padding);
+                            if (iy < 0 || ix < 0 || iy >= static_cast<long>(height) || ix >= static_cast<long>(width))
+                            {
+                                continue;
+                            }
+                            for (size_t c=0; c<channels; c++)
+                            {
+                                sum += filters(o, (ky * kw + kx) * channels + c) *
+                                       input((n * height + iy) * width + ix, c);
+                            }
+                        }
+                    }
+                    res((n * oh + y) * ow + x, o) = sum;
+                }
+            }
+        }
+    }
+    return res;
+}
+
+TEST_CASE("conv2d_small")
+{
+    // One channel, 3 x 3 image, 2 x 2 box filter.
+    linalg::Matrix<double> image{linalg::Matrix<double>{{1, 2, 3, 4, 5, 6, 7, 8, 9}}.transpose()};
+    linalg::Matrix<double> box{{1, 1, 1, 1}};
+    linalg::Matrix<double> expected{linalg::Matrix<double>{{12, 16, 24, 28}}.transpose()};
+    CHECK(linalg::conv2d(image, 3, 3, box, 2, 2) == expected);
+}
+
+TEST_CASE("conv2d_matches_definition")
+{
+    // height, width, channels, filters, kh, kw, stride, padding
+    size_t cases[][8] = {{9, 11, 3, 5, 3, 3, 1, 0}, {9, 11, 3, 5, 3, 3, 1, 1}, {12, 10, 4, 7, 5, 3, 2, 2},
+                         {7, 7, 2, 3, 1, 1, 1, 0}, {16, 16, 8, 12, 3, 3, 2, 1}};
+    for (auto& c : cases)
+    {
+        linalg::Matrix<double> input{seededMatrix(2 * c[0] * c[1], c[2], 1)};
+        linalg::Matrix<double> filters{seededMatrix(c[3], c[4] * c[5] * c[2], 2)};
+        linalg::Matrix<double> expected{directConvolution(input, c[0], c[1], filters, c[4], c[5], c[6], c[7])};
+        CHECK(maxDifference(linalg::conv2d(input, c[0], c[1], filters, c[4], c[5], c[6], c[7]), expected) < 1e-10);
+    }
+}
+
+TEST_CASE("conv2d_winograd")
+{
+    // Odd and even output sizes, with and without padding.
+    size_t cases[][5] = {{8, 8, 3, 4, 0}, {9, 7, 3, 4, 1}, {5, 6, 16, 10, 1}, {3, 3, 2, 2, 0}};
+    for (auto& c : cases)
+    {
+        linalg::Matrix<double> input{seededMatrix(3 * c[0] * c[1], c[2], 3)};
+        linalg::Matrix<double> filters{seededMatrix(c[3], 9 * c[2], 4)};
+        linalg::Matrix<double> expected{directConvolution(input, c[0], c[1], filters, 3, 3, 1, c[4])};
+        CHECK(maxDifference(linalg::conv2dWinograd(input, c[0], c[1], filters, c[4]), expected) < 1e-10);
+    }
+}
+
+TEST_CASE("huge_conv2d_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    linalg::Matrix<double> input{seededMatrix(2 * 40 * 40, 32, 5)};
+    linalg::Matrix<double> filters{seededMatrix(48, 9 * 32, 6)};
+    linalg::Matrix<double> expected{directConvolution(input, 40, 40, filters, 3, 3, 1, 1)};
+    CHECK(maxDifference(linalg::conv2d(input, 40, 40, filters, 3, 3, 1, 1), expected) < 1e-9);
+    CHECK(maxDifference(linalg::conv2dWinograd(input, 40, 40, filters, 1), expected) < 1e-9);
+    linalg::setNumThreads(threads);
+}
@@ -0,0 +1,147 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <Matrix/dataflow.h>
+#include <Matrix/parallel.h>
+
+#include "test_helpers.h"
+
+
+static double relu(double x)
+{
+    return x > 0 ? x : 0;
+}
+
+// The chain computed one whole product after the other.
+static linalg::Matrix<double> sequentialChain(const linalg::Matrix<double>& input,
+                                              const std::vector<linalg::Matrix<double>>& weights)
+{
+    linalg::Matrix<double> res{input};
+    for (size_t l=0; l<weights.size(); l++)
+    {
+        res = linalg::Matrix<double>{res * weights[l]};
+        if (l + 1 < weights.size())
+        {
+            for (size_t i=0; i<res.rows(); i++)
+            {
+                for (size_t j=0; j<res.cols(); j++)
+                {
+                    res(i, j) = relu(res(i, j));
+                }
+            }
+        }
+    }
+    return res;
+}
+
+TEST_CASE("dataflow_order_and_priority")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(1);
+    std::vector<int> order;
+    linalg::Dataflow flow;
+    auto a = flow.add([&] { order.push_back(0); });
+    auto b = flow.add([&] { order.push_back(1); }, {a});
+    flow.add([&] { order.push_back(2); }, {a});
+    flow.add([&] { order.push_back(3); }, {a}, 5);
+    flow.add([&] { order.push_back(4); }, {b});
+    flow.run();
+    // With one thread, ready tasks run by priority, then in the order they were added.
+    CHECK(order == std::vector<int>{0, 3, 1, 2, 4});
+    CHECK(flow.size() == 5);
+
+    order.clear();
+    flow.run();
+    CHECK(order.size() == 5);
+    linalg::setNumThreads(threads);
+}
+
+TEST_CASE("dataflow_dependencies_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    // A grid where task (i, j) waits for (i - 1, j) and (i, j - 1), and checks
+    // they are done.
+    const size_t SIZE = 20;
+    std::vector<std::atomic<int>> done(SIZE * SIZE);
+    for (auto& flag : done)
+    {
+        flag = 0;
+    }
+    std::atomic<bool> ordered{true};
+    linalg::Dataflow flow;
+    std::vector<linalg::Dataflow::Task> tasks(SIZE * SIZE);
+    for (size_t i=0; i<SIZE; i++)
+    {
+        for (size_t j=0; j<SIZE; j++)
+        {
+            std::vector<linalg::Dataflow::Task> after;
+            if (i > 0)
+            {
+                after.push_back(tasks[(i - 1) * SIZE + j]);
+            }
+            if (j > 0)
+            {
+                after.push_back(tasks[i * SIZE + j - 1]);
+            }
+            tasks[i * SIZE + j] = flow.add([&done, &ordered, i, j, SIZE]()
+            {
+                if ((i > 0 && !done[(i - 1) * SIZE + j]) || (j > 0 && !done[i * SIZE + j - 1]))
+                {
+                    ordered = false;
+                }
+                done[i * SIZE + j] = 1;
+            }, after);
+        }
+    }
+    flow.run();
+    CHECK(ordered);
+    CHECK(done[SIZE * SIZE - 1] == 1);
+    linalg::setNumThreads(threads);
+}
+
+TEST_CASE("multiply_chain")
+{
+    std::vector<linalg::Matrix<double>> weights{seededMatrix(30, 20, 1), seededMatrix(20, 40, 2), seededMatrix(40, 5, 3)};
+    linalg::Matrix<double> X{seededMatrix(50, 30, 4)};
+    CHECK(maxDifference(linalg::multiplyChain(X, weights, relu), sequentialChain(X, weights)) < 1e-10);
+
+    std::vector<linalg::Matrix<double>> none;
+    CHECK(linalg::multiplyChain(X, none, relu) == X);
+}
+
+TEST_CASE("huge_multiply_chain_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    // Rows that are not a multiple of the tile height.
+    std::vector<linalg::Matrix<double>> weights{seededMatrix(300, 256, 1), seededMatrix(256, 256, 2),
+                                                seededMatrix(256, 128, 3), seededMatrix(128, 10, 4)};
+    linalg::Matrix<double> X{seededMatrix(2000, 300, 5)};
+    CHECK(maxDifference(linalg::multiplyChain(X, weights, relu), sequentialChain(X, weights)) < 1e-8);
+    linalg::setNumThreads(threads);
+}
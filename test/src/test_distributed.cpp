@@ -0,0 +1,262 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <Matrix/distributed.h>
+
+#include "test_helpers.h"
+
+
+TEST_SUITE_BEGIN("test_distributed");
+
+// The processes return a nonzero status on failure, which makes
+// runProcesses() return false.
+TEST_CASE("messages_by_tag")
+{
+    bool ok = linalg::runProcesses(3, [](linalg::Transport& transport)
+    {
+        size_t next = (transport.rank() + 1) % transport.size();
+        size_t prev = (transport.rank() + transport.size() - 1) % transport.size();
+        int first = static_cast<int>(transport.rank());
+        int second = first + 100;
+        transport.send(next, 1, &first, sizeof(first));
+        transport.send(next, 2, &second, sizeof(second));
+
+        // Received in the other order than sent.
+        int got[2];
+        transport.recv(prev, 2, &got[1], sizeof(int));
+        transport.recv(prev, 1, &got[0], sizeof(int));
+        int bad = (got[0] != static_cast<int>(prev)) + (got[1] != static_cast<int>(prev) + 100);
+
+        // A large message, to and from itself as well.
+        std::vector<char> big(1 << 20, static_cast<char>(transport.rank()));
+        std::vector<char> back(big.size());
+        transport.send(next, 3, big.data(), big.size());
+        transport.recv(prev, 3, back.data(), back.size());
+        bad += back[12345] != static_cast<char>(prev);
+        transport.send(transport.rank(), 4, big.data(), big.size());
+        transport.recv(transport.rank(), 4, back.data(), back.size());
+        bad += back != big;
+        bad += transport.bytesSent() != 2 * sizeof(int) + big.size();
+        return bad;
+    });
+    CHECK(ok == true);
+
+    CHECK(linalg::runProcesses(2, [](linalg::Transport& transport) { return static_cast<int>(transport.rank()); }) == false);
+}
+
+TEST_CASE("broadcast")
+{
+    bool ok = linalg::runProcesses(7, [](linalg::Transport& transport)
+    {
+        int bad = 0;
+        std::vector<size_t> everyone{0, 1, 2, 3, 4, 5, 6};
+        for (size_t root=0; root<everyone.size(); root++)
+        {
+            double value = (transport.rank() == root) ? 1.5 * root : -1.0;
+            linalg::broadcast(transport, everyone, root, &value, sizeof(value), 5);
+            bad += value != 1.5 * root;
+        }
+
+        // A group in another order, without ranks 0 and 4.
+        std::vector<size_t> group{6, 2, 5, 1, 3};
+        if (std::find(group.begin(), group.end(), transport.rank()) != group.end())
+        {
+            int value = (transport.rank() == 5) ? 42 : 0;
+            linalg::broadcast(transport, group, 2, &value, sizeof(value), 6);
+            bad += value != 42;
+        }
+        linalg::barrier(transport);
+        return bad;
+    });
+    CHECK(ok == true);
+}
+
+TEST_CASE("reduce_sum")
+{
+    bool ok = linalg::runProcesses(6, [](linalg::Transport& transport)
+    {
+        int bad = 0;
+        std::vector<size_t> everyone{0, 1, 2, 3, 4, 5};
+        for (size_t root=0; root<everyone.size(); root++)
+        {
+            double values[2] = {1.0 + transport.rank(), -2.0};
+            linalg::reduceSum(transport, everyone, root, values, 2, 7);
+            bad += transport.rank() == root && (values[0] != 21.0 || values[1] != -12.0);
+        }
+
+        std::vector<size_t> group{4, 1, 3};
+        if (std::find(group.begin(), group.end(), transport.rank()) != group.end())
+        {
+            int value = static_cast<int>(transport.rank());
+            linalg::reduceSum(transport, group, 1, &value, 1, 8);
+            bad += transport.rank() == 1 && value != 8;
+        }
+        return bad;
+    });
+    CHECK(ok == true);
+}
+
+TEST_CASE("scatter_gather")
+{
+    linalg::Matrix<double> A{seededMatrix(23, 17, 1)};
+    bool ok = linalg::runProcesses(4, [&](linalg::Transport& transport)
+    {
+        linalg::Matrix<double> input{transport.rank() == 2 ? A : linalg::Matrix<double>(0, 0)};
+        linalg::DistributedMatrix<double> dist{linalg::scatter(transport, linalg::ProcessGrid{3, 1}, input, 2)};
+        int bad = dist.rows() != 23 || dist.cols() != 17;
+        if (dist.inGrid())
+        {
+            bad += dist.local().rows() != dist.rowBegin(dist.gridRow() + 1) - dist.rowBegin(dist.gridRow());
+            bad += dist.local()(0, 0) != A(dist.rowBegin(dist.gridRow()), 0);
+        }
+        else
+        {
+            bad += dist.local().rows() != 0;
+        }
+        linalg::Matrix<double> back{dist.gather(3)};
+        bad += transport.rank() == 3 && !isSame(back, A);
+        return bad;
+    });
+    CHECK(ok == true);
+}
+
+TEST_CASE("summa")
+{
+    linalg::Matrix<double> A{seededMatrix(97, 611, 2)};
+    linalg::Matrix<double> B{seededMatrix(611, 53, 3)};
+    linalg::Matrix<double> C{A * B};
+    for (size_t shape : {11, 22, 23, 32, 13})
+    {
+        size_t processes = (shape == 13) ? 4 : (shape / 10) * (shape % 10);
+        linalg::ProcessGrid grid{shape / 10, shape % 10};
+        bool ok = linalg::runProcesses(processes, [&](linalg::Transport& transport)
+        {
+            linalg::DistributedMatrix<double> a{linalg::scatter(transport, grid, A, 0)};
+            linalg::DistributedMatrix<double> b{linalg::scatter(transport, grid, B, 0)};
+            linalg::Matrix<double> res{linalg::summa(a, b).gather(0)};
+            return (transport.rank() == 0 && maxDifference(res, C) > 1e-10) ? 1 : 0;
+        });
+        CHECK(ok == true);
+    }
+}
+
+TEST_CASE("summa_thin_blocks")
+{
+    // More processes than rows or columns leaves some blocks empty.
+    linalg::Matrix<double> A{seededMatrix(2, 5, 4)};
+    linalg::Matrix<double> B{seededMatrix(5, 3, 5)};
+    linalg::Matrix<double> C{A * B};
+    bool ok = linalg::runProcesses(9, [&](linalg::Transport& transport)
+    {
+        linalg::ProcessGrid grid{3, 3};
+        linalg::DistributedMatrix<double> a{linalg::scatter(transport, grid, A, 0)};
+        linalg::DistributedMatrix<double> b{linalg::scatter(transport, grid, B, 0)};
+        linalg::Matrix<double> res{linalg::summa(a, b).gather(0)};
+        return (transport.rank() == 0 && maxDifference(res, C) > 1e-12) ? 1 : 0;
+    });
+    CHECK(ok == true);
+}
+
+TEST_CASE("cannon")
+{
+    linalg::Matrix<double> A{seededMatrix(101, 67, 6)};
+    linalg::Matrix<double> B{seededMatrix(67, 89, 7)};
+    linalg::Matrix<double> C{A * B};
+    for (size_t q : {1, 2, 3})
+    {
+        // One process more than the grid, which takes no part.
+        bool ok = linalg::runProcesses(q * q + 1, [&](linalg::Transport& transport)
+        {
+            linalg::ProcessGrid grid{q, q};
+            linalg::DistributedMatrix<double> a{linalg::scatter(transport, grid, A, 0)};
+            linalg::DistributedMatrix<double> b{linalg::scatter(transport, grid, B, 0)};
+            linalg::Matrix<double> res{linalg::cannon(a, b).gather(0)};
+            return (transport.rank() == 0 && maxDifference(res, C) > 1e-12) ? 1 : 0;
+        });
+        CHECK(ok == true);
+    }
+}
+
+TEST_CASE("multiply_25d")
+{
+    linalg::Matrix<double> A{seededMatrix(61, 77, 8)};
+    linalg::Matrix<double> B{seededMatrix(77, 45, 9)};
+    linalg::Matrix<double> C{A * B};
+    for (size_t shape : {21, 22, 32, 33})
+    {
+        size_t q = shape / 10;
+        size_t layers = shape % 10;
+        bool ok = linalg::runProcesses(q * q * layers, [&](linalg::Transport& transport)
+        {
+            linalg::ProcessGrid grid{q, q};
+            linalg::DistributedMatrix<double> a{linalg::scatter(transport, grid, A, 0)};
+            linalg::DistributedMatrix<double> b{linalg::scatter(transport, grid, B, 0)};
+            linalg::DistributedMatrix<double> c{linalg::multiply25D(a, b, layers)};
+            int bad = c.inGrid() != (transport.rank() < q * q);
+            linalg::Matrix<double> res{c.gather(0)};
+            return bad + ((transport.rank() == 0 && maxDifference(res, C) > 1e-12) ? 1 : 0);
+        });
+        CHECK(ok == true);
+    }
+}
+
+TEST_CASE("transpose")
+{
+    for (size_t shape : {11, 23, 32, 44})
+    {
+        linalg::Matrix<double> A{seededMatrix(29 + shape, 41, shape)};
+        linalg::ProcessGrid grid{shape / 10, shape % 10};
+        bool ok = linalg::runProcesses(grid.size() + 1, [&](linalg::Transport& transport)
+        {
+            linalg::DistributedMatrix<double> a{linalg::scatter(transport, grid, A, 0)};
+            linalg::DistributedMatrix<double> t{a.transpose()};
+            linalg::DistributedMatrix<double> back{t.transpose()};
+            int bad = t.rows() != A.cols() || t.cols() != A.rows();
+            if (t.inGrid())
+            {
+                bad += t.local().rows() != t.rowBegin(t.gridRow() + 1) - t.rowBegin(t.gridRow());
+            }
+            linalg::Matrix<double> res{t.gather(0)};
+            linalg::Matrix<double> twice{back.gather(0)};
+            return bad + (transport.rank() == 0 && (!isSame(res, A.transpose()) || !isSame(twice, A)));
+        });
+        CHECK(ok == true);
+    }
+
+    // More processes than rows.
+    linalg::Matrix<double> row{seededMatrix(1, 10, 3)};
+    bool ok = linalg::runProcesses(4, [&](linalg::Transport& transport)
+    {
+        linalg::DistributedMatrix<double> a{linalg::scatter(transport, linalg::ProcessGrid{2, 2}, row, 0)};
+        linalg::Matrix<double> res{a.transpose().gather(0)};
+        return (transport.rank() == 0 && !isSame(res, row.transpose())) ? 1 : 0;
+    });
+    CHECK(ok == true);
+}
+
+TEST_SUITE_END();
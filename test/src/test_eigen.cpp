@@ -0,0 +1,218 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/eigen.h>
+
+
+// Deterministic test data in [-1, 1].
+static linalg::Matrix<double> testMatrix(size_t rows, size_t cols)
+{
+    linalg::Matrix<double> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            size_t hash = (i * 73856093) ^ (j * 19349663);
+            res(i, j) = static_cast<double>(hash % 2001) / 1000.0 - 1.0;
+        }
+    }
+    return res;
+}
+
+// Largest |A v - lambda v| over the eigenpairs.
+template <typename Operator>
+static double worstResidual(const Operator& op, const linalg::Eigenpairs<double>& eig)
+{
+    using namespace linalg;
+    Matrix<double> image{eig.vectors.rows(), eig.vectors.cols()};
+    op(eig.vectors, image);
+    double worst = 0;
+    for (size_t j=0; j<eig.vectors.cols(); j++)
+    {
+        double squares = 0;
+        for (size_t i=0; i<eig.vectors.rows(); i++)
+        {
+            double r = image(i, j) - eig.values(j, 0) * eig.vectors(i, j);
+            squares += r * r;
+        }
+        worst = std::max(worst, std::sqrt(squares));
+    }
+    return worst;
+}
+
+TEST_SUITE_BEGIN("test_eigen");
+
+TEST_CASE("matrix_vector_product")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{testMatrix(700, 300)};
+    Matrix<double> x{testMatrix(300, 1)};
+    Matrix<double> y{A * x};
+    Matrix<double> z{A.transpose() * y};
+    setNumThreads(threads);
+
+    double worst = 0;
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        double expected = 0;
+        for (size_t j=0; j<A.cols(); j++)
+        {
+            expected += A(i, j) * x(j, 0);
+        }
+        worst = std::max(worst, std::abs(y(i, 0) - expected));
+    }
+    for (size_t j=0; j<A.cols(); j+=7)
+    {
+        double expected = 0;
+        for (size_t i=0; i<A.rows(); i++)
+        {
+            expected += A(i, j) * y(i, 0);
+        }
+        worst = std::max(worst, std::abs(z(j, 0) - expected) / std::abs(expected));
+    }
+    CHECK(worst < 1e-10);
+}
+
+TEST_CASE("small_symmetric_eigen")
+{
+    using namespace linalg;
+    Matrix<double> A{{{2, 1}, {1, 2}}};
+    Eigenpairs<double> eig{symmetricEigen(A)};
+    CHECK(eig.values(0, 0) == doctest::Approx(3));
+    CHECK(eig.values(1, 0) == doctest::Approx(1));
+    CHECK(std::abs(eig.vectors(0, 0)) == doctest::Approx(std::sqrt(0.5)));
+    CHECK(eig.vectors(0, 0) * eig.vectors(1, 0) > 0);
+
+    Matrix<double> G{testMatrix(60, 60)};
+    Matrix<double> S{G + G.transpose()};
+    Eigenpairs<double> all{symmetricEigen(S)};
+    CHECK(worstResidual(detail::DenseOperator<double>{S}, all) < 1e-10);
+    Matrix<double> rebuilt{all.vectors * Matrix<double>{hadamard(all.vectors.transpose(), all.values)}};
+    double worst = 0;
+    for (size_t i=0; i<60; i++)
+    {
+        for (size_t j=0; j<60; j++)
+        {
+            worst = std::max(worst, std::abs(rebuilt(i, j) - S(i, j)));
+        }
+    }
+    CHECK(worst < 1e-10);
+}
+
+TEST_CASE("dense_dominant_eigenpairs")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> G{testMatrix(150, 150)};
+    Matrix<double> S{G * G.transpose()};
+    Eigenpairs<double> exact{symmetricEigen(S)};
+    Eigenpairs<double> krylov{lanczos(S, 4)};
+    Eigenpairs<double> power{powerIteration(S, 4, 1e-9)};
+    setNumThreads(threads);
+
+    CHECK(krylov.converged == true);
+    CHECK(power.converged == true);
+    for (size_t j=0; j<4; j++)
+    {
+        CHECK(krylov.values(j, 0) == doctest::Approx(exact.values(j, 0)).epsilon(1e-10));
+        CHECK(power.values(j, 0) == doctest::Approx(exact.values(j, 0)).epsilon(1e-10));
+    }
+    CHECK(worstResidual(detail::DenseOperator<double>{S}, krylov) < 1e-7);
+    CHECK(worstResidual(detail::DenseOperator<double>{S}, power) < 1e-6);
+}
+
+TEST_CASE("matrix_free_operator")
+{
+    using namespace linalg;
+    // Diagonal operator with five well separated eigenvalues at the top,
+    // and a negative one of largest magnitude.
+    size_t n = 5000;
+    std::vector<double> diagonal(n);
+    for (size_t i=0; i<n; i++)
+    {
+        diagonal[i] = 1.0 + static_cast<double>(i % 97) / 97.0;
+    }
+    diagonal[10] = -12;
+    diagonal[200] = 10;
+    diagonal[3000] = 8;
+    diagonal[4999] = 6;
+    auto op = [&diagonal](const Matrix<double>& x, Matrix<double>& y)
+    {
+        for (size_t i=0; i<x.rows(); i++)
+        {
+            for (size_t j=0; j<x.cols(); j++)
+            {
+                y(i, j) = diagonal[i] * x(i, j);
+            }
+        }
+    };
+
+    Eigenpairs<double> krylov{lanczos<double>(op, n, 4)};
+    Eigenpairs<double> power{powerIteration<double>(op, n, 3, 1e-8)};
+    const double expected[] = {-12, 10, 8, 6};
+    for (size_t j=0; j<4; j++)
+    {
+        CHECK(krylov.values(j, 0) == doctest::Approx(expected[j]));
+    }
+    for (size_t j=0; j<3; j++)
+    {
+        CHECK(power.values(j, 0) == doctest::Approx(expected[j]));
+    }
+    CHECK(std::abs(krylov.vectors(200, 1)) == doctest::Approx(1));
+    CHECK(worstResidual(op, krylov) < 1e-8);
+}
+
+TEST_CASE("single_precision_default_tolerance")
+{
+    using namespace linalg;
+    // Symmetric tridiagonal matrix with eigenvalues close to 1, ..., 64.
+    size_t n = 64;
+    Matrix<float> F(n, n);
+    for (size_t i=0; i<n; i++)
+    {
+        F(i, i) = static_cast<float>(i + 1);
+        if (i + 1 < n)
+        {
+            F(i, i + 1) = 0.1f;
+            F(i + 1, i) = 0.1f;
+        }
+    }
+    Eigenpairs<float> power{powerIteration(F, 3)};
+    Eigenpairs<float> krylov{lanczos(F, 3)};
+
+    CHECK(power.converged == true);
+    CHECK(power.iterations < POWER_ITERATIONS);
+    CHECK(krylov.converged == true);
+    CHECK(krylov.iterations < n);
+    for (size_t j=0; j<3; j++)
+    {
+        CHECK(power.values(j, 0) == doctest::Approx(64.0 - j).epsilon(1e-3));
+        CHECK(krylov.values(j, 0) == doctest::Approx(64.0 - j).epsilon(1e-3));
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,105 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <doctest/doctest.h>
+#include <Matrix/matrix.h>
+
+
+TEST_SUITE_BEGIN("test_elementwise");
+
+TEST_CASE("add_subtract")
+{
+    using namespace linalg;
+    Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};
+    Matrix<int> B{{{6, 5, 4}, {3, 2, 1}}};
+    Matrix<int> C{2, 3, 7};
+    Matrix<int> D{{{-5, -3, -1}, {1, 3, 5}}};
+    CHECK(isSame(C, Matrix<int>{A + B}) == 1);
+    CHECK(isSame(D, Matrix<int>{A - B}) == 1);
+}
+
+TEST_CASE("scalar_hadamard")
+{
+    using namespace linalg;
+    Matrix<int> A{{{1, 2}, {3, 4}}};
+    Matrix<int> B{{{5, 6}, {7, 8}}};
+    Matrix<int> C{{{3, 6}, {9, 12}}};
+    Matrix<int> D{{{5, 12}, {21, 32}}};
+    CHECK(isSame(C, Matrix<int>{A * 3}) == 1);
+    CHECK(isSame(C, Matrix<int>{3 * A}) == 1);
+    CHECK(isSame(D, Matrix<int>{hadamard(A, B)}) == 1);
+}
+
+TEST_CASE("fused_expression")
+{
+    using namespace linalg;
+    Matrix<double> A{4, 5, 1.5};
+    Matrix<double> B{4, 5, 2.0};
+    Matrix<double> C{4, 5, 0.5};
+    Matrix<double> D{4, 5, 8.0};
+    Matrix<double> E{A * 2.0 + hadamard(B, B) - C * 2.0 + B};
+    CHECK(isSame(D, E) == 1);
+}
+
+TEST_CASE("compound_assignment")
+{
+    using namespace linalg;
+    Matrix<int> A{3, 3, 1};
+    Matrix<int> B{3, 3, 2};
+    A += B;
+    CHECK(isSame(A, Matrix<int>{3, 3, 3}) == 1);
+    A -= B * 3;
+    CHECK(isSame(A, Matrix<int>{3, 3, -3}) == 1);
+    A *= -4;
+    CHECK(isSame(A, Matrix<int>{3, 3, 12}) == 1);
+}
+
+TEST_CASE("self_assignment")
+{
+    using namespace linalg;
+    Matrix<int> A{{{1, 2}, {3, 4}}};
+    A = A + A * 2;
+    CHECK(isSame(A, Matrix<int>{{{3, 6}, {9, 12}}}) == 1);
+}
+
+TEST_CASE("expression_product")
+{
+    using namespace linalg;
+    Matrix<int> A{5, 5, 1};
+    Matrix<int> B{5, 5, 2};
+    Matrix<int> C{5, 5, 15};
+    CHECK(isSame(C, (A + B) * A) == 1);
+}
+
+TEST_CASE("huge_matrix_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<int> A{1000, 1003, 9};
+    Matrix<int> B{1000, 1003, 7};
+    Matrix<int> C{1000, 1003, 11};
+    Matrix<int> D{A * 2 + hadamard(B, A) - B * 10};
+    setNumThreads(threads);
+    CHECK(isSame(C, D) == 1);
+}
+
+TEST_SUITE_END();
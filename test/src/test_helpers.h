@@ -0,0 +1,65 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MATRIX_TEST_HELPERS_H
+#define MATRIX_TEST_HELPERS_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <Matrix/matrix.h>
+
+
+// Deterministic test data in [-1, 1]. Different seeds give unrelated matrices.
+inline linalg::Matrix<double> seededMatrix(size_t rows, size_t cols, size_t seed)
+{
+    linalg::Matrix<double> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            size_t hash = (i * 73856093) ^ (j * 19349663) ^ (seed * 83492791);
+            res(i, j) = static_cast<double>(hash % 2001) / 1000.0 - 1.0;
+        }
+    }
+    return res;
+}
+
+// Largest absolute difference between the elements of two Matrix objects,
+// or a huge value when their dimensions differ.
+inline double maxDifference(const linalg::Matrix<double>& lhs, const linalg::Matrix<double>& rhs)
+{
+    if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+    {
+        return 1e300;
+    }
+    double worst = 0;
+    for (size_t i=0; i<lhs.rows(); i++)
+    {
+        for (size_t j=0; j<lhs.cols(); j++)
+        {
+            worst = std::max(worst, std::abs(lhs(i, j) - rhs(i, j)));
+        }
+    }
+    return worst;
+}
+
+#endif // MATRIX_TEST_HELPERS_H
@@ -0,0 +1,132 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cmath>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <Matrix/indexing.h>
+#include <Matrix/parallel.h>
+
+
+// Matrix object whose element (i, j) is i * cols + j.
+static linalg::Matrix<double> counting(size_t rows, size_t cols)
+{
+    linalg::Matrix<double> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            res(i, j) = static_cast<double>(i * cols + j);
+        }
+    }
+    return res;
+}
+
+// Deterministic permutation of 0 .. n - 1.
+static std::vector<size_t> shuffled(size_t n, size_t step)
+{
+    std::vector<size_t> res(n);
+    for (size_t i=0; i<n; i++)
+    {
+        res[i] = (i * step + 3) % n;
+    }
+    return res;
+}
+
+TEST_CASE("take_and_scatter_small")
+{
+    linalg::Matrix<int> A{{{1, 2, 3}, {4, 5, 6}, {7, 8, 9}}};
+    CHECK(linalg::takeRows(A, {2, 0, 2}) == linalg::Matrix<int>{{{7, 8, 9}, {1, 2, 3}, {7, 8, 9}}});
+    CHECK(linalg::takeCols(A, {2, 0}) == linalg::Matrix<int>{{{3, 1}, {6, 4}, {9, 7}}});
+    CHECK(linalg::takeRows(A, {}).rows() == 0);
+
+    linalg::Matrix<int> B{4, 3, 0};
+    linalg::scatterRows(linalg::Matrix<int>{{{1, 2, 3}, {4, 5, 6}}}, {3, 1}, B);
+    CHECK(B == linalg::Matrix<int>{{{0, 0, 0}, {4, 5, 6}, {0, 0, 0}, {1, 2, 3}}});
+}
+
+TEST_CASE("permutations")
+{
+    linalg::Matrix<int> A{{{1, 1}, {2, 2}, {3, 3}}};
+    linalg::permuteRowsInPlace(A, {1, 2, 0});
+    CHECK(A == linalg::Matrix<int>{{{2, 2}, {3, 3}, {1, 1}}});
+
+    // 1003 and 7 are coprime, so this is one long cycle.
+    std::vector<size_t> perm{shuffled(1003, 7)};
+    linalg::Matrix<double> M{counting(1003, 5)};
+    linalg::Matrix<double> permuted{M};
+    linalg::permuteRowsInPlace(permuted, perm);
+    CHECK(permuted == linalg::takeRows(M, perm));
+    CHECK(linalg::takeRows(permuted, linalg::inversePermutation(perm)) == M);
+
+    // Several cycles and fixed points.
+    std::vector<size_t> swaps{1, 0, 2, 5, 3, 4};
+    linalg::Matrix<double> S{counting(6, 2)};
+    linalg::Matrix<double> expected{linalg::takeRows(S, swaps)};
+    linalg::permuteRowsInPlace(S, swaps);
+    CHECK(S == expected);
+
+    linalg::Matrix<double> T{counting(4, 1003)};
+    CHECK(linalg::takeCols(linalg::takeCols(T, perm), linalg::inversePermutation(perm)) == T);
+}
+
+TEST_CASE("indexed_rows_multiply")
+{
+    linalg::Matrix<double> X{counting(50, 40)};
+    linalg::Matrix<double> W{counting(40, 30)};
+    std::vector<size_t> batch{7, 3, 49, 3, 0, 21};
+    linalg::IndexedRows<double> view{X, batch};
+    CHECK(view.rows() == 6);
+    CHECK(view.cols() == 40);
+    CHECK(view.materialize() == linalg::takeRows(X, batch));
+    CHECK(view * W == linalg::takeRows(X, batch) * W);
+
+    linalg::Matrix<double> Y{counting(9, 6)};
+    CHECK(Y * view == Y * linalg::takeRows(X, batch));
+}
+
+TEST_CASE("huge_gather_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    linalg::Matrix<double> X{counting(20000, 300)};
+    std::vector<size_t> perm{shuffled(20000, 7919)};
+    linalg::Matrix<double> gathered{linalg::takeRows(X, perm)};
+    bool same = true;
+    for (size_t i=0; i<perm.size(); i++)
+    {
+        same = same && gathered(i, 17) == X(perm[i], 17);
+    }
+    CHECK(same);
+
+    linalg::Matrix<double> back{20000, 300, 0.0};
+    linalg::scatterRows(gathered, perm, back);
+    CHECK(back == X);
+
+    std::vector<size_t> batch(perm.begin(), perm.begin() + 512);
+    linalg::Matrix<double> W{counting(300, 64)};
+    linalg::Matrix<double> product{linalg::IndexedRows<double>{X, batch} * W};
+    linalg::Matrix<double> expected{linalg::takeRows(X, batch) * W};
+    CHECK(product == expected);
+    linalg::setNumThreads(threads);
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/kronecker.h>
+#include <Matrix/parallel.h>
+
+#include "test_helpers.h"
+
+
+TEST_CASE("kron_small")
+{
+    linalg::Matrix<int> A{{{1, 2}, {3, 4}}};
+    linalg::Matrix<int> B{{{0, 1}, {1, 0}}};
+    linalg::Matrix<int> expected{{{0, 1, 0, 2}, {1, 0, 2, 0}, {0, 3, 0, 4}, {3, 0, 4, 0}}};
+    CHECK(linalg::kron(A, B) == expected);
+
+    linalg::Matrix<int> row{{1, 2, 3}};
+    linalg::Matrix<int> col{linalg::Matrix<int>{{1, 10}}.transpose()};
+    CHECK(linalg::kron(row, col) == linalg::Matrix<int>{{{1, 2, 3}, {10, 20, 30}}});
+}
+
+TEST_CASE("kron_multiply_matches_dense")
+{
+    // Shapes that pick either order of the two products.
+    size_t shapes[][4] = {{7, 5, 3, 9}, {3, 9, 7, 5}, {12, 4, 4, 12}};
+    for (auto& shape : shapes)
+    {
+        linalg::Matrix<double> A{seededMatrix(shape[0], shape[1], 1)};
+        linalg::Matrix<double> B{seededMatrix(shape[2], shape[3], 2)};
+        linalg::Matrix<double> dense{linalg::kron(A, B)};
+        for (size_t p : {1, 6})
+        {
+            linalg::Matrix<double> X{seededMatrix(shape[1] * shape[3], p, 3)};
+            CHECK(maxDifference(linalg::kronMultiply(A, B, X), dense * X) < 1e-10);
+        }
+    }
+}
+
+TEST_CASE("huge_kron_multiply_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    // The Kronecker matrix would hold 6.5e9 elements.
+    linalg::Matrix<double> A{seededMatrix(300, 300, 1)};
+    linalg::Matrix<double> B{seededMatrix(270, 270, 2)};
+    linalg::Matrix<double> X{seededMatrix(300 * 270, 2, 3)};
+    linalg::Matrix<double> Y{linalg::kronMultiply(A, B, X)};
+    REQUIRE(Y.rows() == 300 * 270);
+
+    // Spot check a few rows against the definition.
+    for (size_t row : {0, 4321, 80999})
+    {
+        size_t i = row / 270;
+        size_t k = row % 270;
+        for (size_t c=0; c<2; c++)
+        {
+            double expected = 0;
+            for (size_t j=0; j<300; j++)
+            {
+                for (size_t l=0; l<270; l++)
+                {
+                    expected += A(i, j) * B(k, l) * X(j * 270 + l, c);
+                }
+            }
+            CHECK(std::abs(Y(row, c) - expected) < 1e-8);
+        }
+    }
+    linalg::setNumThreads(threads);
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/low_rank.h>
+#include <Matrix/parallel.h>
+
+#include "test_helpers.h"
+
+
+TEST_CASE("low_rank_to_dense")
+{
+    linalg::Matrix<double> left{{1, 2}};
+    linalg::Matrix<double> right{{3, 4, 5}};
+    linalg::LowRankMatrix<double> A{left.transpose(), right.transpose()};
+    CHECK(A.rows() == 2);
+    CHECK(A.cols() == 3);
+    CHECK(A.rank() == 1);
+    CHECK(A.toDense() == linalg::Matrix<double>{{{3, 4, 5}, {6, 8, 10}}});
+    CHECK(A.transpose().toDense() == A.toDense().transpose());
+}
+
+TEST_CASE("low_rank_products")
+{
+    linalg::LowRankMatrix<double> A{seededMatrix(90, 7, 1), seededMatrix(70, 7, 2)};
+    linalg::LowRankMatrix<double> B{seededMatrix(70, 12, 3), seededMatrix(50, 12, 4)};
+    linalg::Matrix<double> dense{A.toDense()};
+    linalg::Matrix<double> X{seededMatrix(70, 30, 5)};
+    linalg::Matrix<double> Y{seededMatrix(40, 90, 6)};
+
+    CHECK(maxDifference(A * X, dense * X) < 1e-10);
+    CHECK(maxDifference(Y * A, Y * dense) < 1e-10);
+
+    linalg::LowRankMatrix<double> AB{A * B};
+    CHECK(AB.rank() == 7);
+    CHECK(maxDifference(AB.toDense(), dense * B.toDense()) < 1e-9);
+    linalg::LowRankMatrix<double> BA{B.transpose() * A.transpose()};
+    CHECK(BA.rank() == 7);
+    CHECK(maxDifference(BA.toDense(), AB.toDense().transpose()) < 1e-9);
+
+    CHECK(maxDifference((A * 2.0).toDense(), linalg::Matrix<double>{dense * 2.0}) < 1e-12);
+    CHECK(maxDifference((0.5 * A).toDense(), linalg::Matrix<double>{dense * 0.5}) < 1e-12);
+}
+
+TEST_CASE("low_rank_sum_and_truncate")
+{
+    linalg::LowRankMatrix<double> A{seededMatrix(120, 6, 1), seededMatrix(80, 6, 2)};
+    linalg::LowRankMatrix<double> sum{A + A * 2.0};
+    CHECK(sum.rank() == 12);
+    linalg::Matrix<double> expected{A.toDense() * 3.0};
+    CHECK(maxDifference(sum.toDense(), expected) < 1e-10);
+
+    sum.truncate(1e-12);
+    CHECK(sum.rank() == 6);
+    CHECK(maxDifference(sum.toDense(), expected) < 1e-10);
+
+    // More factor columns than rows goes through the dense decomposition.
+    linalg::LowRankMatrix<double> wide{seededMatrix(5, 9, 3), seededMatrix(8, 9, 4)};
+    linalg::Matrix<double> before{wide.toDense()};
+    wide.truncate(0.0);
+    CHECK(wide.rank() == 5);
+    CHECK(maxDifference(wide.toDense(), before) < 1e-10);
+
+    linalg::LowRankMatrix<double> zero{linalg::Matrix<double>{10, 3, 0.0}, seededMatrix(6, 3, 5)};
+    zero.truncate(1e-12);
+    CHECK(zero.rank() == 0);
+    CHECK(zero.toDense() == linalg::Matrix<double>{10, 6, 0.0});
+}
+
+TEST_CASE("low_rank_approximation")
+{
+    linalg::Matrix<double> exact{seededMatrix(200, 10, 1) * seededMatrix(10, 150, 2)};
+    linalg::LowRankMatrix<double> A{linalg::lowRankApproximation(exact, 10)};
+    CHECK(A.rank() == 10);
+    CHECK(maxDifference(A.toDense(), exact) < 1e-8);
+}
+
+TEST_CASE("huge_low_rank_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    linalg::LowRankMatrix<double> A{seededMatrix(3000, 16, 1), seededMatrix(2000, 16, 2)};
+    linalg::Matrix<double> X{seededMatrix(2000, 8, 3)};
+    linalg::Matrix<double> Y{A * X};
+    linalg::Matrix<double> expected{A.left() * linalg::Matrix<double>{A.right().transpose() * X}};
+    CHECK(maxDifference(Y, expected) < 1e-9);
+    linalg::setNumThreads(threads);
+}
@@ -0,0 +1,280 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/lu.h>
+
+#include "test_helpers.h"
+
+
+// Deterministic test data in [-1, 1], with a heavier diagonal when asked.
+static linalg::Matrix<double> testMatrix(size_t rows, size_t cols, double diagonal)
+{
+    linalg::Matrix<double> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            res(i, j) = static_cast<double>((i * 37 + j * 91 + 11) % 199) / 99.0 - 1.0;
+        }
+        if (i < cols)
+        {
+            res(i, i) += diagonal;
+        }
+    }
+    return res;
+}
+
+TEST_SUITE_BEGIN("test_lu");
+
+TEST_CASE("blocked_multiplication_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{testMatrix(157, 301, 0)};
+    Matrix<double> B{testMatrix(301, 93, 0)};
+    Matrix<double> C{A * B};
+    setNumThreads(threads);
+
+    double worst = 0;
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        for (size_t j=0; j<B.cols(); j++)
+        {
+            double expected = 0;
+            for (size_t k=0; k<A.cols(); k++)
+            {
+                expected += A(i, k) * B(k, j);
+            }
+            worst = std::max(worst, std::abs(C(i, j) - expected));
+        }
+    }
+    CHECK(worst < 1e-10);
+}
+
+TEST_CASE("small_solve")
+{
+    using namespace linalg;
+    Matrix<double> A{{{4, 3}, {6, 3}}};
+    Matrix<double> b{Matrix<double>{{10, 12}}.transpose()};
+    LUDecomposition<double> lu{A};
+    Matrix<double> x{lu.solve(b)};
+    CHECK(x(0, 0) == doctest::Approx(1));
+    CHECK(x(1, 0) == doctest::Approx(2));
+    CHECK(lu.determinant() == doctest::Approx(-6));
+    CHECK(determinant(Matrix<double>{{{1, 2}, {3, 4}}}) == doctest::Approx(-2));
+}
+
+TEST_CASE("zero_pivot")
+{
+    using namespace linalg;
+    Matrix<double> A{{{0, 1, 0}, {1, 0, 0}, {0, 0, 2}}};
+    LUDecomposition<double> lu{A};
+    CHECK(lu.isSingular() == false);
+    CHECK(lu.pivots()[0] == 1);
+    CHECK(lu.determinant() == doctest::Approx(-2));
+
+    Matrix<double> B{{{1, 2}, {3, 4}, {5, 6}}};
+    Matrix<double> X{solve(A, B)};
+    CHECK(X(0, 0) == doctest::Approx(3));
+    CHECK(X(1, 1) == doctest::Approx(2));
+    CHECK(X(2, 0) == doctest::Approx(2.5));
+}
+
+TEST_CASE("singular")
+{
+    using namespace linalg;
+    Matrix<double> A{{{1, 2, 3}, {2, 4, 6}, {1, 0, 1}}};
+    LUDecomposition<double> lu{A};
+    CHECK(lu.isSingular() == true);
+    CHECK(lu.determinant() == 0);
+}
+
+TEST_CASE("factors_reproduce_matrix")
+{
+    using namespace linalg;
+    Matrix<double> A{testMatrix(150, 150, 0)};
+    LUDecomposition<double> lu{A};
+    Matrix<double> PA{A};
+    for (size_t i=0; i<PA.rows(); i++)
+    {
+        if (lu.pivots()[i] != i)
+        {
+            for (size_t j=0; j<PA.cols(); j++)
+            {
+                std::swap(PA(i, j), PA(lu.pivots()[i], j));
+            }
+        }
+    }
+    Matrix<double> LU{lu.lower() * lu.upper()};
+    double worst = 0;
+    for (size_t i=0; i<PA.rows(); i++)
+    {
+        for (size_t j=0; j<PA.cols(); j++)
+        {
+            worst = std::max(worst, std::abs(PA(i, j) - LU(i, j)));
+        }
+    }
+    CHECK(worst < 1e-10);
+}
+
+TEST_CASE("huge_factors_reproduce_matrix_threaded")
+{
+    // Enough block columns for several update tasks per step, so panels
+    // run ahead of the trailing updates.
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{testMatrix(709, 709, 3)};
+    LUDecomposition<double> lu{A};
+    Matrix<double> PA{A};
+    for (size_t i=0; i<PA.rows(); i++)
+    {
+        for (size_t j=0; j<PA.cols(); j++)
+        {
+            std::swap(PA(i, j), PA(lu.pivots()[i], j));
+        }
+    }
+    Matrix<double> LU{lu.lower() * lu.upper()};
+    double worst = 0;
+    for (size_t i=0; i<PA.rows(); i++)
+    {
+        for (size_t j=0; j<PA.cols(); j++)
+        {
+            worst = std::max(worst, std::abs(PA(i, j) - LU(i, j)));
+        }
+    }
+    CHECK(worst < 1e-9);
+    setNumThreads(threads);
+}
+
+TEST_CASE("huge_solve_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{testMatrix(400, 400, 20)};
+    Matrix<double> B{testMatrix(400, 7, 0)};
+    Matrix<double> X{solve(A, B)};
+    Matrix<double> residual{A * X - B};
+    setNumThreads(threads);
+
+    double worst = 0;
+    for (size_t i=0; i<residual.rows(); i++)
+    {
+        for (size_t j=0; j<residual.cols(); j++)
+        {
+            worst = std::max(worst, std::abs(residual(i, j)));
+        }
+    }
+    CHECK(worst < 1e-10);
+}
+
+static linalg::Matrix<double> identity(size_t n)
+{
+    linalg::Matrix<double> res{n, n};
+    for (size_t i=0; i<n; i++)
+    {
+        res(i, i) = 1;
+    }
+    return res;
+}
+
+TEST_CASE("small_inverse")
+{
+    using namespace linalg;
+    Matrix<double> A{{{4, 7}, {2, 6}}};
+    CHECK(invertInPlace(A) == true);
+    CHECK(maxDifference(A, Matrix<double>{{{0.6, -0.7}, {-0.2, 0.4}}}) < 1e-15);
+
+    Matrix<double> P{{{0, 1, 0}, {0, 0, 1}, {1, 0, 0}}};
+    CHECK(isSame(inverse(P), P.transpose()) == 1);
+
+    Matrix<double> S{{{1, 2}, {2, 4}}};
+    CHECK(invertInPlace(S) == false);
+
+    Matrix<float> F{{{2, 0}, {0, 8}}};
+    CHECK(inverse(F)(1, 1) == doctest::Approx(0.125f));
+}
+
+TEST_CASE("triangular_inverse")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{testMatrix(170, 170, 0) * 0.05};
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        A(i, i) += 1;
+    }
+    Matrix<double> upper{A};
+    Matrix<double> lower{A};
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        for (size_t j=0; j<i; j++)
+        {
+            upper(i, j) = 0;
+            lower(j, i) = 0;
+        }
+    }
+
+    Matrix<double> invUpper{upper};
+    invertTriangularInPlace(invUpper, Triangle::Upper);
+    CHECK(maxDifference(upper * invUpper, identity(170)) < 1e-12);
+
+    // Only the lower triangle is read and written.
+    Matrix<double> invLower{A};
+    invertTriangularInPlace(invLower, Triangle::Lower, Diagonal::Unit);
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        CHECK(invLower(i, i) == A(i, i));
+        lower(i, i) = 1;
+        invLower(i, i) = 1;
+        for (size_t j=i+1; j<A.cols(); j++)
+        {
+            CHECK(invLower(i, j) == A(i, j));
+            invLower(i, j) = 0;
+        }
+    }
+    CHECK(maxDifference(lower * invLower, identity(170)) < 1e-12);
+    setNumThreads(threads);
+}
+
+TEST_CASE("huge_inverse_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{testMatrix(300, 300, 20)};
+    Matrix<double> inv{inverse(A)};
+    LUDecomposition<double> lu{A};
+    Matrix<double> fromFactors{lu.inverse()};
+    setNumThreads(threads);
+
+    CHECK(maxDifference(A * inv, identity(300)) < 1e-9);
+    CHECK(maxDifference(inv * A, identity(300)) < 1e-9);
+    CHECK(isSame(inv, fromFactors) == 1);
+}
+
+TEST_SUITE_END();
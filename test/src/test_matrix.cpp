@@ -19,6 +19,9 @@
  */
 
 #define DOCTEST_CONFIG_IMPLEMENT
+// SIGSTKSZ is no longer a constant on recent glibc, which the signal 
+// handlers of this doctest version rely on.
+#define DOCTEST_CONFIG_NO_POSIX_SIGNALS
 #include <doctest/doctest.h>
 
 
@@ -0,0 +1,136 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+#include <limits>
+
+#include <doctest/doctest.h>
+#include <Matrix/matrix_functions.h>
+
+#include "test_helpers.h"
+
+
+// Deterministic test data in [-scale, scale].
+static linalg::Matrix<double> testMatrix(size_t n, double scale)
+{
+    linalg::Matrix<double> res{n, n};
+    for (size_t i=0; i<n; i++)
+    {
+        for (size_t j=0; j<n; j++)
+        {
+            size_t hash = (i * 73856093) ^ (j * 19349663);
+            res(i, j) = scale * (static_cast<double>(hash % 2001) / 1000.0 - 1.0);
+        }
+    }
+    return res;
+}
+
+TEST_SUITE_BEGIN("test_matrix_functions");
+
+TEST_CASE("power_matches_repeated_multiplication")
+{
+    using namespace linalg;
+    Matrix<double> A{testMatrix(40, 0.05)};
+    Matrix<double> expected{40, 40};
+    for (size_t i=0; i<40; i++)
+    {
+        expected(i, i) = 1;
+    }
+    CHECK(isSame(pow(A, 0), expected) == 1);
+    for (size_t exponent=1; exponent<=13; exponent++)
+    {
+        expected = expected * A;
+        CHECK(maxDifference(pow(A, exponent), expected) < 1e-12);
+    }
+}
+
+TEST_CASE("huge_power_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> transition{{{0.9, 0.1}, {0.5, 0.5}}};
+    Matrix<double> longRun{pow(transition, 1000)};
+    CHECK(longRun(0, 0) == doctest::Approx(5.0 / 6.0));
+    CHECK(longRun(1, 1) == doctest::Approx(1.0 / 6.0));
+
+    Matrix<double> A{testMatrix(150, 1.0 / 150.0)};
+    Matrix<double> B{pow(A, 6)};
+    Matrix<double> A3{A * A * A};
+    setNumThreads(threads);
+    CHECK(maxDifference(B, A3 * A3) < 1e-14);
+}
+
+TEST_CASE("exponential_of_simple_matrices")
+{
+    using namespace linalg;
+    Matrix<double> D{{{1, 0}, {0, -2}}};
+    Matrix<double> E{expm(D)};
+    CHECK(E(0, 0) == doctest::Approx(std::exp(1.0)));
+    CHECK(E(1, 1) == doctest::Approx(std::exp(-2.0)));
+    CHECK(E(0, 1) == 0);
+
+    Matrix<double> N{{{0, 1}, {0, 0}}};
+    CHECK(maxDifference(expm(N), Matrix<double>{{{1, 1}, {0, 1}}}) < 1e-15);
+
+    // A rotation by a large angle goes through the scaling and squaring.
+    double angle = 40.0;
+    Matrix<double> R{expm(Matrix<double>{{{0, -angle}, {angle, 0}}})};
+    CHECK(R(0, 0) == doctest::Approx(std::cos(angle)).epsilon(1e-10));
+    CHECK(R(1, 0) == doctest::Approx(std::sin(angle)).epsilon(1e-10));
+
+    Matrix<float> F{{{0.5f, 0}, {0, 0.25f}}};
+    CHECK(expm(F)(0, 0) == doctest::Approx(std::exp(0.5f)));
+}
+
+TEST_CASE("exponential_of_non_finite")
+{
+    using namespace linalg;
+    Matrix<double> A{{{1, 0}, {0, std::numeric_limits<double>::infinity()}}};
+    Matrix<double> E{expm(A)};
+    CHECK(std::isnan(E(0, 0)));
+    CHECK(std::isnan(E(1, 0)));
+
+    A(1, 1) = std::numeric_limits<double>::quiet_NaN();
+    CHECK(std::isnan(expm(A)(0, 1)));
+}
+
+TEST_CASE("exponential_inverse")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    const double scales[] = {1e-4, 1e-2, 0.5, 3};
+    for (double scale : scales)
+    {
+        Matrix<double> A{testMatrix(120, scale / 60.0)};
+        Matrix<double> product{expm(A) * expm(Matrix<double>{A * -1.0})};
+        Matrix<double> identity{120, 120};
+        for (size_t i=0; i<120; i++)
+        {
+            identity(i, i) = 1;
+        }
+        CHECK(maxDifference(product, identity) < 1e-12);
+    }
+    setNumThreads(threads);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,102 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/cholesky.h>
+#include <Matrix/qr.h>
+
+#include "test_helpers.h"
+
+
+// Least-squares solution through the normal equations A^T A X = A^T B.
+static linalg::Matrix<double> normalEquations(const linalg::Matrix<double>& A, const linalg::Matrix<double>& B)
+{
+    linalg::Matrix<double> At{A.transpose()};
+    return linalg::CholeskyDecomposition<double>{At * A}.solve(At * B);
+}
+
+TEST_SUITE_BEGIN("test_qr");
+
+TEST_CASE("line_fit")
+{
+    using namespace linalg;
+    Matrix<double> A{{{1, 1}, {1, 2}, {1, 3}}};
+    Matrix<double> y{{{1, 2}, {2, 4}, {2, 6}}};
+    Matrix<double> x{QRDecomposition<double>{A}.solve(y)};
+    CHECK(x(0, 0) == doctest::Approx(2.0 / 3.0));
+    CHECK(x(1, 0) == doctest::Approx(0.5));
+    CHECK(x(0, 1) == doctest::Approx(0).epsilon(1e-12));
+    CHECK(x(1, 1) == doctest::Approx(2));
+    CHECK(maxDifference(leastSquares(A, y), x) < 1e-12);
+}
+
+TEST_CASE("factors_reproduce_matrix")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> A{seededMatrix(300, 70, 1)};
+    QRDecomposition<double> qr{A};
+    Matrix<double> Q{qr.q()};
+    Matrix<double> R{qr.r()};
+    setNumThreads(threads);
+
+    CHECK(qr.isFullRank() == true);
+    CHECK(maxDifference(Q * R, A) < 1e-12);
+    Matrix<double> identity{70, 70};
+    for (size_t i=0; i<70; i++)
+    {
+        identity(i, i) = 1;
+    }
+    CHECK(maxDifference(Q.transpose() * Q, identity) < 1e-12);
+    CHECK(R(5, 2) == 0);
+}
+
+TEST_CASE("rank_deficient")
+{
+    using namespace linalg;
+    Matrix<double> A{{{1, 2}, {2, 4}, {3, 6}}};
+    CHECK(QRDecomposition<double>{A}.isFullRank() == false);
+}
+
+TEST_CASE("huge_least_squares_threaded")
+{
+    using namespace linalg;
+    Matrix<double> A{seededMatrix(40000, 24, 2)};
+    Matrix<double> B{seededMatrix(40000, 3, 3)};
+    Matrix<double> expected{normalEquations(A, B)};
+
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> tsqr{leastSquares(A, B)};
+    Matrix<double> blocked{QRDecomposition<double>{A}.solve(B)};
+    setNumThreads(1);
+    Matrix<double> serial{leastSquares(A, B)};
+    setNumThreads(threads);
+
+    CHECK(maxDifference(tsqr, expected) < 1e-10);
+    CHECK(maxDifference(blocked, expected) < 1e-10);
+    CHECK(tsqr == serial);
+}
+
+TEST_SUITE_END();
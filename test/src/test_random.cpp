@@ -0,0 +1,141 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cmath>
+#include <cstdint>
+
+#include <doctest/doctest.h>
+#include <Matrix/parallel.h>
+#include <Matrix/random.h>
+
+
+TEST_CASE("philox_known_answer")
+{
+    // Philox4x32-10 of the zero counter with the zero key, from the
+    // reference implementation.
+    uint32_t words[4][linalg::RANDOM_LANES];
+    linalg::detail::philoxBatch(0, 0, words);
+    CHECK(words[0][0] == 0x6627e8d5u);
+    CHECK(words[1][0] == 0xe169c58du);
+    CHECK(words[2][0] == 0xbc57ac4cu);
+    CHECK(words[3][0] == 0x9b00dbd8u);
+
+    // Lanes are consecutive counters.
+    uint32_t shifted[4][linalg::RANDOM_LANES];
+    linalg::detail::philoxBatch(3, 0, shifted);
+    CHECK(shifted[0][0] == words[0][3]);
+    CHECK(shifted[3][4] == words[3][7]);
+}
+
+TEST_CASE("random_uniform_statistics")
+{
+    linalg::Matrix<double> A{linalg::randomUniform<double>(1000, 1000, -2.0, 6.0, 1)};
+    double sum = 0;
+    double squares = 0;
+    double low = 6;
+    double high = -2;
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        for (size_t j=0; j<A.cols(); j++)
+        {
+            sum += A(i, j);
+            squares += A(i, j) * A(i, j);
+            low = std::min(low, A(i, j));
+            high = std::max(high, A(i, j));
+        }
+    }
+    double mean = sum / 1e6;
+    CHECK(std::abs(mean - 2.0) < 0.02);
+    CHECK(std::abs(squares / 1e6 - mean * mean - 64.0 / 12.0) < 0.05);
+    CHECK(low >= -2.0);
+    CHECK(high < 6.0);
+
+    linalg::Matrix<float> B{linalg::randomUniform<float>(3, 5, 0.0f, 1.0f, 1)};
+    CHECK(B(2, 4) >= 0.0f);
+    CHECK(B(2, 4) < 1.0f);
+    CHECK(!(linalg::randomUniform<double>(10, 10, 0.0, 1.0, 1) == linalg::randomUniform<double>(10, 10, 0.0, 1.0, 2)));
+}
+
+TEST_CASE("random_normal_statistics")
+{
+    linalg::Matrix<float> A{linalg::randomNormal<float>(999, 1001, 3.0f, 2.0f, 5)};
+    double sum = 0;
+    double squares = 0;
+    size_t within = 0;
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        for (size_t j=0; j<A.cols(); j++)
+        {
+            double value = A(i, j);
+            sum += value;
+            squares += value * value;
+            within += std::abs(value - 3.0) < 2.0;
+        }
+    }
+    double count = static_cast<double>(A.rows() * A.cols());
+    double mean = sum / count;
+    CHECK(std::abs(mean - 3.0) < 0.01);
+    CHECK(std::abs(std::sqrt(squares / count - mean * mean) - 2.0) < 0.01);
+    // One standard deviation holds 68.27% of a normal distribution.
+    CHECK(std::abs(within / count - 0.6827) < 0.005);
+}
+
+TEST_CASE("random_integers")
+{
+    linalg::Matrix<int> dice{linalg::randomIntegers<int>(300, 200, 1, 6, 3)};
+    size_t counts[7] = {};
+    bool inRange = true;
+    for (size_t i=0; i<dice.rows(); i++)
+    {
+        for (size_t j=0; j<dice.cols(); j++)
+        {
+            inRange = inRange && dice(i, j) >= 1 && dice(i, j) <= 6;
+            counts[std::min(std::max(dice(i, j), 0), 6)]++;
+        }
+    }
+    CHECK(inRange);
+    for (int face=1; face<=6; face++)
+    {
+        CHECK(std::abs(static_cast<double>(counts[face]) - 10000.0) < 500.0);
+    }
+
+    linalg::Matrix<long> negative{linalg::randomIntegers<long>(10, 10, -5, -5, 0)};
+    CHECK(negative == linalg::Matrix<long>{10, 10, -5});
+}
+
+TEST_CASE("huge_random_independent_of_threads")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(1);
+    linalg::Matrix<double> uniform{linalg::randomUniform<double>(1001, 777, 0.0, 1.0, 9)};
+    linalg::Matrix<float> normal{linalg::randomNormal<float>(513, 1025, 0.0f, 1.0f, 9)};
+    linalg::Matrix<int> integers{linalg::randomIntegers<int>(999, 333, -100, 100, 9)};
+    linalg::setNumThreads(4);
+    CHECK(linalg::randomUniform<double>(1001, 777, 0.0, 1.0, 9) == uniform);
+    CHECK(linalg::randomNormal<float>(513, 1025, 0.0f, 1.0f, 9) == normal);
+    CHECK(linalg::randomIntegers<int>(999, 333, -100, 100, 9) == integers);
+
+    // The stream does not depend on the shape.
+    linalg::Matrix<double> flat{linalg::randomUniform<double>(1, 1001 * 777, 0.0, 1.0, 9)};
+    CHECK(flat(0, 5 * 777 + 3) == uniform(5, 3));
+    linalg::setNumThreads(threads);
+}
@@ -0,0 +1,116 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <doctest/doctest.h>
+#include <Matrix/reduction.h>
+
+
+TEST_SUITE_BEGIN("test_reduction");
+
+TEST_CASE("sum")
+{
+    using namespace linalg;
+    Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};
+    Matrix<int> B{1000, 1000, 3};
+    CHECK(sum(A) == 21);
+    CHECK(sum(B) == 3000000);
+}
+
+TEST_CASE("compensated_sum")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<float> A{1000, 1000, 0.1f};
+    float naive = sum(A);
+    float kahan = sum(A, Summation::Kahan);
+    float pairwise = sum(A, Summation::Pairwise);
+    setNumThreads(threads);
+    CHECK(kahan == doctest::Approx(100000.0f).epsilon(1e-6));
+    CHECK(pairwise == doctest::Approx(100000.0f).epsilon(1e-5));
+    CHECK(naive == doctest::Approx(100000.0f).epsilon(1e-3));
+}
+
+TEST_CASE("min_max")
+{
+    using namespace linalg;
+    Matrix<int> A{{{4, 9, 1}, {7, 1, 9}}};
+    Extremum<int> low = minElement(A);
+    Extremum<int> high = maxElement(A);
+    CHECK(low.value == 1);
+    CHECK(low.row == 0);
+    CHECK(low.col == 2);
+    CHECK(high.value == 9);
+    CHECK(high.row == 0);
+    CHECK(high.col == 1);
+}
+
+TEST_CASE("huge_min_max")
+{
+    using namespace linalg;
+    Matrix<double> A{700, 800, 1.0};
+    A(523, 17) = -4.0;
+    A(96, 799) = 12.0;
+    CHECK(minElement(A).value == -4.0);
+    CHECK(minElement(A).row == 523);
+    CHECK(minElement(A).col == 17);
+    CHECK(maxElement(A).row == 96);
+    CHECK(maxElement(A).col == 799);
+}
+
+TEST_CASE("norms")
+{
+    using namespace linalg;
+    Matrix<double> A{{{1, -2}, {-3, 4}}};
+    CHECK(norm(A) == doctest::Approx(std::sqrt(30.0)));
+    CHECK(norm1(A) == 6.0);
+    CHECK(normInf(A) == 7.0);
+}
+
+TEST_CASE("row_col_reductions")
+{
+    using namespace linalg;
+    Matrix<int> A{{{1, 2, 3}, {4, 5, 6}}};
+    Matrix<int> rows{{6, 15}};
+    Matrix<int> rowLow{{1, 4}};
+    Matrix<int> rowHigh{{3, 6}};
+    CHECK(isSame(rows.transpose(), rowSums(A)) == 1);
+    CHECK(isSame(rowLow.transpose(), rowMin(A)) == 1);
+    CHECK(isSame(rowHigh.transpose(), rowMax(A)) == 1);
+    CHECK(isSame(Matrix<int>{{5, 7, 9}}, colSums(A)) == 1);
+    CHECK(isSame(Matrix<int>{{1, 2, 3}}, colMin(A)) == 1);
+    CHECK(isSame(Matrix<int>{{4, 5, 6}}, colMax(A)) == 1);
+}
+
+TEST_CASE("huge_row_col_reductions")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<int> A{900, 1100, 2};
+    Matrix<int> rows{900, 1, 2200};
+    Matrix<int> cols{1, 1100, 1800};
+    CHECK(isSame(rows, rowSums(A)) == 1);
+    CHECK(isSame(cols, colSums(A)) == 1);
+    setNumThreads(threads);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,114 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <Matrix/parallel.h>
+#include <Matrix/shape.h>
+
+
+// Matrix object whose element (i, j) is start + i * cols + j.
+static linalg::Matrix<int> counting(size_t rows, size_t cols, int start)
+{
+    linalg::Matrix<int> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            res(i, j) = start + static_cast<int>(i * cols + j);
+        }
+    }
+    return res;
+}
+
+TEST_CASE("stack_small")
+{
+    linalg::Matrix<int> A{{{1, 2}, {3, 4}}};
+    linalg::Matrix<int> B{linalg::Matrix<int>{{5, 6}}.transpose()};
+    linalg::Matrix<int> C{{7, 8}};
+    CHECK(linalg::hstack(A, B) == linalg::Matrix<int>{{{1, 2, 5}, {3, 4, 6}}});
+    CHECK(linalg::vstack(A, C) == linalg::Matrix<int>{{{1, 2}, {3, 4}, {7, 8}}});
+    CHECK(linalg::vstack(A, C, A) == linalg::Matrix<int>{{{1, 2}, {3, 4}, {7, 8}, {1, 2}, {3, 4}}});
+    CHECK(linalg::hstack(A) == A);
+}
+
+TEST_CASE("concat_along_both_axes")
+{
+    std::vector<linalg::Matrix<int>> tall{counting(3, 4, 0), counting(1, 4, 100), counting(0, 4, 0), counting(5, 4, 200)};
+    linalg::Matrix<int> rows{linalg::concat(tall, linalg::Axis::Rows)};
+    REQUIRE(rows.rows() == 9);
+    REQUIRE(rows.cols() == 4);
+    CHECK(rows(2, 3) == 11);
+    CHECK(rows(3, 0) == 100);
+    CHECK(rows(8, 3) == 219);
+
+    std::vector<linalg::Matrix<int>> wide{counting(3, 2, 0), counting(3, 1, 100), counting(3, 3, 200)};
+    linalg::Matrix<int> cols{linalg::concat(wide, linalg::Axis::Cols)};
+    CHECK(cols == linalg::Matrix<int>{{{0, 1, 100, 200, 201, 202},
+                                       {2, 3, 101, 203, 204, 205},
+                                       {4, 5, 102, 206, 207, 208}}});
+    CHECK(linalg::concat(wide, linalg::Axis::Cols).transpose() ==
+          linalg::concat(std::vector<linalg::Matrix<int>>{wide[0].transpose(), wide[1].transpose(), wide[2].transpose()},
+                         linalg::Axis::Rows));
+}
+
+TEST_CASE("reshape")
+{
+    linalg::Matrix<int> A{counting(2, 6, 0)};
+    const int* storage = A.data();
+    A.reshape(3, 4);
+    CHECK(A.rows() == 3);
+    CHECK(A.cols() == 4);
+    CHECK(A(2, 1) == 9);
+    CHECK(A.data() == storage);
+
+    linalg::Matrix<int> B{linalg::reshape(std::move(A), 12, 1)};
+    CHECK(B.data() == storage);
+    CHECK(B(7, 0) == 7);
+    CHECK(linalg::reshape(B, 1, 12) == counting(1, 12, 0));
+}
+
+TEST_CASE("huge_concat_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    std::vector<linalg::Matrix<int>> parts;
+    int start = 0;
+    for (size_t p=0; p<37; p++)
+    {
+        parts.push_back(counting(100 + p, 500, start));
+        start += static_cast<int>((100 + p) * 500);
+    }
+    linalg::Matrix<int> rows{linalg::concat(parts, linalg::Axis::Rows)};
+    CHECK(rows == counting(rows.rows(), 500, 0));
+
+    linalg::Matrix<int> cols{linalg::hstack(counting(3000, 70, 0), counting(3000, 30, 0))};
+    bool same = true;
+    for (size_t i=0; i<cols.rows(); i++)
+    {
+        same = same && cols(i, 69) == static_cast<int>(i * 70 + 69) && cols(i, 70) == static_cast<int>(i * 30);
+    }
+    CHECK(same);
+    linalg::setNumThreads(threads);
+}
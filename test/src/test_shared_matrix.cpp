@@ -0,0 +1,172 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <doctest/doctest.h>
+#include <Matrix/shared_matrix.h>
+#include <Matrix/transport.h>
+
+
+// Segment name which does not clash with another run of the test.
+static std::string segmentName(const char* suffix)
+{
+    return "/linalg_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+
+static linalg::Matrix<double> testMatrix(size_t rows, size_t cols)
+{
+    linalg::Matrix<double> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            res(i, j) = static_cast<double>((i * 31 + j * 7) % 23) - 11.0;
+        }
+    }
+    return res;
+}
+
+TEST_SUITE_BEGIN("test_shared_matrix");
+
+TEST_CASE("create_and_attach")
+{
+    using namespace linalg;
+    std::string name{segmentName("basic")};
+    Matrix<double> A{testMatrix(37, 19)};
+    SharedMatrix<double> owner;
+    REQUIRE(owner.create(name, A) == true);
+    CHECK(owner.isWritable() == true);
+    CHECK(isSame(owner.toMatrix(), A) == 1);
+
+    SharedMatrix<double> reader;
+    CHECK(reader.attach(name) == true);
+    CHECK(reader.isWritable() == false);
+    CHECK(reader.rows() == 37);
+    CHECK(reader.cols() == 19);
+    CHECK(reader(36, 18) == A(36, 18));
+
+    // The same pages, not a copy.
+    owner.data()[5] = 1000;
+    CHECK(reader(0, 5) == 1000);
+
+    // The name is taken, and the element type is checked.
+    SharedMatrix<double> again;
+    CHECK(again.create(name, 2, 2) == false);
+    SharedMatrix<float> wrongType;
+    CHECK(wrongType.attach(name) == false);
+
+    // Removing the name keeps existing mappings.
+    owner.detach();
+    CHECK(reader(0, 5) == 1000);
+    SharedMatrix<double> late;
+    CHECK(late.attach(name) == false);
+    CHECK(late.isAttached() == false);
+}
+
+TEST_CASE("rejects_overflowing_sizes")
+{
+    using namespace linalg;
+    std::string name{segmentName("overflow")};
+    SharedMatrix<double> huge;
+    CHECK(huge.create(name, size_t(1) << 40, size_t(1) << 40) == false);
+    CHECK(huge.isAttached() == false);
+
+    // A segment whose header claims dimensions with an overflowing product.
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    REQUIRE(fd >= 0);
+    detail::SharedHeader header;
+    std::memcpy(header.magic, detail::SHARED_MAGIC, sizeof(header.magic));
+    header.elementSize = sizeof(double);
+    header.rows = uint64_t(1) << 33;
+    header.cols = uint64_t(1) << 33;
+    std::vector<char> segment(detail::SHARED_DATA_OFFSET + 64);
+    std::memcpy(segment.data(), &header, sizeof(header));
+    CHECK(write(fd, segment.data(), segment.size()) == static_cast<ssize_t>(segment.size()));
+    close(fd);
+
+    SharedMatrix<double> reader;
+    CHECK(reader.attach(name) == false);
+    shm_unlink(name.c_str());
+}
+
+TEST_CASE("products")
+{
+    using namespace linalg;
+    std::string name{segmentName("products")};
+    Matrix<double> A{testMatrix(70, 90)};
+    Matrix<double> B{testMatrix(90, 50)};
+    Matrix<double> C{testMatrix(20, 70)};
+    SharedMatrix<double> owner;
+    REQUIRE(owner.create(name, A) == true);
+    SharedMatrix<double> reader;
+    REQUIRE(reader.attach(name) == true);
+    CHECK(isSame(reader * B, A * B) == 1);
+    CHECK(isSame(C * reader, C * A) == 1);
+
+    SharedMatrix<double> moved{std::move(reader)};
+    CHECK(reader.isAttached() == false);
+    CHECK(isSame(moved * B, A * B) == 1);
+}
+
+TEST_CASE("workers_share_one_copy")
+{
+    // One process creates the matrix, the others attach after a barrier and
+    // see the later writes of the creator.
+    using namespace linalg;
+    std::string name{segmentName("workers")};
+    Matrix<double> A{testMatrix(64, 48)};
+    Matrix<double> B{testMatrix(48, 16)};
+    Matrix<double> AB{A * B};
+    bool ok = runProcesses(4, [&](Transport& transport)
+    {
+        SharedMatrix<double> shared;
+        int bad = 0;
+        if (transport.rank() == 0)
+        {
+            bad += !shared.create(name, A);
+        }
+        barrier(transport);
+        if (transport.rank() != 0)
+        {
+            bad += !shared.attach(name);
+            bad += !isSame(shared * B, AB);
+        }
+        barrier(transport);
+        if (transport.rank() == 0)
+        {
+            shared.data()[0] = -1;
+        }
+        barrier(transport);
+        bad += shared(0, 0) != -1;
+        barrier(transport);
+        return bad;
+    });
+    CHECK(ok == true);
+}
+
+TEST_SUITE_END();
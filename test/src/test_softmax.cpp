@@ -0,0 +1,155 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/softmax.h>
+
+
+TEST_SUITE_BEGIN("test_softmax");
+
+TEST_CASE("fast_exp_float")
+{
+    double worst = 0;
+    for (float x=-80.0f; x<80.0f; x+=0.0137f)
+    {
+        double exact = std::exp(static_cast<double>(x));
+        worst = std::max(worst, std::abs(linalg::detail::fastExp(x) - exact) / exact);
+    }
+    CHECK(worst < 5e-7);
+    CHECK(linalg::detail::fastExp(-200.0f) == 0.0f);
+}
+
+TEST_CASE("fast_exp_double")
+{
+    double worst = 0;
+    for (double x=-700.0; x<700.0; x+=0.0731)
+    {
+        double exact = std::exp(x);
+        worst = std::max(worst, std::abs(linalg::detail::fastExp(x) - exact) / exact);
+    }
+    CHECK(worst < 1e-14);
+}
+
+TEST_CASE("small_softmax")
+{
+    using namespace linalg;
+    Matrix<double> A{{{1, 2, 3}, {5, 5, 5}}};
+    Matrix<double> P{softmax(A)};
+    double total = std::exp(1.0) + std::exp(2.0) + std::exp(3.0);
+    CHECK(P(0, 0) == doctest::Approx(std::exp(1.0) / total));
+    CHECK(P(0, 2) == doctest::Approx(std::exp(3.0) / total));
+    CHECK(P(1, 1) == doctest::Approx(1.0 / 3.0));
+}
+
+TEST_CASE("large_logits")
+{
+    using namespace linalg;
+    Matrix<float> A{{1000, 1000, -1000}};
+    softmaxInPlace(A);
+    CHECK(A(0, 0) == doctest::Approx(0.5f));
+    CHECK(A(0, 2) == 0.0f);
+
+    Matrix<double> B{{1000, 1000}};
+    CHECK(logSumExp(B)(0, 0) == doctest::Approx(1000.0 + std::log(2.0)));
+}
+
+TEST_CASE("huge_softmax_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<float> A{300, 2000};
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        for (size_t j=0; j<A.cols(); j++)
+        {
+            A(i, j) = static_cast<float>((i * 31 + j * 17) % 101) / 10.0f;
+        }
+    }
+    Matrix<float> P{softmax(A)};
+    Matrix<float> L{logSumExp(A)};
+    setNumThreads(threads);
+
+    for (size_t i=0; i<A.rows(); i+=37)
+    {
+        double total = 0;
+        for (size_t j=0; j<A.cols(); j++)
+        {
+            total += P(i, j);
+        }
+        CHECK(total == doctest::Approx(1.0).epsilon(1e-4));
+        CHECK(P(i, 5) == doctest::Approx(std::exp(A(i, 5) - L(i, 0))).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("multiply_softmax")
+{
+    using namespace linalg;
+    Matrix<double> A{{{1, 2}, {3, 4}, {0, -1}}};
+    Matrix<double> B{{{0.5, 1, -1}, {0.25, 0, 2}}};
+    Matrix<double> expected{softmax(A * B)};
+    Matrix<double> fused{multiplySoftmax(A, B)};
+    for (size_t i=0; i<3; i++)
+    {
+        for (size_t j=0; j<3; j++)
+        {
+            CHECK(fused(i, j) == doctest::Approx(expected(i, j)));
+        }
+    }
+}
+
+TEST_CASE("huge_multiply_softmax_threaded")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<float> A{130, 70};
+    Matrix<float> B{70, 300};
+    for (size_t i=0; i<A.rows(); i++)
+    {
+        for (size_t j=0; j<A.cols(); j++)
+        {
+            A(i, j) = static_cast<float>((i * 7 + j * 3) % 13) / 13.0f;
+        }
+    }
+    for (size_t i=0; i<B.rows(); i++)
+    {
+        for (size_t j=0; j<B.cols(); j++)
+        {
+            B(i, j) = static_cast<float>((i * 5 + j * 11) % 17) / 17.0f - 0.5f;
+        }
+    }
+    Matrix<float> expected{softmax(A * B)};
+    Matrix<float> fused{multiplySoftmax(A, B)};
+    setNumThreads(threads);
+
+    for (size_t i=0; i<A.rows(); i+=13)
+    {
+        for (size_t j=0; j<B.cols(); j+=29)
+        {
+            CHECK(fused(i, j) == doctest::Approx(expected(i, j)).epsilon(1e-5));
+        }
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,203 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <Matrix/shape.h>
+#include <Matrix/streaming.h>
+
+#include "test_helpers.h"
+
+
+// Rows [begin, end) of mat.
+static linalg::Matrix<double> rowRange(const linalg::Matrix<double>& mat, size_t begin, size_t end)
+{
+    linalg::Matrix<double> res{end - begin, mat.cols()};
+    std::copy(mat.data() + begin * mat.cols(), mat.data() + end * mat.cols(), res.data());
+    return res;
+}
+
+// Pushes the rows of A in chunks of varying size from another thread, pulls
+// the product and returns the largest difference from A * B.
+static double streamProduct(const linalg::Matrix<double>& A, const linalg::Matrix<double>& B, size_t batchRows,
+                            size_t capacity)
+{
+    linalg::StreamingMultiplier<double> stream{B, batchRows, capacity};
+    std::thread producer([&]()
+    {
+        size_t begin = 0;
+        for (size_t step=1; begin<A.rows(); step++)
+        {
+            size_t end = std::min(A.rows(), begin + (step * 37) % 101);
+            stream.push(rowRange(A, begin, end));
+            begin = end;
+        }
+        stream.close();
+    });
+
+    linalg::Matrix<double> expected{A * B};
+    linalg::Matrix<double> chunk{0, 0};
+    size_t row = 0;
+    double worst = 0;
+    while (stream.pull(chunk))
+    {
+        if (chunk.cols() != B.cols() || chunk.rows() == 0 || chunk.rows() > batchRows || row + chunk.rows() > A.rows())
+        {
+            worst = 1e300;
+            break;
+        }
+        for (size_t i=0; i<chunk.rows(); i++)
+        {
+            for (size_t j=0; j<chunk.cols(); j++)
+            {
+                worst = std::max(worst, std::abs(chunk(i, j) - expected(row + i, j)));
+            }
+        }
+        row += chunk.rows();
+    }
+    producer.join();
+    return (row == A.rows()) ? worst : 1e300;
+}
+
+TEST_SUITE_BEGIN("test_streaming");
+
+TEST_CASE("stream_matches_product")
+{
+    linalg::Matrix<double> A{seededMatrix(1000, 70, 1)};
+    linalg::Matrix<double> B{seededMatrix(70, 45, 2)};
+    CHECK(streamProduct(A, B, 64, 2) < 1e-12);
+    CHECK(streamProduct(A, B, 1, 1) < 1e-12);
+    CHECK(streamProduct(A, B, 5000, 4) < 1e-12);
+}
+
+TEST_CASE("huge_stream_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    linalg::Matrix<double> A{seededMatrix(3000, 300, 3)};
+    linalg::Matrix<double> B{seededMatrix(300, 200, 4)};
+    CHECK(streamProduct(A, B, linalg::STREAM_BATCH_ROWS, linalg::STREAM_CAPACITY) < 1e-11);
+    linalg::setNumThreads(threads);
+}
+
+TEST_CASE("same_thread")
+{
+    // Within the capacity, one thread can push, close and then pull.
+    using namespace linalg;
+    Matrix<double> A{seededMatrix(30, 8, 5)};
+    Matrix<double> B{seededMatrix(8, 3, 6)};
+    StreamingMultiplier<double> stream{B, 16, 4};
+    CHECK(stream.inner() == 8);
+    CHECK(stream.cols() == 3);
+    stream.push(A);
+    stream.close();
+    Matrix<double> first{0, 0};
+    Matrix<double> second{0, 0};
+    CHECK(stream.pull(first) == true);
+    CHECK(stream.pull(second) == true);
+    CHECK(stream.pull(second) == false);
+    CHECK(stream.tryPull(second) == false);
+    CHECK(first.rows() + second.rows() == 30);
+    CHECK(isSame(vstack(first, second), Matrix<double>{A * B}) == 1);
+}
+
+TEST_CASE("empty_stream")
+{
+    linalg::StreamingMultiplier<double> stream{seededMatrix(4, 4, 7)};
+    stream.close();
+    linalg::Matrix<double> chunk{0, 0};
+    CHECK(stream.pull(chunk) == false);
+    CHECK(stream.finished() == true);
+}
+
+TEST_CASE("polling_consumer")
+{
+    // A consumer which never blocks sees the end through finished().
+    linalg::Matrix<double> A{seededMatrix(500, 20, 10)};
+    linalg::Matrix<double> B{seededMatrix(20, 9, 11)};
+    linalg::StreamingMultiplier<double> stream{B, 32, 2};
+    std::thread producer([&]()
+    {
+        for (size_t begin=0; begin<A.rows(); begin+=50)
+        {
+            stream.push(rowRange(A, begin, begin + 50));
+        }
+        stream.close();
+    });
+
+    linalg::Matrix<double> chunk{0, 0};
+    size_t rows = 0;
+    while (!stream.finished())
+    {
+        if (stream.tryPull(chunk))
+        {
+            rows += chunk.rows();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(rows == 500);
+    CHECK(stream.tryPull(chunk) == false);
+}
+
+TEST_CASE("back_pressure")
+{
+    // Nothing is pulled, so the producer stops after a bounded number of rows.
+    const size_t BATCH = 8;
+    const size_t CAPACITY = 2;
+    std::atomic<size_t> pushed{0};
+    {
+        linalg::StreamingMultiplier<double> stream{seededMatrix(6, 6, 8), BATCH, CAPACITY};
+        std::thread producer([&]()
+        {
+            linalg::Matrix<double> row{seededMatrix(1, 6, 9)};
+            for (size_t i=0; i<1000; i++)
+            {
+                stream.push(row);
+                pushed++;
+            }
+            stream.close();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        CHECK(pushed.load() <= (2 * CAPACITY + 3) * BATCH);
+
+        linalg::Matrix<double> chunk{0, 0};
+        size_t rows = 0;
+        while (stream.pull(chunk))
+        {
+            rows += chunk.rows();
+        }
+        producer.join();
+        CHECK(rows == 1000);
+    }
+    CHECK(pushed.load() == 1000);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,124 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <Matrix/svd.h>
+
+#include "test_helpers.h"
+
+
+static linalg::Matrix<double> identity(size_t n)
+{
+    linalg::Matrix<double> res{n, n};
+    for (size_t i=0; i<n; i++)
+    {
+        res(i, i) = 1;
+    }
+    return res;
+}
+
+// U diag(s) V^T
+static linalg::Matrix<double> rebuild(const linalg::SingularValueDecomposition<double>& usv)
+{
+    using namespace linalg;
+    return usv.u * Matrix<double>{hadamard(usv.v.transpose(), usv.s)};
+}
+
+TEST_SUITE_BEGIN("test_svd");
+
+TEST_CASE("small_svd")
+{
+    using namespace linalg;
+    Matrix<double> A{{{3, 0}, {0, -2}, {0, 0}}};
+    SingularValueDecomposition<double> usv{svd(A)};
+    CHECK(usv.s(0, 0) == doctest::Approx(3));
+    CHECK(usv.s(1, 0) == doctest::Approx(2));
+    CHECK(usv.u.size() == Matrix<double>{3, 2}.size());
+    CHECK(maxDifference(rebuild(usv), A) < 1e-14);
+}
+
+TEST_CASE("full_svd")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    Matrix<double> tall{seededMatrix(90, 41, 1)};
+    Matrix<double> wide{tall.transpose()};
+    SingularValueDecomposition<double> t{svd(tall)};
+    SingularValueDecomposition<double> w{svd(wide)};
+    setNumThreads(threads);
+
+    CHECK(maxDifference(rebuild(t), tall) < 1e-12);
+    CHECK(maxDifference(rebuild(w), wide) < 1e-12);
+    CHECK(maxDifference(t.u.transpose() * t.u, identity(41)) < 1e-12);
+    CHECK(maxDifference(t.v.transpose() * t.v, identity(41)) < 1e-12);
+    CHECK(maxDifference(t.s, w.s) < 1e-12);
+    for (size_t j=1; j<41; j++)
+    {
+        CHECK(t.s(j, 0) <= t.s(j - 1, 0));
+    }
+}
+
+TEST_CASE("randomized_svd_exact_rank")
+{
+    using namespace linalg;
+    size_t threads = getNumThreads();
+    setNumThreads(4);
+    size_t m = 1200;
+    size_t n = 700;
+    Matrix<double> left{QRDecomposition<double>{seededMatrix(m, 8, 2)}.q()};
+    Matrix<double> right{QRDecomposition<double>{seededMatrix(n, 8, 3)}.q()};
+    Matrix<double> s{Matrix<double>{{100, 50, 20, 10, 5, 2, 1, 0.5}}.transpose()};
+    Matrix<double> A{left * Matrix<double>{hadamard(right.transpose(), s)}};
+    SingularValueDecomposition<double> usv{randomizedSvd(A, 5)};
+    SingularValueDecomposition<double> all{randomizedSvd(A, 8, 4, 0)};
+    setNumThreads(threads);
+
+    for (size_t j=0; j<5; j++)
+    {
+        CHECK(usv.s(j, 0) == doctest::Approx(s(j, 0)).epsilon(1e-10));
+    }
+    CHECK(maxDifference(rebuild(all), A) < 1e-10);
+    CHECK(maxDifference(usv.u.transpose() * usv.u, identity(5)) < 1e-12);
+}
+
+TEST_CASE("randomized_svd_decaying_spectrum")
+{
+    using namespace linalg;
+    Matrix<double> G{seededMatrix(300, 200, 4)};
+    // Columns scaled by a geometric sequence.
+    Matrix<double> decay{1, 200};
+    for (size_t j=0; j<200; j++)
+    {
+        decay(0, j) = std::pow(0.9, static_cast<double>(j));
+    }
+    Matrix<double> A{hadamard(G, decay)};
+    SingularValueDecomposition<double> exact{svd(A)};
+    SingularValueDecomposition<double> approx{randomizedSvd(A, 6, 10, 3)};
+    for (size_t j=0; j<6; j++)
+    {
+        CHECK(approx.s(j, 0) == doctest::Approx(exact.s(j, 0)).epsilon(1e-6));
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,162 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <Matrix/parallel.h>
+#include <Matrix/task_graph.h>
+
+
+// Matrix object whose element (i, j) is (i * cols + j + seed) % 13 - 6.
+static linalg::Matrix<double> testMatrix(size_t rows, size_t cols, size_t seed)
+{
+    linalg::Matrix<double> res{rows, cols};
+    for (size_t i=0; i<rows; i++)
+    {
+        for (size_t j=0; j<cols; j++)
+        {
+            res(i, j) = static_cast<double>((i * cols + j + seed) % 13) - 6.0;
+        }
+    }
+    return res;
+}
+
+TEST_CASE("task_graph_pipeline")
+{
+    linalg::Matrix<double> A{testMatrix(20, 30, 1)};
+    linalg::Matrix<double> B{testMatrix(30, 10, 2)};
+    linalg::Matrix<double> C{testMatrix(20, 15, 3)};
+    linalg::Matrix<double> D{testMatrix(15, 10, 4)};
+
+    linalg::TaskGraph<double> graph;
+    auto a = graph.input(A);
+    auto b = graph.input(B);
+    auto c = graph.input(C);
+    auto d = graph.input(D);
+    auto ab = graph.multiply(a, b);
+    auto cd = graph.multiply(c, d);
+    auto out = graph.transpose(graph.add(ab, cd));
+    auto diff = graph.subtract(ab, cd);
+    graph.run();
+
+    linalg::Matrix<double> expected{linalg::Matrix<double>{A * B + C * D}.transpose()};
+    CHECK(graph.result(out) == expected);
+    CHECK(graph.result(diff) == linalg::Matrix<double>{A * B - C * D});
+    CHECK(graph.result(a) == A);
+
+    // Running again recomputes from the current inputs.
+    A(0, 0) += 1;
+    graph.run();
+    CHECK(graph.result(ab) == A * B);
+}
+
+TEST_CASE("task_graph_custom_operation")
+{
+    linalg::Matrix<int> X{{{1, 2}, {3, 4}}};
+    linalg::TaskGraph<int> graph;
+    auto x = graph.input(X);
+    auto sum = graph.apply({x, x, x}, [](const std::vector<const linalg::Matrix<int>*>& in)
+    {
+        return linalg::Matrix<int>{*in[0] + *in[1] + *in[2]};
+    });
+    auto scaled = graph.apply({sum}, [](const std::vector<const linalg::Matrix<int>*>& in)
+    {
+        return linalg::Matrix<int>{*in[0] * 2};
+    });
+    graph.run();
+    CHECK(graph.result(scaled) == linalg::Matrix<int>{{{6, 12}, {18, 24}}});
+}
+
+TEST_CASE("task_graph_runs_independent_nodes_concurrently")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    linalg::Matrix<int> X{{1}};
+
+    // Each of the two nodes waits for the other to start, which only
+    // finishes when they run at the same time.
+    std::mutex mutex;
+    std::condition_variable cv;
+    int started = 0;
+    std::atomic<bool> overlapped{true};
+    auto meet = [&](const std::vector<const linalg::Matrix<int>*>& in)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        started++;
+        cv.notify_all();
+        if (!cv.wait_for(lock, std::chrono::seconds(10), [&] { return started == 2; }))
+        {
+            overlapped = false;
+        }
+        return *in[0];
+    };
+    linalg::TaskGraph<int> graph;
+    auto x = graph.input(X);
+    graph.apply({x}, meet);
+    graph.apply({x}, meet);
+    graph.run();
+    CHECK(overlapped);
+    linalg::setNumThreads(threads);
+}
+
+TEST_CASE("huge_task_graph_threaded")
+{
+    size_t threads = linalg::getNumThreads();
+    linalg::setNumThreads(4);
+    // A reduction tree of 16 products.
+    std::vector<linalg::Matrix<double>> lhs;
+    std::vector<linalg::Matrix<double>> rhs;
+    for (size_t i=0; i<16; i++)
+    {
+        lhs.push_back(testMatrix(120, 90, i));
+        rhs.push_back(testMatrix(90, 110, i + 7));
+    }
+    linalg::TaskGraph<double> graph;
+    std::vector<linalg::TaskGraph<double>::Node> level;
+    for (size_t i=0; i<16; i++)
+    {
+        level.push_back(graph.multiply(graph.input(lhs[i]), graph.input(rhs[i])));
+    }
+    while (level.size() > 1)
+    {
+        std::vector<linalg::TaskGraph<double>::Node> next;
+        for (size_t i=0; i<level.size(); i+=2)
+        {
+            next.push_back(graph.add(level[i], level[i + 1]));
+        }
+        level = next;
+    }
+    graph.run();
+
+    linalg::Matrix<double> expected{120, 110, 0.0};
+    for (size_t i=0; i<16; i++)
+    {
+        expected += lhs[i] * rhs[i];
+    }
+    CHECK(graph.result(level[0]) == expected);
+    linalg::setNumThreads(threads);
+}
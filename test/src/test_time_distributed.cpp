@@ -0,0 +1,157 @@
+/*
+ * This file is part of Matrix.
+ *
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <Matrix/distributed.h>
+
+
+// Transport which delays every message as a link between nodes would: a
+// fixed latency plus the time to push the bytes through at the bandwidth.
+class SimulatedNetwork : public linalg::Transport
+{
+public:
+    SimulatedNetwork(linalg::Transport& inner, double latency, double bandwidth)
+        : m_inner(inner), m_latency{latency}, m_bandwidth{bandwidth}
+    {
+    }
+
+    size_t rank() const override
+    {
+        return m_inner.rank();
+    }
+
+    size_t size() const override
+    {
+        return m_inner.size();
+    }
+
+    void send(size_t dest, int tag, const void* data, size_t bytes) override
+    {
+        if (dest != rank())
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(m_latency + bytes / m_bandwidth));
+        }
+        m_inner.send(dest, tag, data, bytes);
+    }
+
+    void recv(size_t source, int tag, void* data, size_t bytes) override
+    {
+        m_inner.recv(source, tag, data, bytes);
+    }
+
+    size_t bytesSent() const override
+    {
+        return m_inner.bytesSent();
+    }
+
+private:
+    linalg::Transport& m_inner;
+    double m_latency;
+    double m_bandwidth;
+};
+
+typedef std::function<linalg::DistributedMatrix<double>(const linalg::DistributedMatrix<double>&,
+                                                        const linalg::DistributedMatrix<double>&)> Algorithm;
+
+// Runs one multiplication and prints the bytes sent by all the processes,
+// the most sent by one process and the time of the slowest one.
+static void measure(const std::string& name, size_t processes, linalg::ProcessGrid grid, size_t n,
+                    const Algorithm& algorithm)
+{
+    linalg::Matrix<double> A{n, n, 0.5};
+    linalg::Matrix<double> B{n, n, 2.0};
+    linalg::runProcesses(processes, [&](linalg::Transport& local)
+    {
+        SimulatedNetwork transport(local, 20e-6, 1e9);
+        linalg::DistributedMatrix<double> a{linalg::scatter<double>(transport, grid, A, 0)};
+        linalg::DistributedMatrix<double> b{linalg::scatter<double>(transport, grid, B, 0)};
+        linalg::barrier(transport);
+
+        size_t before = transport.bytesSent();
+        auto start = std::chrono::steady_clock::now();
+        linalg::DistributedMatrix<double> c{algorithm(a, b)};
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double stats[2] = {static_cast<double>(transport.bytesSent() - before), seconds};
+
+        if (transport.rank() != 0)
+        {
+            transport.send(0, 0, stats, sizeof(stats));
+            return 0;
+        }
+        double bytes = stats[0];
+        double busiest = stats[0];
+        double slowest = stats[1];
+        for (size_t p=1; p<transport.size(); p++)
+        {
+            transport.recv(p, 0, stats, sizeof(stats));
+            bytes += stats[0];
+            busiest = std::max(busiest, stats[0]);
+            slowest = std::max(slowest, stats[1]);
+        }
+        std::printf("%-28s %3zu processes %10.2f MB total %8.2f MB per process %10.1f ms\n", name.c_str(),
+                    processes, bytes / 1e6, busiest / 1e6, slowest * 1e3);
+        std::fflush(stdout);
+        return 0;
+    });
+}
+
+int main()
+{
+    const size_t N = 768;
+    std::cout << "This file multiplies two " << N << "-by-" << N << " double matrices with each distributed ";
+    std::cout << "algorithm, over local processes whose messages are delayed as on a network with ";
+    std::cout << "20 us latency and 1 GB/s bandwidth, and prints the bytes sent in total and by the busiest ";
+    std::cout << "process, and the wall time.\n";
+    std::cout << "Every process runs on its own share of the cores of this machine.\n\n";
+
+    Algorithm summa = [](const linalg::DistributedMatrix<double>& a, const linalg::DistributedMatrix<double>& b)
+    {
+        return linalg::summa(a, b);
+    };
+    Algorithm cannon = [](const linalg::DistributedMatrix<double>& a, const linalg::DistributedMatrix<double>& b)
+    {
+        return linalg::cannon(a, b);
+    };
+    Algorithm twoLayers = [](const linalg::DistributedMatrix<double>& a, const linalg::DistributedMatrix<double>& b)
+    {
+        return linalg::multiply25D(a, b, 2);
+    };
+    Algorithm fourLayers = [](const linalg::DistributedMatrix<double>& a, const linalg::DistributedMatrix<double>& b)
+    {
+        return linalg::multiply25D(a, b, 4);
+    };
+
+    measure("SUMMA 4 x 4", 16, linalg::ProcessGrid{4, 4}, N, summa);
+    measure("Cannon 4 x 4", 16, linalg::ProcessGrid{4, 4}, N, cannon);
+    measure("SUMMA 4 x 8", 32, linalg::ProcessGrid{4, 8}, N, summa);
+    measure("2.5D 4 x 4 x 2 layers", 32, linalg::ProcessGrid{4, 4}, N, twoLayers);
+    measure("SUMMA 8 x 8", 64, linalg::ProcessGrid{8, 8}, N, summa);
+    measure("Cannon 8 x 8", 64, linalg::ProcessGrid{8, 8}, N, cannon);
+    measure("2.5D 4 x 4 x 4 layers", 64, linalg::ProcessGrid{4, 4}, N, fourLayers);
+    return 0;
+}